@@ -13,12 +13,18 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#if defined(LINUX)
+#define __USE_GNU
+#include <sched.h>
+#undef __USE_GNU
+#endif /* LINUX */
 #include <pthread.h>
 #include <locale.h>
 #include <signal.h>
 #if defined(LINUX)
 #define __USE_GNU
 #include <fcntl.h>
+#include <sys/uio.h>
 #undef __USE_GNU
 #else /* ! LINUX */
 #include <fcntl.h>
@@ -33,8 +39,47 @@
 #endif /* ! LINUX */
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
 #include <errno.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && ! defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define  ATOMIC           _Atomic
+#else /* no C11 atomics */
+#define  ATOMIC           volatile
+#endif /* no C11 atomics */
+#if defined(__APPLE__) && defined(__aarch64__)
+#define  CACHE_LINE_SZ    128
+#else /* ! Apple silicon */
+#define  CACHE_LINE_SZ    64
+#endif /* ! Apple silicon */
+#if defined(__GNUC__)
+#define  CACHE_ALIGNED    __attribute__((aligned(CACHE_LINE_SZ)))
+#else /* ! __GNUC__ */
+#define  CACHE_ALIGNED
+#endif /* ! __GNUC__ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define  CRC32C_X86       1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define  CRC32C_ARM       1
+#endif /* __aarch64__ && __ARM_FEATURE_CRC32 */
+#if defined(LINUX)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include <linux/perf_event.h>
+#endif /* LINUX */
 
 /********************************************************************
  * Macros, constants, structures and types.
@@ -50,7 +95,33 @@
 #define  ENV_RAWWRITE     "IOPSRawWrite"
 #define  ENV_RAWVALUE     "YES"
 
-#define  WAIT_US          10
+#if defined(LINUX) && defined(RWF_DSYNC)
+#define  ALLOW_RWFDSYNC   1
+#endif /* LINUX && RWF_DSYNC */
+#if defined(LINUX) && defined(SYNC_FILE_RANGE_WRITE)
+#define  ALLOW_SYNCRANGE  1
+#endif /* LINUX && SYNC_FILE_RANGE_WRITE */
+#if defined(LINUX)
+#define  ALLOW_DISCARD    1
+#endif /* LINUX */
+#if defined(LINUX) && defined(FICLONE)
+#define  ALLOW_CLONE      1
+#endif /* LINUX && FICLONE */
+#if defined(LINUX) && defined(CPU_SET)
+#define  ALLOW_AFFINITY   1
+#endif /* LINUX && CPU_SET */
+#if defined(LINUX) && defined(MAP_HUGETLB) && defined(MADV_HUGEPAGE)
+#define  ALLOW_HUGEPAGES  1
+#endif /* LINUX && MAP_HUGETLB && MADV_HUGEPAGE */
+#if defined(LINUX) && defined(__NR_perf_event_open)
+#define  ALLOW_PERF       1
+#endif /* LINUX && __NR_perf_event_open */
+#if defined(LINUX)
+#define  ALLOW_DEVSTATS   1
+#define  ALLOW_SYSCPU     1
+#endif /* LINUX */
+
+#define  WAIT_MAX_US      100000
 #define  MSG_BUFF_SZ      256
 #define  KB_MULT          1024L
 #define  MB_MULT          (KB_MULT * KB_MULT)
@@ -66,46 +137,210 @@
 #define  MIN_RAMP         0
 #define  MAX_RAMP         60
 #define  DFLT_RAMP        10
+#define  MIN_STEADY       10
+#define  MAX_STEADY       3600
+#define  STEADY_WINDOW    5
+#define  STEADY_RANGE_PCT 20.0
+#define  STEADY_SLOPE_PCT 10.0
+#define  MAX_REPEAT       100
+#define  DFLT_CIREPEAT    10
+#define  MIN_CIROUNDS     3
 #define  MIN_IOSZ         1
 #define  MAX_IOSZ         (32 * MB_MULT)
 #define  DFLT_IOSZ        (1 * MB_MULT)
 #define  DFLT_GENIOSZ     (32 * MB_MULT)
 #define  DFLT_FNAME       "iopsdata"
 #define  MIN_THREADS      1
-#define  MAX_THREADS      64
+#define  MAX_THREADS      4096
 #define  DFLT_THREADS     1
+#define  MAX_TARGETS      64
 #define  DFLT_VERBOSE     0
+#define  VERBOSE_THREADS  16
+#define  OUTLIER_PCT      20
+#define  MAX_OUTLIERS     10
+#define  INIT_WORKERS     32
+#define  RATE_GEN         0
+#define  RATE_READ        1
+#define  RATE_WRITE       2
+#define  OUT_NONE         0
+#define  OUT_JSON         1
+#define  OUT_CSV          2
+#define  OUTPUT_SCHEMA    2
+#define  SAMPLE_US        1000000L
+#define  MAX_SAMPLES      ((MAX_DUR * 1000000L / SAMPLE_US) + 1)
+#define  DFLT_THRESHOLD   5.0
+#define  RET_REGRESS      64
+#define  MAX_CMPARGS      (34 + (2 * MAX_TARGETS))
+#define  STATS_POLL_MS    200
+#define  STATS_BACKLOG    8
+#define  MAX_JOBS         64
+#define  MAX_JOBARGS      128
+#define  JOB_LINESZ       1024
+#define  JOB_NAMESZ       64
+#define  JOB_SIGSZ        4096
 #define  MODE_UNKNOWN     0
 #define  MODE_SEQUENTIAL  1
 #define  MODE_RANDOM      2
 #define  MODE_CREATE      3
+#define  MODE_CLEANUP     4
 #define  DFLT_MODE        MODE_UNKNOWN
 #define  RET_INTR         127
+#define  DUR_DSYNC        0
+#define  DUR_RWFDSYNC     1
+#define  DUR_FDATASYNC    2
+#define  DUR_FSYNC        3
+#define  DUR_SYNCRANGE    4
+#define  DFLT_DURABILITY  DUR_DSYNC
+#define  MIN_SYNCINT      1
+#define  MAX_SYNCINT      1000000
+#define  DFLT_SYNCINT     1
+#define  DISC_NONE        0
+#define  DISC_TRIM        1
+#define  DISC_ZEROOUT     2
+#define  DISC_PUNCH       3
+#define  DISC_ZERO        4
+#define  MIN_DISCPCT      1
+#define  MAX_DISCPCT      100
+#define  DFLT_DISCPCT     100
+#define  VERIFY_BLKSZ     4096
+#define  VERIFY_MAGIC     0x56504f49U
+#define  CRC32C_POLY      0x82f63b78U
+#define  CRC32C_STRIDE    1360
+#define  CONT_ZERO        0
+#define  CONT_RANDOM      1
+#define  CONT_BLKSZ       4096
+#define  MIN_RATIO        1.0
+#define  MAX_RATIO        100.0
+#define  DEDUPE_POOL      256
+#define  RNG_LANES        4
+#define  CLONE_NONE       0
+#define  CLONE_REFLINK    1
+#define  CLONE_COPY       2
+#define  CLONE_WRITE      3
+#define  AFF_NONE         0
+#define  AFF_LIST         1
+#define  AFF_COMPACT      2
+#define  AFF_SPREAD       3
+#define  AFF_DEVICE       4
+#define  MAX_CPUS         1024
+#define  SYSFS_NODE       "/sys/devices/system/node"
+#define  BUF_NORMAL       0
+#define  BUF_THP          1
+#define  BUF_HUGETLB      2
+#define  DFLT_HUGEPAGESZ  (2 * MB_MULT)
+#define  PERF_NEVENTS     5
+#define  MAX_DEVICES      16
+#define  DEV_NFIELDS      11
+#define  DEV_SECTORSZ     512
+#define  DEV_RDIOS        0
+#define  DEV_RDMERGES     1
+#define  DEV_RDSECTORS    2
+#define  DEV_WRIOS        4
+#define  DEV_WRMERGES     5
+#define  DEV_WRSECTORS    6
+#define  DEV_IOTICKS      9
+#define  DEV_QUEUETICKS   10
+#define  CPU_NFIELDS      8
+#define  CPU_USER         0
+#define  CPU_NICE         1
+#define  CPU_SYSTEM       2
+#define  CPU_IDLE         3
+#define  CPU_IOWAIT       4
+#define  CPU_IRQ          5
+#define  CPU_SOFTIRQ      6
+#define  CPU_STEAL        7
+#define  HOT_IRQ_PCT      10.0
+#define  REUSE_SUFFIX     ".iops"
+#define  REUSE_MAGIC      "IOPS test file"
+#define  REUSE_VERSION    1
+#define  REUSE_LINESZ     128
+#define  HIST_SUBBITS     3
+#define  HIST_SUBBKTS     (1 << HIST_SUBBITS)
+#define  HIST_MAXBIT      36
+#define  HIST_BUCKETS     ((HIST_MAXBIT - HIST_SUBBITS + 2) * HIST_SUBBKTS)
 
 typedef enum { DEFUNCT, RUNNING, RAMP, MEASURE, END, STOP } tstate_t;
 
+/*
+ * Latency histogram. Values are in µs and are bucketed log-linearly;
+ * each power of two is split into HIST_SUBBKTS equal sub-buckets so
+ * percentiles are accurate to within 1/HIST_SUBBKTS of the value.
+ */
+
+struct s_histogram
+{
+    long   count;
+    long   totalus;
+    long   minus;
+    long   maxus;
+    long   bucket[HIST_BUCKETS];
+};
+
+typedef struct s_histogram histogram_t;
+
+/*
+ * Header stamped at the start of every VERIFY_BLKSZ block when data
+ * verification is enabled. The last 4 bytes of each block hold the
+ * CRC32C of the rest of the block.
+ */
+
+struct s_vhdr
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t generation;
+    uint64_t seed;
+};
+
+typedef struct s_vhdr vhdr_t;
+
+#if defined(__GNUC__)
+typedef uint64_t rngvec_t __attribute__((vector_size(RNG_LANES * sizeof(uint64_t))));
+#endif /* __GNUC__ */
+
+/*
+ * Per-thread test context. Contexts are cache line aligned so that the
+ * counters one thread updates on every I/O never share a cache line
+ * with another thread's context.
+ */
+
 struct s_context
 {
     char * fname;
     char * tfname;
+    char * cpulist;
     void * genblk;
     void * ioblk;
     long   fsz;
     long   iosz;
     int    duration;
     int    ramp;
+    int    steady;
+    int    repeat;
     int    noread;
     int    nowrite;
     long   geniosz;
+    long   membudget;
     long   maxoffset;
     long   maxblock;
     long   blksz;
     long   optiosz;
-    long   nreads;
-    long   nwrites;
     long   preallocus;
     long   fsyncus;
     long   closeus;
+    long   flushus;
+    long   flushlo;
+    long   flushhi;
+    long   verifyus;
+    long   vseed;
+    long   vgen;
+    long   contentus;
+    long   genbytes;
+    long   rdbytes;
+    long   wrbytes;
+    long   dcbytes;
+    long   gentime;
     long   uscrstart;
     long   uscrstop;
     long   usrdstart;
@@ -126,31 +361,79 @@ struct s_context
     int    nopreallocate;
     int    nodsync;
     int    nofsync;
+    int    durability;
+    int    syncint;
+    int    discard;
+    int    discardpct;
+    int    verify;
+    int    content;
+    double compress;
+    double dedupe;
+    int    reuse;
+    int    reused;
+    int    reinfo;
+    int    clone;
+    int    clonemethod;
+    int    affinity;
+    int    devnode;
+    int    cpu;
+    int    cpunode;
+    int    hugepages;
+    int    lockbufs;
+    int    iolat;
+    int    perf;
+    int    devstats;
     int    verbose;
     int    reportcpu;
     int    threadno;
+    int    target;
+    int    tgtno;
+    int    tgtthreads;
     int    fd;
+    int    clonefd;
 #if defined( ALLOW_RAW )
     int    raw;
     int    blk;
     int    rawwrite;
 #endif /* ALLOW_RAW */
     int    retcode;
-    volatile int crready;
-    volatile int rdready;
-    volatile int wrready;
-    volatile int crstart;
-    volatile int rdstart;
-    volatile int wrstart;
-    volatile tstate_t tstate;
-    volatile int crfinished;
-    volatile int rdfinished;
-    volatile int wrfinished;
-    long   crduration;
+    // flags written by the coordinator are kept off the counter lines
+    ATOMIC int crready CACHE_ALIGNED;
+    ATOMIC int rdready;
+    ATOMIC int wrready;
+    ATOMIC int crstart;
+    ATOMIC int rdstart;
+    ATOMIC int wrstart;
+    ATOMIC int rnstart;
+    ATOMIC tstate_t tstate;
+    ATOMIC int crfinished;
+    ATOMIC int rdfinished;
+    ATOMIC int wrfinished;
+    long   crduration CACHE_ALIGNED;
     long   rdduration;
     long   wrduration;
+    long   rdcpuus;
+    long   wrcpuus;
+    int    perffd[PERF_NEVENTS];
+    long   rdperf[PERF_NEVENTS];
+    long   wrperf[PERF_NEVENTS];
+    uint64_t rng[RNG_LANES];
+    uint64_t rngsel;
+    histogram_t flushhist;
+    histogram_t discardhist;
+    histogram_t rdhist;
+    histogram_t wrhist;
     char   msgbuff[MSG_BUFF_SZ];
     pthread_t tid;
+    // counters updated by the test thread on every I/O have cache lines of
+    // their own, away from the settings other threads read
+    long   nreads CACHE_ALIGNED;
+    long   nwrites;
+    long   nrampops;
+    long   nflushes;
+    long   sinceflush;
+    long   ndiscards;
+    long   nverified;
 };
 
 typedef struct s_context context_t;
@@ -161,6 +444,19 @@ typedef struct s_context context_t;
 
 volatile int signalReceived = 0;
 
+/*
+ * Test phases are coordinated using a mutex and two condition variables.
+ * Test threads wait on startCond for the coordinator to start a phase;
+ * the coordinator waits on eventCond for the test threads to change
+ * state. eventSeq counts those changes so that one made between the
+ * coordinator checking the threads and waiting is never missed.
+ */
+
+pthread_mutex_t phaseLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t startCond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t eventCond = PTHREAD_COND_INITIALIZER;
+unsigned long eventSeq = 0;
+
 struct timeval pstart, pend;
 struct rusage rstart, rend;
 
@@ -170,11 +466,14 @@ context_t mctxt =
     NULL,
     NULL,
     NULL,
+    NULL,
     DFLT_FSIZE,
     DFLT_IOSZ,
     DFLT_DUR,
     DFLT_RAMP,
     0,
+    1,
+    0,
     0,
     DFLT_GENIOSZ,
     0L,
@@ -192,6 +491,17 @@ context_t mctxt =
     0L,
     0L,
     0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
     DFLT_MODE,
     DFLT_THREADS,
     0,
@@ -206,9 +516,35 @@ context_t mctxt =
     0,
     0,
     0,
+    DFLT_DURABILITY,
+    DFLT_SYNCINT,
+    DISC_NONE,
+    DFLT_DISCPCT,
+    0,
+    CONT_ZERO,
+    MIN_RATIO,
+    MIN_RATIO,
+    0,
+    0,
+    0,
+    0,
+    CLONE_NONE,
+    AFF_NONE,
+    -1,
+    -1,
+    -1,
+    BUF_NORMAL,
+    0,
+    0,
+    0,
+    0,
     DFLT_VERBOSE,
     0,
     0,
+    0,
+    0,
+    0,
+    -1,
     -1,
 #if defined( ALLOW_RAW )
     0,
@@ -222,6 +558,7 @@ context_t mctxt =
     0,
     0,
     0,
+    0,
     DEFUNCT,
     0,
     0,
@@ -229,11 +566,269 @@ context_t mctxt =
     0L,
     0L,
     0L,
+    0L,
+    0L,
+    { -1, -1, -1, -1, -1 },
+    { 0L },
+    { 0L },
+    { 0 },
+    0,
+    { 0L },
+    { 0L },
+    { 0L },
+    { 0L },
     "",
-    (pthread_t)NULL
+    (pthread_t)NULL,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L,
+    0L
+};
+
+context_t * tctxt = NULL;
+
+/*
+ * Test targets. Each target is a test file path with its own thread
+ * count; without '-target' there is a single target taken from '-file'
+ * and '-threads'.
+ */
+
+struct s_target
+{
+    char * fname;
+    int    threads;
+};
+
+typedef struct s_target target_t;
+
+target_t targets[MAX_TARGETS];
+int ntargets = 0;
+
+uint32_t crc32cTable[8][256];
+uint32_t crc32cShift[4][256];
+uint32_t (*crc32cFunc)( uint32_t, const void *, size_t ) = NULL;
+
+void * dedupePool = NULL;
+void * genShared = NULL;
+long genSharedSz = 0L;
+
+int outfmt = OUT_NONE;
+char * outfname = NULL;
+FILE * outfp = NULL;
+
+/*
+ * Aggregate IOPS sampled by the coordinator every SAMPLE_US during the
+ * measured part of the current read or write phase.
+ */
+
+struct s_sampler
+{
+    long   lastops;
+    long   lastus;
+    long   nextus;
+    int    count;
+    double rate[MAX_SAMPLES];
+};
+
+typedef struct s_sampler sampler_t;
+
+sampler_t sampler;
+
+/*
+ * Steady state detection ('-steady'). During ramp up the aggregate IOPS
+ * of each sample interval are kept for the last STEADY_WINDOW intervals;
+ * the workload is steady once their range and the excursion of their
+ * least squares line are both within limits (as in the SNIA PTS).
+ */
+
+struct s_steady
+{
+    int    active;
+    int    reached;
+    int    count;
+    long   startus;
+    long   nextus;
+    long   lastus;
+    long   lastops;
+    long   tookus;
+    double range;
+    double slope;
+    double rate[STEADY_WINDOW];
+};
+
+typedef struct s_steady steady_t;
+
+steady_t steady;
+
+/*
+ * Repeated rounds ('-repeat', '-ci'). The read and write phases are run
+ * again on the same files and the results of each round kept so that
+ * their mean, standard deviation and 95% confidence interval can be
+ * reported. With a confidence interval target, rounds stop once the IOPS
+ * of every phase is known to within that target.
+ */
+
+struct s_rounds
+{
+    int    n[RATE_WRITE + 1];
+    int    nlat[RATE_WRITE + 1];
+    double iops[RATE_WRITE + 1][MAX_REPEAT];
+    double mbs[RATE_WRITE + 1][MAX_REPEAT];
+    double p99[RATE_WRITE + 1][MAX_REPEAT];
+};
+
+typedef struct s_rounds rounds_t;
+
+rounds_t rounds;
+double citarget = 0.0;
+
+/*
+ * Job files ('iops job'). Each section of the file describes one test;
+ * its options, together with any from the [global] section that it does
+ * not override, are parsed as if they had been given on the command line.
+ * jobs[0] holds the [global] section.
+ */
+
+struct s_job
+{
+    char   name[JOB_NAMESZ];
+    int    line;
+    int    testmode;
+    int    nargs;
+    char * args[MAX_JOBARGS];
+    int    isopt[MAX_JOBARGS];
+    int    ran;
+    int    ret;
+    double iops[RATE_WRITE + 1];
+    double mbs[RATE_WRITE + 1];
+};
+
+typedef struct s_job job_t;
+
+job_t jobs[MAX_JOBS + 1];
+int njobs = 0;
+char * jobname = NULL;
+
+/*
+ * A baseline read or write phase loaded by 'compare'.
+ */
+
+struct s_baseline
+{
+    int    present;
+    long   iosz;
+    double iops;
+    double mbs;
+    long   p99us;
+    int    count;
+    double * rate;
+};
+
+typedef struct s_baseline baseline_t;
+
+char * cmpfname = NULL;
+double threshold = DFLT_THRESHOLD;
+baseline_t baseline[RATE_WRITE + 1];
+int regressions = 0;
+
+/*
+ * Live statistics ('-stats'). The coordinator publishes the current phase
+ * and when it started; everything else is read directly from the thread
+ * contexts by the stats thread.
+ */
+
+char * statsfname = NULL;
+int statsfd = -1;
+ATOMIC int statsStop = 0;
+ATOMIC int livePhase = -1;
+ATOMIC long livePhaseUs = 0L;
+pthread_t statsTid;
+
+/*
+ * Per thread performance counters ('-perf'). Each test thread opens its
+ * own counters which are enabled only while it is measuring. Hardware
+ * events fall back to counting user space only if the kernel does not
+ * allow more.
+ */
+
+#if defined(ALLOW_PERF)
+struct s_perfevent
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+struct s_perfevent perfEvents[PERF_NEVENTS] =
+{
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+};
+
+char * perfNames[PERF_NEVENTS] =
+{
+    "CPU cycles", "Instructions", "Cache misses", "Context switches", "Page faults"
+};
+
+char * perfKeys[PERF_NEVENTS] =
+{
+    "cycles", "instructions", "cache_misses", "context_switches", "page_faults"
+};
+
+ATOMIC int perfUserOnly = 0;
+ATOMIC int perfErrno[PERF_NEVENTS];
+#endif /* ALLOW_PERF */
+
+/*
+ * Block device statistics ('-devstats'). The disks holding the test
+ * files are found through sysfs and their statistics are snapshotted by
+ * the coordinator at the start and end of each measurement and sampled
+ * for in-flight I/Os at each IOPS sample.
+ */
+
+#if defined(ALLOW_DEVSTATS)
+struct s_device
+{
+    char   name[64];
+    long   start[DEV_NFIELDS];
+    long   stop[DEV_NFIELDS];
+    long   startus;
+    long   stopus;
+    long   inflight;
+    long   maxinflight;
+    long   nsamples;
+};
+
+typedef struct s_device device_t;
+
+device_t devices[MAX_DEVICES];
+int ndevices = 0;
+#endif /* ALLOW_DEVSTATS */
+
+/*
+ * System wide CPU usage. The coordinator snapshots /proc/stat at the start
+ * and end of each measurement so that time spent by other CPUs, such as
+ * in interrupt handling for I/O completions, is visible. The last entry
+ * holds the totals for all CPUs.
+ */
+
+#if defined(ALLOW_SYSCPU)
+struct s_cpustat
+{
+    long   start[CPU_NFIELDS];
+    long   stop[CPU_NFIELDS];
+    int    valid;
 };
 
-context_t tctxt[MAX_THREADS];
+typedef struct s_cpustat cpustat_t;
+
+cpustat_t cpustats[MAX_CPUS + 1];
+#endif /* ALLOW_SYSCPU */
 
 /********************************************************************
  * Functions
@@ -391,6 +986,11 @@ handleSignals(
     if (  sigaction( SIGUSR2, &sa, NULL )  )
         return 1;
 
+    // a '-stats' client that disconnects early must not end the test
+    sa.sa_handler = SIG_IGN;
+    if (  sigaction( SIGPIPE, &sa, NULL )  )
+        return 1;
+
     return 0;
 } // handleSignals
 
@@ -410,19 +1010,53 @@ usage(
     printf("    iops { s[equential] | r[andom] } [-file <fpath>] [-fsize <fsz>] [-cpu]\n");
     printf("         [-iosz <tsz>] [-dur <tdur>] [-ramp <tramp>] [-noread | -nowrite]\n");
 #if defined(ALLOW_RAW) && defined(ALLOW_RAWWRITE)
-    printf("         [-geniosz <gsz>] [-threads <nthr>] [-verbose]\n");
-    printf("         [-1file [<usrfpath> [-rawWrite]]]\n");
+    printf("         [-geniosz <gsz>] [-threads <nthr>] [-verify] [-verbose]\n");
+    printf("         [-1file [<usrfpath> [-rawWrite]]] [-target <fpath>[:<nthr>]]...\n");
 #else  /* ! ALLOW_RAW || ! ALLOW_RAWWRITE */
-    printf("         [-geniosz <gsz>] [-threads <nthr>] [-verbose] [-1file [<usrfpath>]]\n");
+    printf("         [-geniosz <gsz>] [-threads <nthr>] [-verify] [-verbose]\n");
+    printf("         [-1file [<usrfpath>]] [-target <fpath>[:<nthr>]]...\n");
 #endif /* ! ALLOW_RAW || ! ALLOW_RAWWRITE */
 #if defined(LINUX) || defined(SOLARIS)
-    printf("         [-nopreallocate] [-cache] [-nodysnc [-nofsync]]\n\n");
+    printf("         [-nopreallocate] [-cache] [-nodysnc [-nofsync]]\n");
 #else /* macOS */
-    printf("         [-nopreallocate] [-rdahead] [-cache] [-nodysnc [-nofsync]]\n\n");
+    printf("         [-nopreallocate] [-rdahead] [-cache] [-nodysnc [-nofsync]]\n");
 #endif /* macOS */
+    printf("         [-durability <dmode> [-syncint <nwr>] [-nofsync]] [-steady <tmax>]\n");
+#if defined(ALLOW_DISCARD)
+    printf("         [-discard <dop> [-discardpct <pct>]]\n");
+#endif /* ALLOW_DISCARD */
+    printf("         [-content <cpat>] [-compress <cr>] [-dedupe <dr>] [-reuse]\n");
+    printf("        ");
+#if defined(ALLOW_CLONE)
+    printf(" [-clone]");
+#endif /* ALLOW_CLONE */
+#if defined(ALLOW_AFFINITY)
+    printf(" [-affinity <aff>]");
+#endif /* ALLOW_AFFINITY */
+#if defined(ALLOW_HUGEPAGES)
+    printf(" [-hugepages <hmode>]");
+#endif /* ALLOW_HUGEPAGES */
+    printf(" [-mlock]");
+#if defined(ALLOW_PERF)
+    printf(" [-perf]");
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_DEVSTATS)
+    printf(" [-devstats]");
+#endif /* ALLOW_DEVSTATS */
+    printf("\n");
+    printf("         [-membudget <msz>] [-output <ofmt> <ofile>] [-stats <spath>]\n");
+    printf("         [-repeat <nrep>] [-ci <pct>] [-latency]\n\n");
 
     printf("    iops c[reate] [-file <fpath>] [-fsize <fsz>] [-geniosz <gsz>]\n");
-    printf("         [-nopreallocate] [-cpu]\n\n");
+    printf("         [-nopreallocate] [-verify] [-content <cpat>] [-compress <cr>]\n");
+    printf("         [-dedupe <dr>] [-reuse] [-cpu] [-membudget <msz>]\n");
+    printf("         [-output <ofmt> <ofile>]\n\n");
+
+    printf("    iops compare <rfile> [-threshold <pct>] [<options>]\n\n");
+
+    printf("    iops job <jfile>\n\n");
+
+    printf("    iops cleanup [-file <fpath>]\n\n");
 
     printf("    iops h[elp]\n\n");
 
@@ -442,6 +1076,53 @@ usage(
     printf("  c[reate]\n");
     printf("     Creates a file suitable for later use with the '-1file' option.\n\n");
 
+    printf("  compare\n");
+    printf("     Repeats the test recorded in <rfile>, a result file written using\n");
+    printf("     '-output json', and compares the results with it. For each read and\n");
+    printf("     write phase the per second IOPS samples of both runs give a 95%%\n");
+    printf("     confidence interval for IOPS and MB/s; a change is a regression if\n");
+    printf("     it is statistically significant (Welch's t-test) and worse than\n");
+    printf("     <pct> percent (default %.0f). p99 latency is compared against the\n",
+                    DFLT_THRESHOLD);
+    printf("     threshold alone, and only if <rfile> has latency ('-latency' is then\n");
+    printf("     implied). The exit status is %d if there are regressions.\n",
+                    RET_REGRESS);
+    printf("     If <rfile> holds several rounds ('-repeat') the samples of all of\n");
+    printf("     them are combined and their IOPS, MB/s and p99 latency averaged; if\n");
+    printf("     it holds several tests ('job') the last one is used.\n");
+    printf("     Test options not recorded in <rfile> (e.g. '-affinity', '-discard')\n");
+    printf("     may be added as <options>.\n\n");
+
+    printf("  job\n");
+    printf("     Runs the sequence of tests described in the job file <jfile> in a\n");
+    printf("     single process and then reports a summary of their results. Each\n");
+    printf("     test is a section starting with '[<name>]' followed by lines of the\n");
+    printf("     form '<option> [= <value>]', where <option> is any test option\n");
+    printf("     without its leading '-', plus 'mode = <mode>' where <mode> is one\n");
+    printf("     of the test types above (sequential, random or create). Options in\n");
+    printf("     a '[global]' section, which must come first, apply to every test\n");
+    printf("     that does not give the same option itself; '-output' may only be\n");
+    printf("     given there and collects the results of all tests in one file.\n");
+    printf("     Lines starting with '#' or ';' are comments. All tests are checked\n");
+    printf("     before the first one starts. Test files are generated once and\n");
+    printf("     reused by the following tests for as long as they need the same\n");
+    printf("     files (see '-reuse'), then removed unless '-reuse' is given. Up to\n");
+    printf("     %d tests are allowed. For example:\n\n", MAX_JOBS);
+    printf("         [global]\n");
+    printf("         file = /data/iops\n");
+    printf("         dur = 30\n\n");
+    printf("         [randread]\n");
+    printf("         mode = random\n");
+    printf("         nowrite\n");
+    printf("         threads = 8\n\n");
+    printf("         [seqwrite]\n");
+    printf("         mode = sequential\n");
+    printf("         noread\n");
+    printf("         iosz = 1m\n\n");
+
+    printf("  cleanup\n");
+    printf("     Removes the reusable test files for <fpath> (see '-reuse').\n\n");
+
     printf("  h[elp]\n");
     printf("     Display full help (this text).\n\n");
 
@@ -452,7 +1133,16 @@ usage(
     printf("        '%s'.\n\n", DFLT_FNAME);
 
     printf("        Files that will be created must not already exist. Any files created\n");
-    printf("        will be removed automatically.\n\n");
+    printf("        will be removed automatically unless '-reuse' is specified.\n\n");
+
+    printf("    -target <fpath>[:<nthr>]\n");
+    printf("        Test several paths (for example on different devices) at the same\n");
+    printf("        time. Each '-target' is used like '-file' with its own thread count;\n");
+    printf("        if <nthr> is omitted the '-threads' value is used. Up to %d targets\n",
+                    MAX_TARGETS);
+    printf("        may be given and all other options apply to every target. Results\n");
+    printf("        are reported for each target and for all targets together. Not\n");
+    printf("        compatible with '-file', '-clone' or a user specified file.\n\n");
 
     printf("    -fsize <fsz>\n");
     printf("        When creating test files, the size of each test file. When using an\n");
@@ -503,6 +1193,14 @@ usage(
     printf("        optimal I/O size to %'ld MB, or %'ld MB if that cannot be determined.\n\n",
                     DFLT_GENIOSZ/MB_MULT, DFLT_GENIOSZ/MB_MULT);
 
+    printf("    -membudget <msz>\n");
+    printf("        Limit the memory used for I/O and file generation buffers to <msz>,\n");
+    printf("        specified in the same manner as for '-fsize'. The file generation\n");
+    printf("        block size is reduced to fit if '-geniosz' was not given. Buffers are\n");
+    printf("        only held while needed and, with the default zero content, a single\n");
+    printf("        generation buffer is shared by all threads. The peak resident set\n");
+    printf("        size of the process is reported at the end of the run.\n\n");
+
     printf("    -dur <tdur>\n");
     printf("        The duration of the measured part of the test in seconds. Must be\n");
     printf("        between %'d and %'d, the default is %'d\n\n",
@@ -513,6 +1211,36 @@ usage(
     printf("        in seconds. Must be between %'d and %'d, the default is %'d.\n\n",
                     MIN_RAMP, MAX_RAMP, DFLT_RAMP);
 
+    printf("    -steady <tmax>\n");
+    printf("        Instead of a fixed ramp up time, ramp up until the workload reaches\n");
+    printf("        steady state and then start measuring. Steady state is reached when,\n");
+    printf("        over the last %d one second intervals, the range of the IOPS is\n",
+                    STEADY_WINDOW);
+    printf("        within %.0f%% of their mean and the excursion of their best fit line\n",
+                    STEADY_RANGE_PCT);
+    printf("        is within %.0f%% of their mean. If it is not reached within <tmax>\n",
+                    STEADY_SLOPE_PCT);
+    printf("        seconds measurement starts anyway. <tmax> must be between %'d and\n",
+                    MIN_STEADY);
+    printf("        %'d. The time taken is reported. '-ramp' still sets the ramp down\n",
+                    MAX_STEADY);
+    printf("        time.\n\n");
+
+    printf("    -repeat <nrep>\n");
+    printf("        Run the read and write tests <nrep> times, reusing the files\n");
+    printf("        generated for the first round, and then report the mean, standard\n");
+    printf("        deviation and 95%% confidence interval of the IOPS and bandwidth of\n");
+    printf("        each, and of their p99 latency if '-latency' is used. Must be between\n");
+    printf("        1 and %d. Files are kept open between rounds so close times are\n",
+                    MAX_REPEAT);
+    printf("        not reported.\n\n");
+
+    printf("    -ci <pct>\n");
+    printf("        Repeat the read and write tests until the 95%% confidence interval\n");
+    printf("        of the IOPS of each is within +/- <pct> percent of its mean, after at\n");
+    printf("        least %d rounds. At most '-repeat' rounds are run, %d by default.\n\n",
+                    MIN_CIROUNDS, DFLT_CIREPEAT);
+
     printf("    NOTE:\n");
     printf("        The default measurement duration and ramp times have been chosen to\n");
     printf("        give good results across a wide range of storage systems.\n\n");
@@ -527,12 +1255,181 @@ usage(
     printf("        multiple threads may be counter productive as it could result in\n");
     printf("        contention (though the results may still be interesting).\n\n");
 
-    printf("    -cpu\n");
-    printf("        Displays CPU usage information for the measurement part of each test.\n\n");
+#if defined(ALLOW_AFFINITY)
+    printf("    -affinity <aff>\n");
+    printf("        Bind each thread to a single CPU so that results are repeatable on\n");
+    printf("        multi-socket systems. <aff> is one of:\n\n");
+    printf("            compact - use the CPUs of each NUMA node in turn.\n");
+    printf("            spread  - take one CPU from each NUMA node in turn.\n");
+    printf("            device  - use only the CPUs on the test device's NUMA node,\n");
+    printf("                      as reported by sysfs.\n");
+    printf("            <list>  - use the CPUs in a list such as '0-3,8' in order.\n\n");
+    printf("        Threads wrap around if there are more threads than CPUs. Each\n");
+    printf("        thread's buffers are placed in memory local to its CPU. The number\n");
+    printf("        of threads on each node and the device's NUMA node are reported,\n");
+    printf("        and with '-verbose' (up to %d threads) each thread's CPU; comparing\n",
+                    VERBOSE_THREADS);
+    printf("        'device' with a list of CPUs on another node shows the cross-node\n");
+    printf("        penalty.\n\n");
+
+#endif /* ALLOW_AFFINITY */
+#if defined(ALLOW_HUGEPAGES)
+    printf("    -hugepages <hmode>\n");
+    printf("        Back each thread's I/O buffer with huge pages to reduce TLB misses\n");
+    printf("        at high IOPS. <hmode> is one of:\n\n");
+    printf("            thp      - request transparent huge pages via madvise().\n");
+    printf("            explicit - use pages from the pre-reserved hugetlbfs pool\n");
+    printf("                       (see /proc/sys/vm/nr_hugepages).\n\n");
+
+#endif /* ALLOW_HUGEPAGES */
+    printf("    -mlock\n");
+    printf("        Lock each thread's I/O buffer in memory so that it cannot be paged\n");
+    printf("        out during the test. I/O buffers are always pre-faulted before the\n");
+    printf("        test starts.\n\n");
 
+    printf("    -cpu\n");
+    printf("        Displays CPU usage information, including page fault counts, for the\n");
+    printf("        measurement part of each test. For read and write tests the CPU\n");
+    printf("        time consumed by the test threads themselves is also shown along\n");
+    printf("        with the CPU cost per I/O (CPU µs per I/O and IOPS per core); with\n");
+    printf("        '-verbose' this is also shown per thread.\n");
+#if defined(ALLOW_SYSCPU)
+    printf("        System wide CPU usage from /proc/stat (user, system, iowait, irq,\n");
+    printf("        softirq, idle and steal) is also shown so that work done on other\n");
+    printf("        CPUs, such as interrupt handling for I/O completions, is visible.\n");
+    printf("        CPUs spending %.0f%% or more of their time in irq and softirq are\n",
+                    HOT_IRQ_PCT);
+    printf("        listed; with '-verbose' usage is shown for every CPU.\n");
+#endif /* ALLOW_SYSCPU */
+    printf("\n");
+
+#if defined(ALLOW_PERF)
+    printf("    -perf\n");
+    printf("        Count CPU cycles, instructions, cache misses, context switches and\n");
+    printf("        page faults in each test thread, using perf_event_open(), during\n");
+    printf("        the measurement part of the read and write tests and report them\n");
+    printf("        per I/O alongside the IOPS results. Hardware counters are often\n");
+    printf("        unavailable in virtual machines and, depending on the setting of\n");
+    printf("        kernel.perf_event_paranoid, may only count user space.\n\n");
+#endif /* ALLOW_PERF */
+
+#if defined(ALLOW_DEVSTATS)
+    printf("    -devstats\n");
+    printf("        Report statistics for the block device(s) holding the test files,\n");
+    printf("        taken from /sys/block/<dev>/stat and inflight, for the measurement\n");
+    printf("        part of the read and write tests: device IOPS, merges, average\n");
+    printf("        queue depth, utilization, in-flight I/Os and the ratio of device\n");
+    printf("        bytes to application bytes (write amplification for writes).\n");
+    printf("        Partitions are reported as the disk that contains them and device\n");
+    printf("        mapper or md devices as the disks beneath them. Other I/O to the\n");
+    printf("        same disks during the test is included.\n\n");
+#endif /* ALLOW_DEVSTATS */
+
+    printf("    -latency\n");
+    printf("        Record the latency of every measured read and write so that latency\n");
+    printf("        percentiles can be reported, written by '-output', served by\n");
+    printf("        '-stats' and compared by 'compare'. This costs two clock reads and\n");
+    printf("        a histogram update per I/O, which may reduce the IOPS achieved, so\n");
+    printf("        it is off by default.\n\n");
+
+    printf("    -output <ofmt> <ofile>\n");
+    printf("        Also write the results to <ofile> in a machine readable format.\n");
+    printf("        <ofmt> is 'json', giving one JSON object per line for each phase\n");
+    printf("        (create, read, write), or 'csv', giving a heading line followed by\n");
+    printf("        an aggregate row and one row per thread for each phase. Records\n");
+    printf("        contain the configuration, device block sizes, operation counts,\n");
+    printf("        IOPS, bandwidth, latency and CPU usage (regardless of '-cpu'), and\n");
+    printf("        a schema version (currently %d). Numbers never contain thousands\n",
+                    OUTPUT_SCHEMA);
+    printf("        separators. Per I/O latency percentiles are recorded if '-latency'\n");
+    printf("        is used and JSON records include per second IOPS samples for use\n");
+    printf("        by 'compare'. Asking for output does not change what is measured.\n\n");
+
+    printf("    -stats <spath>\n");
+    printf("        Serve live statistics on a UNIX domain socket at <spath> while the\n");
+    printf("        test runs. Each connection receives a snapshot in the Prometheus\n");
+    printf("        text format (as an HTTP response if the client sends a GET request,\n");
+    printf("        e.g. 'curl --unix-socket <spath> http://localhost/metrics'): the\n");
+    printf("        phase, operation and byte counters, per thread operation counters\n");
+    printf("        and, if '-latency' is also used, latency percentiles. The counters\n");
+    printf("        are read without locking so the test threads are not affected.\n\n");
+
+    printf("    -verify\n");
+    printf("        Enables end-to-end data verification. Every %'d byte block written,\n",
+                    VERIFY_BLKSZ);
+    printf("        both when creating the test file(s) and during write tests, is stamped\n");
+    printf("        with its offset, a generation number and a per run seed and is\n");
+    printf("        protected by a CRC32C checksum (computed using CPU instructions where\n");
+    printf("        available). Every block read during read tests is validated and the\n");
+    printf("        test fails on the first bad block. I/O sizes must be a multiple of\n");
+    printf("        %'d bytes. The time spent stamping and validating is reported.\n\n",
+                    VERIFY_BLKSZ);
+
+    printf("        A user file should have been created using 'iops create -verify'.\n");
+#if defined(ALLOW_DISCARD)
+    printf("        Not compatible with '-discard'.\n");
+#endif /* ALLOW_DISCARD */
+    printf("\n");
+
+    printf("    -content <cpat>\n");
+    printf("        The content of the data written. <cpat> is 'zero' (the default) or\n");
+    printf("        'random'. Storage that compresses or deduplicates data will report\n");
+    printf("        unrealistically high write rates for zero filled data. Random data is\n");
+    printf("        regenerated for every write using a fast vectorised generator and the\n");
+    printf("        time taken to do so is reported.\n\n");
+
+    printf("    -compress <cr>\n");
+    printf("        Generate random data that compresses at approximately the ratio\n");
+    printf("        <cr>:1 (for example '2' or '2.5'). Only 1/<cr> of each %'d byte block\n",
+                    CONT_BLKSZ);
+    printf("        is random, the rest is zero. Must be between %.0f and %.0f. Implies\n",
+                    MIN_RATIO, MAX_RATIO);
+    printf("        '-content random'.\n\n");
+
+    printf("    -dedupe <dr>\n");
+    printf("        Generate random data that deduplicates at approximately the ratio\n");
+    printf("        <dr>:1. Only 1/<dr> of the %'d byte blocks written are unique, the\n",
+                    CONT_BLKSZ);
+    printf("        rest are copies of a small pool of blocks. Must be between %.0f and\n",
+                    MIN_RATIO);
+    printf("        %.0f. Implies '-content random'. Note that '-verify' makes every\n",
+                    MAX_RATIO);
+    printf("        block unique.\n\n");
+
+    printf("    -reuse\n");
+    printf("        Keep the test files after the test and reuse them on later runs\n");
+    printf("        instead of generating them again. Each file has a description,\n");
+    printf("        '<file>%s', recording its size, generation block size, content\n",
+                    REUSE_SUFFIX);
+    printf("        and generation time. An existing file is reused only if it matches\n");
+    printf("        the requested size and content, and was generated with '-verify' if\n");
+    printf("        that is specified. Use 'iops cleanup' to remove the files. Not\n");
+    printf("        compatible with a user specified file.\n\n");
+
+#if defined(ALLOW_CLONE)
+    printf("    -clone\n");
+    printf("        Generate only the first per thread test file and populate the others\n");
+    printf("        from it by reflink clone or, if that is not supported, by\n");
+    printf("        copy_file_range(). If neither is supported the files are written as\n");
+    printf("        normal. The time saved, compared with writing every file at the rate\n");
+    printf("        achieved for the first, is reported. Cloned files may share extents\n");
+    printf("        so write results may be affected until all blocks have been\n");
+    printf("        overwritten. Not compatible with '-1file'.\n\n");
+
+#endif /* ALLOW_CLONE */
     printf("    -verbose\n");
     printf("        Displays additional, possibly interesting, information during\n");
-    printf("        execution. Primarily per thread metrics.\n\n");
+    printf("        execution. Primarily per thread metrics, including per thread\n");
+    printf("        latency percentiles if '-latency' is used (per I/O latency is not\n");
+    printf("        otherwise measured). With more than %d threads the per thread\n",
+                    VERBOSE_THREADS);
+    printf("        rates are summarised and only threads that differ from the median\n");
+    printf("        by more than %d%% are listed. For multi-threaded read and write\n",
+                    OUTLIER_PCT);
+    printf("        tests the spread, standard deviation and Jain's fairness index of\n");
+    printf("        the per thread IOPS, and any such outlier threads, are always\n");
+    printf("        reported. With several '-target's they are judged within each\n");
+    printf("        target, followed by the lowest fairness index of any target.\n\n");
 
     printf("The following options are for special usage only. The objective of this tool\n");
     printf("is to measure the performance of storage hardware (as far as is possible\n");
@@ -551,7 +1448,8 @@ usage(
     printf("        any filesystem contention that might arise from multiple threads\n");
     printf("        performing I/O on the same file. When this option is specified, all\n");
     printf("        threads share the same test file. Each thread opens the file separately\n");
-    printf("        but I/O operations are not synchronised between the threads.\n\n");
+    printf("        but I/O operations are not synchronised between the threads. When the\n");
+    printf("        test file is created, each thread writes its own part of it.\n\n");
 
     printf("        Normally the test file is created automatically, but if the optional\n");
     printf("        <usrfpath> value is specified then that pre-existing file is used\n");
@@ -660,6 +1558,57 @@ usage(
     printf("        Not allowed when testing a block or raw device.\n\n");
 #endif /* ALLOW_RAW */
 
+    printf("    -durability <dmode>\n");
+    printf("        Selects how write tests make data durable. The flush operations of\n");
+    printf("        the modes that flush are timed individually and reported as a\n");
+    printf("        latency distribution, and the write and flush contributions to the\n");
+    printf("        measured time are reported separately. <dmode> is one of:\n\n");
+    printf("            dsync     - open the file(s) with O_DSYNC (the default).\n");
+#if defined(ALLOW_RWFDSYNC)
+    printf("            rwfdsync  - request per I/O durability using pwritev2() with\n");
+    printf("                        the RWF_DSYNC flag.\n");
+#endif /* ALLOW_RWFDSYNC */
+#if defined(MACOS)
+    printf("            fdatasync - call fcntl( F_FULLFSYNC ) every <nwr> writes.\n");
+#else /* ! MACOS */
+    printf("            fdatasync - call fdatasync() every <nwr> writes.\n");
+#endif /* ! MACOS */
+    printf("            fsync     - call fsync() every <nwr> writes.\n");
+#if defined(ALLOW_SYNCRANGE)
+    printf("            syncrange - call sync_file_range() on the range written by the\n");
+    printf("                        last <nwr> writes. Note that this does not flush\n");
+    printf("                        the device's write cache.\n");
+#endif /* ALLOW_SYNCRANGE */
+    printf("\n");
+    printf("        All modes other than 'dsync' imply '-nodsync'. Not allowed when\n");
+    printf("        testing a block or raw device.\n\n");
+
+    printf("    -syncint <nwr>\n");
+    printf("        The number of writes between flushes for the 'fdatasync', 'fsync'\n");
+    printf("        and 'syncrange' durability modes. Must be between %'d and %'d, the\n",
+                    MIN_SYNCINT, MAX_SYNCINT);
+    printf("        default is %'d.\n\n", DFLT_SYNCINT);
+
+#if defined(ALLOW_DISCARD)
+    printf("    -discard <dop>\n");
+    printf("        Performs discard (or zeroing) operations of size <tsz> during the write\n");
+    printf("        test, at the offsets that would otherwise have been written. Discard\n");
+    printf("        throughput and latency are reported separately from writes. <dop>\n");
+    printf("        is one of:\n\n");
+    printf("            trim    - BLKDISCARD on a block device.\n");
+    printf("            zeroout - BLKZEROOUT on a block device.\n");
+    printf("            punch   - fallocate( FALLOC_FL_PUNCH_HOLE ) on a file.\n");
+    printf("            zero    - fallocate( FALLOC_FL_ZERO_RANGE ) on a file.\n\n");
+    printf("        Discarding on a block device is subject to the same restrictions as\n");
+    printf("        writing to it (see '-1file').\n\n");
+
+    printf("    -discardpct <pct>\n");
+    printf("        The percentage of write test operations that are discards, the rest\n");
+    printf("        being writes. Must be between %d and %d, the default is %d (a pure\n",
+                    MIN_DISCPCT, MAX_DISCPCT, DFLT_DISCPCT);
+    printf("        discard workload).\n\n");
+
+#endif /* ALLOW_DISCARD */
     printf("    NOTES:\n");
     printf("        - The measured time for write tests includes any fdatasync() operations\n");
     printf("          but not any close() operations.\n\n");
@@ -670,20 +1619,6 @@ usage(
     exit( 100 );
 } // usage
 
-/*
- * Sleep for a specified number of microseconds.
- */
-
-void
-usSleep(
-        unsigned int us
-       )
-{
-    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
-
-    nanosleep( &ts, NULL );
-} // usSleep
-
 /*
  * Return the current time as microseconds since the epoch.
  */
@@ -700,1817 +1635,7604 @@ getTimeAsUs(
 } // getTimeAsUs
 
 /*
- * Convert a string into an integer.
+ * Return the CPU time consumed so far by the calling thread in
+ * microseconds.
  */
 
-int
-intConvert(
-           char * val,
-           int  * ival
-          )
+long
+getThreadCpuUs(
+               void
+              )
 {
-    char * p;
-    int iv, l;
+    struct timespec ts;
 
-    if (  ( val == NULL ) || ( ival == NULL )  )
-        return 1;
+    if (  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts )  )
+        return 0L;
+    return ((long)ts.tv_nsec / 1000L) + (1000000L * (long)ts.tv_sec);
+} // getThreadCpuUs
 
-    l = strlen( val );
-    if ( ( l < 1 ) || ( l > 9 )  )
-        return 1;
+#if defined(ALLOW_PERF)
+/*
+ * Open the calling test thread's performance counters, initially
+ * disabled. Counters that cannot be opened are left at -1.
+ */
 
-    iv = (int)strtol( val, &p, 10 );
-    if (  *p  )
-        return 1;
+void
+perfOpen(
+         context_t * ctxt
+        )
+{
+    struct perf_event_attr attr;
+    int i;
 
-    *ival = iv;
-    return 0;
-} // intConvert
+    for ( i = 0; i < PERF_NEVENTS; i++ )
+    {
+        memset( &attr, 0, sizeof(attr) );
+        attr.size = sizeof(attr);
+        attr.type = perfEvents[i].type;
+        attr.config = perfEvents[i].config;
+        attr.disabled = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        ctxt->perffd[i] = (int)syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+        if (  (ctxt->perffd[i] < 0) && ((errno == EACCES) || (errno == EPERM))  )
+        {
+            attr.exclude_kernel = 1;
+            ctxt->perffd[i] = (int)syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+            if (  ctxt->perffd[i] >= 0  )
+                perfUserOnly = 1;
+        }
+        // keep the first failure of each counter to report with it
+        if (  (ctxt->perffd[i] < 0) && (perfErrno[i] == 0)  )
+            perfErrno[i] = errno;
+    }
+} // perfOpen
 
 /*
- * Convert a string into a long integer.
+ * Close the calling test thread's performance counters.
  */
 
-int
-longConvert(
-            char * val,
-            long * lval
-           )
+void
+perfClose(
+          context_t * ctxt
+         )
 {
-    char * p;
-    int l;
-    long lv;
+    int i;
 
-    if (  ( val == NULL ) || ( lval == NULL )  )
-        return 1;
+    for ( i = 0; i < PERF_NEVENTS; i++ )
+        if (  ctxt->perffd[i] >= 0  )
+        {
+            close( ctxt->perffd[i] );
+            ctxt->perffd[i] = -1;
+        }
+} // perfClose
+#endif /* ALLOW_PERF */
 
-    l = strlen( val );
-    if ( ( l < 1 ) || ( l > 18 )  )
-        return 1;
+/*
+ * Reset and enable the calling test thread's performance counters at the
+ * start of measurement.
+ */
 
-    lv = strtol( val, &p, 10 );
-    if (  *p  )
-        return 1;
+void
+perfStart(
+          context_t * ctxt
+         )
+{
+#if defined(ALLOW_PERF)
+    int i;
 
-    *lval = lv;
-    return 0;
-} // longConvert
+    if (  ! ctxt->perf  )
+        return;
+    for ( i = 0; i < PERF_NEVENTS; i++ )
+        if (  ctxt->perffd[i] >= 0  )
+        {
+            ioctl( ctxt->perffd[i], PERF_EVENT_IOC_RESET, 0 );
+            ioctl( ctxt->perffd[i], PERF_EVENT_IOC_ENABLE, 0 );
+        }
+#endif /* ALLOW_PERF */
+} // perfStart
 
 /*
- * Convert a string into a long integer. Allows use of k, m and g suffixes.
+ * Disable the calling test thread's performance counters at the end of
+ * measurement and save their values, scaled up if the kernel had to
+ * multiplex them. Unavailable counters are saved as -1.
  */
 
-int
-valueConvert(
-             char * val,
-             long * lval
-            )
+void
+perfStop(
+         context_t * ctxt,
+         long        counts[]
+        )
 {
-    int l;
-    char * p;
-    long multiplier = 1, lv;
+#if defined(ALLOW_PERF)
+    uint64_t val[3];
+    int i;
 
-    if (  ( val == NULL ) || ( lval == NULL )  )
-        return 1;
+    if (  ! ctxt->perf  )
+        return;
+    for ( i = 0; i < PERF_NEVENTS; i++ )
+    {
+        counts[i] = -1L;
+        if (  ctxt->perffd[i] < 0  )
+            continue;
+        ioctl( ctxt->perffd[i], PERF_EVENT_IOC_DISABLE, 0 );
+        if (  (read( ctxt->perffd[i], val, sizeof(val) ) == (ssize_t)sizeof(val)) &&
+              (val[2] > 0)  )
+            counts[i] = (long)((double)val[0] * ((double)val[1] / (double)val[2]));
+    }
+#endif /* ALLOW_PERF */
+} // perfStop
 
-    l = strlen( val );
-    if ( l < 1  )
-        return 1;
+/*
+ * Wake any test threads waiting for a phase to start.
+ */
 
-    p = val + l - 1;
-    switch (  *p  )
-    {
-        case 'K':
-        case 'k':
-            multiplier = KB_MULT;
-            *p = '\0';
-            l -= 1;
-            break;
+void
+postStart(
+          void
+         )
+{
+    pthread_mutex_lock( &phaseLock );
+    pthread_cond_broadcast( &startCond );
+    pthread_mutex_unlock( &phaseLock );
+} // postStart
 
-        case 'M':
-        case 'm':
-            multiplier = MB_MULT;
-            *p = '\0';
-            l -= 1;
+/*
+ * Wait for the coordinator to start a phase or to stop the test. The
+ * caller rechecks its start flag so spurious wakeups are harmless.
+ */
+
+void
+waitStart(
+          context_t  * ctxt,
+          ATOMIC int * start
+         )
+{
+    pthread_mutex_lock( &phaseLock );
+    if (  ! *start && (ctxt->tstate != STOP)  )
+        pthread_cond_wait( &startCond, &phaseLock );
+    pthread_mutex_unlock( &phaseLock );
+} // waitStart
+
+/*
+ * Tell the coordinator that a test thread has changed state.
+ */
+
+void
+postEvent(
+          void
+         )
+{
+    pthread_mutex_lock( &phaseLock );
+    eventSeq++;
+    pthread_cond_signal( &eventCond );
+    pthread_mutex_unlock( &phaseLock );
+} // postEvent
+
+/*
+ * Return the current event sequence number.
+ */
+
+unsigned long
+getEventSeq(
+            void
+           )
+{
+    unsigned long seq;
+
+    pthread_mutex_lock( &phaseLock );
+    seq = eventSeq;
+    pthread_mutex_unlock( &phaseLock );
+
+    return seq;
+} // getEventSeq
+
+/*
+ * Wait until a test thread changes state after 'seq' was obtained or
+ * the deadline (µs since the epoch, 0 for none) is reached. The wait is
+ * capped at WAIT_MAX_US so that signals are still noticed promptly.
+ */
+
+void
+waitEvent(
+          unsigned long seq,
+          long          deadline
+         )
+{
+    struct timespec ts;
+    long now, until;
+
+    now = getTimeAsUs();
+    until = now + WAIT_MAX_US;
+    if (  deadline && (deadline < until)  )
+        until = deadline;
+    if (  until <= now  )
+        return;
+    ts.tv_sec = until / 1000000;
+    ts.tv_nsec = (until % 1000000) * 1000;
+
+    pthread_mutex_lock( &phaseLock );
+    while (  eventSeq == seq  )
+        if (  pthread_cond_timedwait( &eventCond, &phaseLock, &ts ) == ETIMEDOUT  )
             break;
+    pthread_mutex_unlock( &phaseLock );
+} // waitEvent
 
-        case 'G':
-        case 'g':
-            multiplier = GB_MULT;
-            *p = '\0';
-            l -= 1;
+/*
+ * Map a latency value (µs) to its histogram bucket.
+ */
+
+int
+histBucket(
+           long us
+          )
+{
+    int msb = 0;
+
+    if (  us < (2 * HIST_SUBBKTS)  )
+        return (us < 0) ? 0 : (int)us;
+
+    while (  (msb < HIST_MAXBIT) && (us >> (msb + 1))  )
+        msb += 1;
+    if (  (us >> (msb + 1))  )
+        return HIST_BUCKETS - 1;
+
+    return ((msb - HIST_SUBBITS + 1) * HIST_SUBBKTS) +
+           (int)((us >> (msb - HIST_SUBBITS)) & (HIST_SUBBKTS - 1));
+} // histBucket
+
+/*
+ * Return the (mid point) value represented by a histogram bucket.
+ */
+
+long
+histBucketValue(
+                int bucket
+               )
+{
+    int msb, sub;
+    long width;
+
+    if (  bucket < (2 * HIST_SUBBKTS)  )
+        return (long)bucket;
+
+    msb = (bucket / HIST_SUBBKTS) + HIST_SUBBITS - 1;
+    sub = bucket % HIST_SUBBKTS;
+    width = 1L << (msb - HIST_SUBBITS);
+
+    return ((long)(HIST_SUBBKTS + sub) * width) + (width / 2);
+} // histBucketValue
+
+/*
+ * Record a latency value (µs) in a histogram.
+ */
+
+void
+histRecord(
+           histogram_t * hist,
+           long          us
+          )
+{
+    if (  (hist->count == 0) || (us < hist->minus)  )
+        hist->minus = us;
+    if (  us > hist->maxus  )
+        hist->maxus = us;
+    hist->count += 1;
+    hist->totalus += us;
+    hist->bucket[histBucket( us )] += 1;
+} // histRecord
+
+/*
+ * Merge one histogram into another.
+ */
+
+void
+histMerge(
+          histogram_t * dst,
+          histogram_t * src
+         )
+{
+    int i;
+
+    if (  src->count == 0  )
+        return;
+    if (  (dst->count == 0) || (src->minus < dst->minus)  )
+        dst->minus = src->minus;
+    if (  src->maxus > dst->maxus  )
+        dst->maxus = src->maxus;
+    dst->count += src->count;
+    dst->totalus += src->totalus;
+    for ( i = 0; i < HIST_BUCKETS; i++ )
+        dst->bucket[i] += src->bucket[i];
+} // histMerge
+
+/*
+ * Return the approximate value (µs) at a given percentile.
+ */
+
+long
+histPercentile(
+               histogram_t * hist,
+               double        pct
+              )
+{
+    int i;
+    long target, seen = 0, val;
+
+    if (  hist->count == 0  )
+        return 0L;
+
+    target = (long)(((double)hist->count * pct) / 100.0);
+    if (  target >= hist->count  )
+        target = hist->count - 1;
+    for ( i = 0; i < HIST_BUCKETS; i++ )
+    {
+        seen += hist->bucket[i];
+        if (  seen > target  )
             break;
     }
-    if ( l < 1  )
-        return 1;
+    val = histBucketValue( i );
+    if (  val < hist->minus  )
+        val = hist->minus;
+    if (  val > hist->maxus  )
+        val = hist->maxus;
 
-    lv = strtol( val, &p, 10 );
-    if (  *p  )
-        return 1;
-    
-    *lval = (lv * multiplier);
-    return 0;
-} // valueConvert
+    return val;
+} // histPercentile
 
 /*
- * Parse and validate the command line arguments.
+ * Display a one line latency summary for a histogram.
  */
 
-int
-parseArgs(
-          int    argc,
-          int    argno,
-          char * argv[],
-          context_t * ctxt
+void
+reportHistogram(
+                char        * label,
+                histogram_t * hist
+               )
+{
+    if (  hist->count == 0  )
+        return;
+
+    printf("%s latency: min = %'ld µs, avg = %'ld µs, p50 = %'ld µs, p90 = %'ld µs,\n",
+           label, hist->minus, hist->totalus / hist->count,
+           histPercentile( hist, 50.0 ), histPercentile( hist, 90.0 ) );
+    printf("    p99 = %'ld µs, p99.9 = %'ld µs, max = %'ld µs\n",
+           histPercentile( hist, 99.0 ), histPercentile( hist, 99.9 ), hist->maxus );
+} // reportHistogram
+
+/*
+ * Return the display name of a durability mode.
+ */
+
+char *
+durabilityName(
+               int durability
+              )
+{
+    switch (  durability  )
+    {
+        case DUR_DSYNC:
+            return "dsync";
+        case DUR_RWFDSYNC:
+            return "rwfdsync";
+        case DUR_FDATASYNC:
+            return "fdatasync";
+        case DUR_FSYNC:
+            return "fsync";
+        case DUR_SYNCRANGE:
+            return "syncrange";
+    }
+
+    return "unknown";
+} // durabilityName
+
+/*
+ * Return the name of the call that flushes writes in a durability mode.
+ * On macOS fdatasync() does not reach stable storage so F_FULLFSYNC is
+ * used instead.
+ */
+
+char *
+flushCallName(
+              int durability
+             )
+{
+    switch (  durability  )
+    {
+        case DUR_FDATASYNC:
+#if defined(LINUX) || defined(SOLARIS)
+            return "fdatasync()";
+#else /* MACOS */
+            return "fcntl( F_FULLFSYNC )";
+#endif /* MACOS */
+        case DUR_FSYNC:
+            return "fsync()";
+        case DUR_SYNCRANGE:
+            return "sync_file_range()";
+    }
+
+    return durabilityName( durability );
+} // flushCallName
+
+/*
+ * Return the display name of a discard operation.
+ */
+
+char *
+discardName(
+            int discard
+           )
+{
+    switch (  discard  )
+    {
+        case DISC_TRIM:
+            return "trim";
+        case DISC_ZEROOUT:
+            return "zeroout";
+        case DISC_PUNCH:
+            return "punch";
+        case DISC_ZERO:
+            return "zero";
+    }
+
+    return "none";
+} // discardName
+
+/*
+ * Return the name of a test file cloning method.
+ */
+
+char *
+cloneName(
+          int method
          )
 {
-    int foundFile = 0, foundFsize = 0, foundIosz = 0, foundVerbose = 0, found1file = 0;
-    int foundNoread = 0, foundNowrite = 0;
-    int foundGeniosz = 0, foundNopreallocate = 0, foundRdahead = 0, foundUsrfile = 0;
-    int foundCache = 0, foundNodsync = 0, foundNofsync = 0, foundThreads = 0;
-    int foundCpu = 0, foundDur = 0, foundRamp = 0, foundRawwrite = 0;
-    long long fsz;
-    struct stat sbuf;
-#if defined( ALLOW_RAW )
-    int fd;
-#endif /* ALLOW_RAW */
+    switch (  method  )
+    {
+        case CLONE_REFLINK:
+            return "reflink";
+        case CLONE_COPY:
+            return "copy_file_range";
+        case CLONE_WRITE:
+            return "writes";
+    }
 
-    while (  argno < argc  )
+    return "none";
+} // cloneName
+
+/*
+ * Return the display name of a thread placement policy.
+ */
+
+char *
+affinityName(
+             int affinity
+            )
+{
+    switch (  affinity  )
     {
-        if (  strcmp( argv[argno], "-nopreallocate" ) == 0  )
+        case AFF_LIST:
+            return "a CPU list";
+        case AFF_COMPACT:
+            return "compact";
+        case AFF_SPREAD:
+            return "spread";
+        case AFF_DEVICE:
+            return "device local";
+    }
+
+    return "none";
+} // affinityName
+
+/*
+ * Software CRC32C (Castagnoli) using slicing-by-8.
+ */
+
+uint32_t
+crc32cSoft(
+           uint32_t     crc,
+           const void * buf,
+           size_t       len
+          )
+{
+    const unsigned char * p = (const unsigned char *)buf;
+    uint32_t lo, hi;
+
+    crc = ~crc;
+    while (  len && ((uintptr_t)p & 7)  )
+    {
+        crc = crc32cTable[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len -= 1;
+    }
+    while (  len >= 8  )
+    {
+        // assumes a little endian host
+        lo = *(const uint32_t *)p ^ crc;
+        hi = *(const uint32_t *)(p + 4);
+        crc = crc32cTable[7][lo & 0xff] ^ crc32cTable[6][(lo >> 8) & 0xff] ^
+              crc32cTable[5][(lo >> 16) & 0xff] ^ crc32cTable[4][lo >> 24] ^
+              crc32cTable[3][hi & 0xff] ^ crc32cTable[2][(hi >> 8) & 0xff] ^
+              crc32cTable[1][(hi >> 16) & 0xff] ^ crc32cTable[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (  len  )
+    {
+        crc = crc32cTable[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len -= 1;
+    }
+
+    return ~crc;
+} // crc32cSoft
+
+/*
+ * Advance a (raw) CRC32C state over CRC32C_STRIDE zero bytes. This allows
+ * CRCs computed independently over adjacent strides to be combined.
+ */
+
+uint32_t
+crc32cShiftStride(
+                  uint32_t crc
+                 )
+{
+    return crc32cShift[0][crc & 0xff] ^ crc32cShift[1][(crc >> 8) & 0xff] ^
+           crc32cShift[2][(crc >> 16) & 0xff] ^ crc32cShift[3][crc >> 24];
+} // crc32cShiftStride
+
+#if defined(CRC32C_X86)
+
+/*
+ * CRC32C using the SSE 4.2 crc32 instruction.
+ */
+
+__attribute__((target("sse4.2")))
+uint32_t
+crc32cHard(
+           uint32_t     crc,
+           const void * buf,
+           size_t       len
+          )
+{
+    const unsigned char * p = (const unsigned char *)buf;
+    uint64_t crc64;
+
+    crc = ~crc;
+    while (  len && ((uintptr_t)p & 7)  )
+    {
+        crc = _mm_crc32_u8( crc, *p++ );
+        len -= 1;
+    }
+    crc64 = crc;
+    // three independent streams hide the latency of the crc32 instruction
+    while (  len >= (3 * CRC32C_STRIDE)  )
+    {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char * end = p + CRC32C_STRIDE;
+
+        while (  p < end  )
         {
-            if (  foundNopreallocate  )
-            {
-                fprintf( stderr, "\n*** Multiple '-nopreallocate' options not allowed\n" );
-                return 1;
-            }
-            if (  foundUsrfile )
-            {
-                fprintf( stderr, "\n*** '-nopreallocate' is incompatible with a user specified filename\n" );
-                return 1;
-            }
-            ctxt->nopreallocate = foundNopreallocate = 1;
+            crc64 = _mm_crc32_u64( crc64, *(const uint64_t *)p );
+            crc1 = _mm_crc32_u64( crc1, *(const uint64_t *)(p + CRC32C_STRIDE) );
+            crc2 = _mm_crc32_u64( crc2, *(const uint64_t *)(p + (2 * CRC32C_STRIDE)) );
+            p += 8;
         }
-        else
-#if defined(MACOS)
-        if (  strcmp( argv[argno], "-rdahead" ) == 0  )
+        crc64 = crc32cShiftStride( crc32cShiftStride( (uint32_t)crc64 ) ^ (uint32_t)crc1 ) ^
+                (uint32_t)crc2;
+        p += 2 * CRC32C_STRIDE;
+        len -= 3 * CRC32C_STRIDE;
+    }
+    while (  len >= 8  )
+    {
+        crc64 = _mm_crc32_u64( crc64, *(const uint64_t *)p );
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+    while (  len  )
+    {
+        crc = _mm_crc32_u8( crc, *p++ );
+        len -= 1;
+    }
+
+    return ~crc;
+} // crc32cHard
+
+#elif defined(CRC32C_ARM)
+
+/*
+ * CRC32C using the ARMv8 crc32c instructions.
+ */
+
+uint32_t
+crc32cHard(
+           uint32_t     crc,
+           const void * buf,
+           size_t       len
+          )
+{
+    const unsigned char * p = (const unsigned char *)buf;
+
+    crc = ~crc;
+    while (  len && ((uintptr_t)p & 7)  )
+    {
+        crc = __crc32cb( crc, *p++ );
+        len -= 1;
+    }
+    // three independent streams hide the latency of the crc32c instruction
+    while (  len >= (3 * CRC32C_STRIDE)  )
+    {
+        uint32_t crc1 = 0, crc2 = 0;
+        const unsigned char * end = p + CRC32C_STRIDE;
+
+        while (  p < end  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundRdahead  )
-            {
-                fprintf( stderr, "\n*** Multiple '-rdahead' options not allowed\n" );
-                return 1;
-            }
-            ctxt->rdahead = foundRdahead = 1;
-        }
-        else
-#endif /* MACOS */
-        if (  strcmp( argv[argno], "-1file" ) == 0  )
-        {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  found1file  )
-            {
-                fprintf( stderr, "\n*** Multiple '-1file' options not allowed\n" );
-                return 1;
-            }
-            ctxt->onefile = found1file = 1;
-            if (  ((argno+1) < argc) && (argv[argno+1][0] != '-')  )
-            {
-                if (  foundFile )
-                {
-                    fprintf( stderr, "\n*** A user specified filename is incompatible with '-file'\n" );
-                    return 1;
-                }
-                if (  foundGeniosz  )
-                {
-                    fprintf( stderr, "\n*** A user specified filename is incompatible with '-geniosz'\n" );
-                    return 1;
-                }
-                ctxt->fname = argv[++argno];
-                ctxt->usrfile = foundUsrfile = 1;
-            }
+            crc = __crc32cd( crc, *(const uint64_t *)p );
+            crc1 = __crc32cd( crc1, *(const uint64_t *)(p + CRC32C_STRIDE) );
+            crc2 = __crc32cd( crc2, *(const uint64_t *)(p + (2 * CRC32C_STRIDE)) );
+            p += 8;
         }
-        else
-#if defined(ALLOW_RAW) && defined(ALLOW_RAWWRITE)
-        if (  strcmp( argv[argno], "-rawWrite" ) == 0  )
+        crc = crc32cShiftStride( crc32cShiftStride( crc ) ^ crc1 ) ^ crc2;
+        p += 2 * CRC32C_STRIDE;
+        len -= 3 * CRC32C_STRIDE;
+    }
+    while (  len >= 8  )
+    {
+        crc = __crc32cd( crc, *(const uint64_t *)p );
+        p += 8;
+        len -= 8;
+    }
+    while (  len  )
+    {
+        crc = __crc32cb( crc, *p++ );
+        len -= 1;
+    }
+
+    return ~crc;
+} // crc32cHard
+
+#endif /* CRC32C_ARM */
+
+/*
+ * Build the software CRC32C tables and select the fastest implementation
+ * available on this CPU. Returns 1 if a hardware implementation is used.
+ */
+
+int
+crc32cInit(
+           void
+          )
+{
+    int i, j, k;
+    uint32_t crc;
+
+    for ( i = 0; i < 256; i++ )
+    {
+        crc = (uint32_t)i;
+        for ( j = 0; j < 8; j++ )
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32C_POLY) : (crc >> 1);
+        crc32cTable[0][i] = crc;
+    }
+    for ( i = 0; i < 256; i++ )
+        for ( j = 1; j < 8; j++ )
+            crc32cTable[j][i] = (crc32cTable[j-1][i] >> 8) ^
+                                crc32cTable[0][crc32cTable[j-1][i] & 0xff];
+
+    for ( i = 0; i < 4; i++ )
+        for ( j = 0; j < 256; j++ )
         {
-            if (  foundRawwrite  )
-            {
-                fprintf( stderr, "\n*** Multiple '-rawWrite' options not allowed\n" );
-                return 1;
-            }
-            foundRawwrite = 1;
-            if (  ctxt->rawwrite < 0  )
-                ctxt->rawwrite = 1;
-            else
-            {
-                fprintf( stderr, "\n*** Writing to block and raw devices is not enabled\n" );
-                return 1;
-            }
+            crc = (uint32_t)j << (8 * i);
+            for ( k = 0; k < CRC32C_STRIDE; k++ )
+                crc = crc32cTable[0][crc & 0xff] ^ (crc >> 8);
+            crc32cShift[i][j] = crc;
         }
+
+    crc32cFunc = crc32cSoft;
+#if defined(CRC32C_X86)
+    __builtin_cpu_init();
+    if (  __builtin_cpu_supports( "sse4.2" )  )
+        crc32cFunc = crc32cHard;
+#elif defined(CRC32C_ARM)
+    crc32cFunc = crc32cHard;
+#endif /* CRC32C_ARM */
+
+    return ( crc32cFunc != crc32cSoft );
+} // crc32cInit
+
+/*
+ * Stamp every verification block in 'buf', which is to be written at
+ * file offset 'offset', with its identity and checksum.
+ */
+
+void
+stampBlocks(
+            context_t * ctxt,
+            void      * buf,
+            long        len,
+            long        offset
+           )
+{
+    unsigned char * blk = (unsigned char *)buf;
+    vhdr_t * hdr;
+    long pos;
+
+    for ( pos = 0; (pos + VERIFY_BLKSZ) <= len; pos += VERIFY_BLKSZ )
+    {
+        hdr = (vhdr_t *)(blk + pos);
+        hdr->magic = VERIFY_MAGIC;
+        hdr->reserved = 0;
+        hdr->offset = (uint64_t)(offset + pos);
+        hdr->generation = (uint64_t)ctxt->vgen;
+        hdr->seed = (uint64_t)ctxt->vseed;
+        *(uint32_t *)(blk + pos + VERIFY_BLKSZ - sizeof(uint32_t)) =
+            crc32cFunc( 0, blk + pos, VERIFY_BLKSZ - sizeof(uint32_t) );
+    }
+} // stampBlocks
+
+/*
+ * Validate every verification block in 'buf', which was read from file
+ * offset 'offset'. The seed is only checked for files generated by this
+ * run since a user file may have been stamped by an earlier one.
+ */
+
+int
+verifyBlocks(
+             context_t * ctxt,
+             void      * buf,
+             long        len,
+             long        offset
+            )
+{
+    unsigned char * blk = (unsigned char *)buf;
+    vhdr_t * hdr;
+    char * reason = NULL;
+    long pos;
+
+    for ( pos = 0; (pos + VERIFY_BLKSZ) <= len; pos += VERIFY_BLKSZ )
+    {
+        hdr = (vhdr_t *)(blk + pos);
+        if (  hdr->magic != VERIFY_MAGIC  )
+            reason = "bad magic";
         else
-#endif /* ALLOW_RAW && ALLOW_RAWWRITE */
-        if (  strcmp( argv[argno], "-cpu" ) == 0  )
-        {
-            if (  foundCpu  )
-            {
-                fprintf( stderr, "\n*** Multiple '-cpu' options not allowed\n" );
-                return 1;
-            }
-            ctxt->reportcpu = foundCpu = 1;
-        }
+        if (  hdr->offset != (uint64_t)(offset + pos)  )
+            reason = "misplaced block";
         else
-        if (  strcmp( argv[argno], "-noread" ) == 0  )
-        {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundNoread  )
-            {
-                fprintf( stderr, "\n*** Multiple '-noread' options not allowed\n" );
-                return 1;
-            }
-            if (  foundNowrite  )
-            {
-                fprintf( stderr, "\n*** '-noread' and '-nowrite' are mutually exclusive\n" );
-                return 1;
-            }
-            ctxt->noread = foundNoread = 1;
-        }
+        if (  ! ctxt->usrfile && (hdr->seed != (uint64_t)ctxt->vseed)  )
+            reason = "stale block";
         else
-        if (  strcmp( argv[argno], "-nowrite" ) == 0  )
+        if (  *(uint32_t *)(blk + pos + VERIFY_BLKSZ - sizeof(uint32_t)) !=
+              crc32cFunc( 0, blk + pos, VERIFY_BLKSZ - sizeof(uint32_t) )  )
+            reason = "checksum mismatch";
+        if (  reason != NULL  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundNowrite  )
-            {
-                fprintf( stderr, "\n*** Multiple '-nowrite' options not allowed\n" );
-                return 1;
-            }
-            if (  foundNoread  )
-            {
-                fprintf( stderr, "\n*** '-noread' and '-nowrite' are mutually exclusive\n" );
-                return 1;
-            }
-            ctxt->nowrite = foundNowrite = 1;
+            sprintf( ctxt->msgbuff, "%serification failed at offset %'ld - %s (offset %'ld, generation %ld)",
+                     (ctxt->threads>1)?"v":"V", offset + pos, reason,
+                     (long)hdr->offset, (long)hdr->generation );
+            return 1;
         }
+        ctxt->nverified++;
+    }
+
+    return 0;
+} // verifyBlocks
+
+/*
+ * Stamp the I/O buffer prior to writing it at 'offset', accounting the
+ * time taken while measuring.
+ */
+
+void
+stampIO(
+        context_t * ctxt,
+        long        offset,
+        int         measuring
+       )
+{
+    long startus;
+
+    if (  ! measuring  )
+    {
+        stampBlocks( ctxt, ctxt->ioblk, ctxt->iosz, offset );
+        return;
+    }
+    startus = getTimeAsUs();
+    stampBlocks( ctxt, ctxt->ioblk, ctxt->iosz, offset );
+    ctxt->verifyus += getTimeAsUs() - startus;
+} // stampIO
+
+/*
+ * Verify the I/O buffer after reading it from 'offset', accounting the
+ * time taken while measuring.
+ */
+
+int
+verifyIO(
+         context_t * ctxt,
+         long        offset,
+         int         measuring
+        )
+{
+    int ret;
+    long startus;
+
+    if (  ! measuring  )
+        return verifyBlocks( ctxt, ctxt->ioblk, ctxt->iosz, offset );
+    startus = getTimeAsUs();
+    ret = verifyBlocks( ctxt, ctxt->ioblk, ctxt->iosz, offset );
+    ctxt->verifyus += getTimeAsUs() - startus;
+
+    return ret;
+} // verifyIO
+
+/*
+ * Seed a context's random content generator.
+ */
+
+void
+seedRandom(
+           context_t * ctxt,
+           uint64_t    seed
+          )
+{
+    int i;
+
+    // splitmix64 to spread the seed across the lanes
+    for ( i = 0; i <= RNG_LANES; i++ )
+    {
+        uint64_t z;
+
+        seed += 0x9e3779b97f4a7c15ULL;
+        z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= (z >> 31);
+        if (  z == 0  )
+            z = 1;
+        if (  i < RNG_LANES  )
+            ctxt->rng[i] = z;
         else
-        if (  strcmp( argv[argno], "-verbose" ) == 0  )
+            ctxt->rngsel = z;
+    }
+} // seedRandom
+
+/*
+ * Return the next value from a context's scalar random generator.
+ */
+
+uint64_t
+nextRandom(
+           context_t * ctxt
+          )
+{
+    uint64_t x = ctxt->rngsel;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    ctxt->rngsel = x;
+
+    return x;
+} // nextRandom
+
+/*
+ * Fill 'buf' with 'len' bytes of incompressible data. The generator is
+ * RNG_LANES independent xorshift64 streams which the compiler maps onto
+ * SIMD registers; 'buf' must be suitably aligned.
+ */
+
+void
+genRandom(
+          context_t * ctxt,
+          void      * buf,
+          long        len
+         )
+{
+    uint64_t * out = (uint64_t *)buf;
+    uint64_t x;
+    long n;
+    int i;
+#if defined(__GNUC__)
+    rngvec_t v, * vout = (rngvec_t *)buf;
+
+    memcpy( (void *)&v, (void *)ctxt->rng, sizeof(v) );
+    for ( n = len / (long)sizeof(rngvec_t); n > 0; n-- )
+    {
+        v ^= v << 13;
+        v ^= v >> 7;
+        v ^= v << 17;
+        *vout++ = v;
+    }
+    memcpy( (void *)ctxt->rng, (void *)&v, sizeof(v) );
+    out = (uint64_t *)vout;
+    len %= (long)sizeof(rngvec_t);
+#else /* ! __GNUC__ */
+    for ( ; len >= (long)(RNG_LANES * sizeof(uint64_t)); len -= RNG_LANES * sizeof(uint64_t) )
+        for ( i = 0; i < RNG_LANES; i++ )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundVerbose  )
-            {
-                fprintf( stderr, "\n*** Multiple '-verbose' options not allowed\n" );
-                return 1;
-            }
-            ctxt->verbose = foundVerbose = 1;
+            x = ctxt->rng[i];
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            ctxt->rng[i] = x;
+            *out++ = x;
         }
-        else
-        if (  strcmp( argv[argno], "-cache" ) == 0  )
+#endif /* ! __GNUC__ */
+    for ( i = 0; len > 0; i++ )
+    {
+        x = nextRandom( ctxt );
+        memcpy( (void *)out, (void *)&x, (len < 8) ? len : 8 );
+        out += 1;
+        len -= 8;
+    }
+} // genRandom
+
+/*
+ * Fill a buffer with fresh content according to the content settings.
+ * Each CONT_BLKSZ block is either a copy of a block from the dedupe pool
+ * or new random data of which only 1/compress is random, the rest zero.
+ */
+
+void
+fillBuffer(
+           context_t * ctxt,
+           void      * buf,
+           long        len
+          )
+{
+    unsigned char * blk = (unsigned char *)buf;
+    long pos, rndlen, blklen;
+    uint64_t uniq;
+
+    if (  ctxt->content == CONT_ZERO  )
+        return;
+
+    rndlen = (long)((double)CONT_BLKSZ / ctxt->compress);
+    rndlen = (rndlen + 63) & ~63L;
+    if (  rndlen > CONT_BLKSZ  )
+        rndlen = CONT_BLKSZ;
+    uniq = (uint64_t)(10000.0 / ctxt->dedupe);
+
+    for ( pos = 0; pos < len; pos += CONT_BLKSZ )
+    {
+        blklen = ((len - pos) < CONT_BLKSZ) ? (len - pos) : CONT_BLKSZ;
+        if (  (dedupePool != NULL) && ((nextRandom( ctxt ) % 10000) >= uniq)  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundCache  )
-            {
-                fprintf( stderr, "\n*** Multiple '-cache' options not allowed\n" );
-                return 1;
-            }
-            ctxt->cache = foundCache = 1;
+            memcpy( (void *)(blk + pos),
+                    (char *)dedupePool + ((nextRandom( ctxt ) % DEDUPE_POOL) * CONT_BLKSZ),
+                    blklen );
+            continue;
         }
+        if (  blklen <= rndlen  )
+            genRandom( ctxt, blk + pos, blklen );
         else
-        if (  strcmp( argv[argno], "-nodsync" ) == 0  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundNodsync  )
-            {
-                fprintf( stderr, "\n*** Multiple '-nodsync' options not allowed\n" );
-                return 1;
-            }
-            ctxt->nodsync = foundNodsync = 1;
+            genRandom( ctxt, blk + pos, rndlen );
+            memset( (void *)(blk + pos + rndlen), 0, blklen - rndlen );
         }
-        else
-        if (  strcmp( argv[argno], "-nofsync" ) == 0  )
-        {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundNofsync  )
+    }
+} // fillBuffer
+
+/*
+ * Generate the shared pool of blocks from which duplicate blocks are
+ * drawn when a dedupe ratio is requested.
+ */
+
+int
+initDedupePool(
+               context_t * ctxt
+              )
+{
+    void * pool = valloc( DEDUPE_POOL * CONT_BLKSZ );
+
+    if (  pool == NULL  )
+    {
+        fprintf( stderr, "*** Unable to valloc %'d bytes\n", DEDUPE_POOL * CONT_BLKSZ );
+        return 1;
+    }
+    fillBuffer( ctxt, pool, DEDUPE_POOL * CONT_BLKSZ );
+    dedupePool = pool;
+
+    return 0;
+} // initDedupePool
+
+/*
+ * Refresh the I/O buffer prior to a write, accounting the time taken
+ * while measuring.
+ */
+
+void
+fillIO(
+       context_t * ctxt,
+       int         measuring
+      )
+{
+    long startus;
+
+    if (  ! measuring  )
+    {
+        fillBuffer( ctxt, ctxt->ioblk, ctxt->iosz );
+        return;
+    }
+    startus = getTimeAsUs();
+    fillBuffer( ctxt, ctxt->ioblk, ctxt->iosz );
+    ctxt->contentus += getTimeAsUs() - startus;
+} // fillIO
+
+/*
+ * Convert a string into an integer.
+ */
+
+int
+intConvert(
+           char * val,
+           int  * ival
+          )
+{
+    char * p;
+    int iv, l;
+
+    if (  ( val == NULL ) || ( ival == NULL )  )
+        return 1;
+
+    l = strlen( val );
+    if ( ( l < 1 ) || ( l > 9 )  )
+        return 1;
+
+    iv = (int)strtol( val, &p, 10 );
+    if (  *p  )
+        return 1;
+
+    *ival = iv;
+    return 0;
+} // intConvert
+
+/*
+ * Convert a string into a long integer.
+ */
+
+int
+longConvert(
+            char * val,
+            long * lval
+           )
+{
+    char * p;
+    int l;
+    long lv;
+
+    if (  ( val == NULL ) || ( lval == NULL )  )
+        return 1;
+
+    l = strlen( val );
+    if ( ( l < 1 ) || ( l > 18 )  )
+        return 1;
+
+    lv = strtol( val, &p, 10 );
+    if (  *p  )
+        return 1;
+
+    *lval = lv;
+    return 0;
+} // longConvert
+
+/*
+ * Convert a string into a long integer. Allows use of k, m and g suffixes.
+ */
+
+int
+valueConvert(
+             char * val,
+             long * lval
+            )
+{
+    int l;
+    char * p;
+    long multiplier = 1, lv;
+
+    if (  ( val == NULL ) || ( lval == NULL )  )
+        return 1;
+
+    l = strlen( val );
+    if ( l < 1  )
+        return 1;
+
+    p = val + l - 1;
+    switch (  *p  )
+    {
+        case 'K':
+        case 'k':
+            multiplier = KB_MULT;
+            *p = '\0';
+            l -= 1;
+            break;
+
+        case 'M':
+        case 'm':
+            multiplier = MB_MULT;
+            *p = '\0';
+            l -= 1;
+            break;
+
+        case 'G':
+        case 'g':
+            multiplier = GB_MULT;
+            *p = '\0';
+            l -= 1;
+            break;
+    }
+    if ( l < 1  )
+        return 1;
+
+    lv = strtol( val, &p, 10 );
+    if (  *p  )
+        return 1;
+    
+    *lval = (lv * multiplier);
+    return 0;
+} // valueConvert
+
+/*
+ * Convert a string into a ratio (a decimal value such as '2' or '2.5').
+ */
+
+int
+ratioConvert(
+             char   * val,
+             double * dval
+            )
+{
+    char * p;
+    double dv;
+
+    if (  ( val == NULL ) || ( dval == NULL )  )
+        return 1;
+
+    if (  ( strlen( val ) < 1 ) || ( strlen( val ) > 9 )  )
+        return 1;
+
+    dv = strtod( val, &p );
+    if (  *p  )
+        return 1;
+    if (  (dv < MIN_RATIO) || (dv > MAX_RATIO)  )
+        return 1;
+
+    *dval = dv;
+    return 0;
+} // ratioConvert
+
+/*
+ * Parse and validate the command line arguments.
+ */
+
+int
+parseArgs(
+          int    argc,
+          int    argno,
+          char * argv[],
+          context_t * ctxt
+         )
+{
+    int foundFile = 0, foundFsize = 0, foundIosz = 0, foundVerbose = 0, found1file = 0;
+    int foundNoread = 0, foundNowrite = 0;
+    int foundGeniosz = 0, foundNopreallocate = 0, foundRdahead = 0, foundUsrfile = 0;
+    int foundCache = 0, foundNodsync = 0, foundNofsync = 0, foundThreads = 0;
+    int foundCpu = 0, foundDur = 0, foundRamp = 0, foundRawwrite = 0;
+    int foundDurability = 0, foundSyncint = 0, foundDiscard = 0, foundDiscardpct = 0;
+    int foundVerify = 0, foundContent = 0, foundCompress = 0, foundDedupe = 0;
+    int foundReuse = 0, foundClone = 0, foundAffinity = 0, foundTarget = 0;
+    int foundHugepages = 0, foundMlock = 0, foundMembudget = 0, foundOutput = 0;
+    int foundStats = 0, foundPerf = 0, foundDevstats = 0, foundSteady = 0;
+    int foundRepeat = 0, foundCi = 0, foundLatency = 0;
+    int i, nthreads;
+    char * p;
+    long long fsz;
+    struct stat sbuf;
+#if defined( ALLOW_RAW )
+    int fd;
+#endif /* ALLOW_RAW */
+
+    while (  argno < argc  )
+    {
+        if (  strcmp( argv[argno], "-nopreallocate" ) == 0  )
+        {
+            if (  foundNopreallocate  )
             {
-                fprintf( stderr, "\n*** Multiple '-nofsync' options not allowed\n" );
+                fprintf( stderr, "\n*** Multiple '-nopreallocate' options not allowed\n" );
                 return 1;
             }
-            ctxt->nofsync = foundNofsync = 1;
+            if (  foundUsrfile )
+            {
+                fprintf( stderr, "\n*** '-nopreallocate' is incompatible with a user specified filename\n" );
+                return 1;
+            }
+            ctxt->nopreallocate = foundNopreallocate = 1;
+        }
+        else
+#if defined(MACOS)
+        if (  strcmp( argv[argno], "-rdahead" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundRdahead  )
+            {
+                fprintf( stderr, "\n*** Multiple '-rdahead' options not allowed\n" );
+                return 1;
+            }
+            ctxt->rdahead = foundRdahead = 1;
+        }
+        else
+#endif /* MACOS */
+        if (  strcmp( argv[argno], "-1file" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  found1file  )
+            {
+                fprintf( stderr, "\n*** Multiple '-1file' options not allowed\n" );
+                return 1;
+            }
+            ctxt->onefile = found1file = 1;
+            if (  ((argno+1) < argc) && (argv[argno+1][0] != '-')  )
+            {
+                if (  foundFile )
+                {
+                    fprintf( stderr, "\n*** A user specified filename is incompatible with '-file'\n" );
+                    return 1;
+                }
+                if (  foundGeniosz  )
+                {
+                    fprintf( stderr, "\n*** A user specified filename is incompatible with '-geniosz'\n" );
+                    return 1;
+                }
+                ctxt->fname = argv[++argno];
+                ctxt->usrfile = foundUsrfile = 1;
+            }
         }
         else
-        if (  strcmp( argv[argno], "-file" ) == 0  )
+#if defined(ALLOW_RAW) && defined(ALLOW_RAWWRITE)
+        if (  strcmp( argv[argno], "-rawWrite" ) == 0  )
+        {
+            if (  foundRawwrite  )
+            {
+                fprintf( stderr, "\n*** Multiple '-rawWrite' options not allowed\n" );
+                return 1;
+            }
+            foundRawwrite = 1;
+            if (  ctxt->rawwrite < 0  )
+                ctxt->rawwrite = 1;
+            else
+            {
+                fprintf( stderr, "\n*** Writing to block and raw devices is not enabled\n" );
+                return 1;
+            }
+        }
+        else
+#endif /* ALLOW_RAW && ALLOW_RAWWRITE */
+        if (  strcmp( argv[argno], "-verify" ) == 0  )
+        {
+            if (  foundVerify  )
+            {
+                fprintf( stderr, "\n*** Multiple '-verify' options not allowed\n" );
+                return 1;
+            }
+            ctxt->verify = foundVerify = 1;
+        }
+        else
+#if defined(ALLOW_CLONE)
+        if (  strcmp( argv[argno], "-clone" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundClone  )
+            {
+                fprintf( stderr, "\n*** Multiple '-clone' options not allowed\n" );
+                return 1;
+            }
+            ctxt->clone = foundClone = 1;
+        }
+        else
+#endif /* ALLOW_CLONE */
+#if defined(ALLOW_AFFINITY)
+        if (  strcmp( argv[argno], "-affinity" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundAffinity  )
+            {
+                fprintf( stderr, "\n*** Multiple '-affinity' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-affinity'\n" );
+                return 1;
+            }
+            if (  strcmp( argv[argno], "compact" ) == 0  )
+                ctxt->affinity = AFF_COMPACT;
+            else
+            if (  strcmp( argv[argno], "spread" ) == 0  )
+                ctxt->affinity = AFF_SPREAD;
+            else
+            if (  strcmp( argv[argno], "device" ) == 0  )
+                ctxt->affinity = AFF_DEVICE;
+            else
+            if (  (argv[argno][0] >= '0') && (argv[argno][0] <= '9')  )
+            {
+                ctxt->affinity = AFF_LIST;
+                ctxt->cpulist = argv[argno];
+            }
+            else
+            {
+                fprintf( stderr, "\n*** Invalid value for '-affinity'\n" );
+                return 1;
+            }
+            foundAffinity = 1;
+        }
+        else
+#endif /* ALLOW_AFFINITY */
+#if defined(ALLOW_HUGEPAGES)
+        if (  strcmp( argv[argno], "-hugepages" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundHugepages  )
+            {
+                fprintf( stderr, "\n*** Multiple '-hugepages' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-hugepages'\n" );
+                return 1;
+            }
+            if (  strcmp( argv[argno], "thp" ) == 0  )
+                ctxt->hugepages = BUF_THP;
+            else
+            if (  strcmp( argv[argno], "explicit" ) == 0  )
+                ctxt->hugepages = BUF_HUGETLB;
+            else
+            {
+                fprintf( stderr, "\n*** Invalid value for '-hugepages'\n" );
+                return 1;
+            }
+            foundHugepages = 1;
+        }
+        else
+#endif /* ALLOW_HUGEPAGES */
+        if (  strcmp( argv[argno], "-mlock" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundMlock  )
+            {
+                fprintf( stderr, "\n*** Multiple '-mlock' options not allowed\n" );
+                return 1;
+            }
+            ctxt->lockbufs = foundMlock = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-reuse" ) == 0  )
+        {
+            if (  foundReuse  )
+            {
+                fprintf( stderr, "\n*** Multiple '-reuse' options not allowed\n" );
+                return 1;
+            }
+            ctxt->reuse = foundReuse = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-content" ) == 0  )
+        {
+            if (  foundContent  )
+            {
+                fprintf( stderr, "\n*** Multiple '-content' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-content'\n" );
+                return 1;
+            }
+            if (  strcmp( argv[argno], "zero" ) == 0  )
+                ctxt->content = CONT_ZERO;
+            else
+            if (  strcmp( argv[argno], "random" ) == 0  )
+                ctxt->content = CONT_RANDOM;
+            else
+            {
+                fprintf( stderr, "\n*** Invalid value for '-content'\n" );
+                return 1;
+            }
+            foundContent = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-compress" ) == 0  )
+        {
+            if (  foundCompress  )
+            {
+                fprintf( stderr, "\n*** Multiple '-compress' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-compress'\n" );
+                return 1;
+            }
+            if (  ratioConvert( argv[argno], &ctxt->compress )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-compress'\n" );
+                return 1;
+            }
+            foundCompress = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-dedupe" ) == 0  )
+        {
+            if (  foundDedupe  )
+            {
+                fprintf( stderr, "\n*** Multiple '-dedupe' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-dedupe'\n" );
+                return 1;
+            }
+            if (  ratioConvert( argv[argno], &ctxt->dedupe )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-dedupe'\n" );
+                return 1;
+            }
+            foundDedupe = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-cpu" ) == 0  )
+        {
+            if (  foundCpu  )
+            {
+                fprintf( stderr, "\n*** Multiple '-cpu' options not allowed\n" );
+                return 1;
+            }
+            ctxt->reportcpu = foundCpu = 1;
+        }
+        else
+#if defined(ALLOW_PERF)
+        if (  strcmp( argv[argno], "-perf" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundPerf  )
+            {
+                fprintf( stderr, "\n*** Multiple '-perf' options not allowed\n" );
+                return 1;
+            }
+            ctxt->perf = foundPerf = 1;
+        }
+        else
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_DEVSTATS)
+        if (  strcmp( argv[argno], "-devstats" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundDevstats  )
+            {
+                fprintf( stderr, "\n*** Multiple '-devstats' options not allowed\n" );
+                return 1;
+            }
+            ctxt->devstats = foundDevstats = 1;
+        }
+        else
+#endif /* ALLOW_DEVSTATS */
+        if (  strcmp( argv[argno], "-noread" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundNoread  )
+            {
+                fprintf( stderr, "\n*** Multiple '-noread' options not allowed\n" );
+                return 1;
+            }
+            if (  foundNowrite  )
+            {
+                fprintf( stderr, "\n*** '-noread' and '-nowrite' are mutually exclusive\n" );
+                return 1;
+            }
+            ctxt->noread = foundNoread = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-nowrite" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundNowrite  )
+            {
+                fprintf( stderr, "\n*** Multiple '-nowrite' options not allowed\n" );
+                return 1;
+            }
+            if (  foundNoread  )
+            {
+                fprintf( stderr, "\n*** '-noread' and '-nowrite' are mutually exclusive\n" );
+                return 1;
+            }
+            ctxt->nowrite = foundNowrite = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-verbose" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundVerbose  )
+            {
+                fprintf( stderr, "\n*** Multiple '-verbose' options not allowed\n" );
+                return 1;
+            }
+            ctxt->verbose = foundVerbose = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-cache" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundCache  )
+            {
+                fprintf( stderr, "\n*** Multiple '-cache' options not allowed\n" );
+                return 1;
+            }
+            ctxt->cache = foundCache = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-nodsync" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundNodsync  )
+            {
+                fprintf( stderr, "\n*** Multiple '-nodsync' options not allowed\n" );
+                return 1;
+            }
+            if (  foundDurability  )
+            {
+                fprintf( stderr, "\n*** '-durability' and '-nodsync' are mutually exclusive\n" );
+                return 1;
+            }
+            ctxt->nodsync = foundNodsync = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-nofsync" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundNofsync  )
+            {
+                fprintf( stderr, "\n*** Multiple '-nofsync' options not allowed\n" );
+                return 1;
+            }
+            ctxt->nofsync = foundNofsync = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-durability" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundDurability  )
+            {
+                fprintf( stderr, "\n*** Multiple '-durability' options not allowed\n" );
+                return 1;
+            }
+            if (  foundNodsync  )
+            {
+                fprintf( stderr, "\n*** '-durability' and '-nodsync' are mutually exclusive\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-durability'\n" );
+                return 1;
+            }
+            if (  strcmp( argv[argno], "dsync" ) == 0  )
+                ctxt->durability = DUR_DSYNC;
+            else
+#if defined(ALLOW_RWFDSYNC)
+            if (  strcmp( argv[argno], "rwfdsync" ) == 0  )
+                ctxt->durability = DUR_RWFDSYNC;
+            else
+#endif /* ALLOW_RWFDSYNC */
+            if (  strcmp( argv[argno], "fdatasync" ) == 0  )
+                ctxt->durability = DUR_FDATASYNC;
+            else
+            if (  strcmp( argv[argno], "fsync" ) == 0  )
+                ctxt->durability = DUR_FSYNC;
+            else
+#if defined(ALLOW_SYNCRANGE)
+            if (  strcmp( argv[argno], "syncrange" ) == 0  )
+                ctxt->durability = DUR_SYNCRANGE;
+            else
+#endif /* ALLOW_SYNCRANGE */
+            {
+                fprintf( stderr, "\n*** Invalid value for '-durability'\n" );
+                return 1;
+            }
+            foundDurability = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-syncint" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundSyncint  )
+            {
+                fprintf( stderr, "\n*** Multiple '-syncint' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-syncint'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->syncint )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-syncint'\n" );
+                return 1;
+            }
+            if (  (ctxt->syncint < MIN_SYNCINT) || (ctxt->syncint > MAX_SYNCINT)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-syncint'\n" );
+                return 1;
+            }
+            foundSyncint = 1;
+        }
+        else
+#if defined(ALLOW_DISCARD)
+        if (  strcmp( argv[argno], "-discard" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundDiscard  )
+            {
+                fprintf( stderr, "\n*** Multiple '-discard' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-discard'\n" );
+                return 1;
+            }
+            if (  strcmp( argv[argno], "trim" ) == 0  )
+                ctxt->discard = DISC_TRIM;
+            else
+            if (  strcmp( argv[argno], "zeroout" ) == 0  )
+                ctxt->discard = DISC_ZEROOUT;
+            else
+            if (  strcmp( argv[argno], "punch" ) == 0  )
+                ctxt->discard = DISC_PUNCH;
+            else
+            if (  strcmp( argv[argno], "zero" ) == 0  )
+                ctxt->discard = DISC_ZERO;
+            else
+            {
+                fprintf( stderr, "\n*** Invalid value for '-discard'\n" );
+                return 1;
+            }
+            foundDiscard = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-discardpct" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundDiscardpct  )
+            {
+                fprintf( stderr, "\n*** Multiple '-discardpct' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-discardpct'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->discardpct )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-discardpct'\n" );
+                return 1;
+            }
+            if (  (ctxt->discardpct < MIN_DISCPCT) || (ctxt->discardpct > MAX_DISCPCT)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-discardpct'\n" );
+                return 1;
+            }
+            foundDiscardpct = 1;
+        }
+        else
+#endif /* ALLOW_DISCARD */
+        if (  strcmp( argv[argno], "-file" ) == 0  )
+        {
+            if (  foundFile  )
+            {
+                fprintf( stderr, "\n*** Multiple '-file' options not allowed\n" );
+                return 1;
+            }
+            if (  foundUsrfile )
+            {
+                fprintf( stderr, "\n*** '-file' is incompatible with a user specified filename\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-file'\n" );
+                return 1;
+            }
+            ctxt->fname = argv[argno];
+            foundFile = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-target" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  ntargets >= MAX_TARGETS  )
+            {
+                fprintf( stderr, "\n*** No more than %d '-target' options allowed\n", MAX_TARGETS );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-target'\n" );
+                return 1;
+            }
+            // <fpath>[:<nthr>]
+            targets[ntargets].threads = 0;
+            p = strrchr( argv[argno], ':' );
+            if (  p != NULL  )
+            {
+                *p++ = '\0';
+                if (  intConvert( p, &targets[ntargets].threads ) ||
+                      (targets[ntargets].threads < MIN_THREADS)  )
+                {
+                    fprintf( stderr, "\n*** Invalid thread count for '-target'\n" );
+                    return 1;
+                }
+            }
+            if (  argv[argno][0] == '\0'  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-target'\n" );
+                return 1;
+            }
+            targets[ntargets++].fname = argv[argno];
+            foundTarget = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-fsize" ) == 0  )
+        {
+            if (  foundFsize  )
+            {
+                fprintf( stderr, "\n*** Multiple '-fsize' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-fsize'\n" );
+                return 1;
+            }
+            if (  valueConvert( argv[argno], &ctxt->fsz )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-fsize'\n" );
+                return 1;
+            }
+            foundFsize = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-iosz" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundIosz  )
+            {
+                fprintf( stderr, "\n*** Multiple '-iosz' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-iosz'\n" );
+                return 1;
+            }
+            if (  valueConvert( argv[argno], &ctxt->iosz )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
+                return 1;
+            }
+            if (  (ctxt->iosz < MIN_IOSZ) || (ctxt->iosz > MAX_IOSZ)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
+                return 1;
+            }
+            ctxt->usriosz = foundIosz = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-threads" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundThreads )
+            {
+                fprintf( stderr, "\n*** Multiple '-threads' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-threads'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->threads )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-threads'\n" );
+                return 1;
+            }
+            foundThreads = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-dur" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundDur )
+            {
+                fprintf( stderr, "\n*** Multiple '-dur' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-dur'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->duration )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-dur'\n" );
+                return 1;
+            }
+            if (  (ctxt->duration < MIN_DUR) || (ctxt->duration > MAX_DUR)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-dur'\n" );
+                return 1;
+            }
+            foundDur = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-ramp" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundRamp )
+            {
+                fprintf( stderr, "\n*** Multiple '-ramp' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-ramp'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->ramp )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-ramp'\n" );
+                return 1;
+            }
+            if (  (ctxt->ramp < MIN_RAMP) || (ctxt->ramp > MAX_RAMP)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-ramp'\n" );
+                return 1;
+            }
+            foundRamp = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-repeat" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundRepeat )
+            {
+                fprintf( stderr, "\n*** Multiple '-repeat' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-repeat'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->repeat ) ||
+                  (ctxt->repeat < 1) || (ctxt->repeat > MAX_REPEAT)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-repeat'\n" );
+                return 1;
+            }
+            foundRepeat = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-ci" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundCi )
+            {
+                fprintf( stderr, "\n*** Multiple '-ci' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-ci'\n" );
+                return 1;
+            }
+            citarget = strtod( argv[argno], &p );
+            if (  (*p != '\0') || (citarget <= 0.0) || (citarget >= 100.0)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-ci'\n" );
+                return 1;
+            }
+            foundCi = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-steady" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundSteady )
+            {
+                fprintf( stderr, "\n*** Multiple '-steady' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-steady'\n" );
+                return 1;
+            }
+            if (  intConvert( argv[argno], &ctxt->steady )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-steady'\n" );
+                return 1;
+            }
+            if (  (ctxt->steady < MIN_STEADY) || (ctxt->steady > MAX_STEADY)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-steady'\n" );
+                return 1;
+            }
+            foundSteady = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-geniosz" ) == 0  )
+        {
+            if (  foundGeniosz  )
+            {
+                fprintf( stderr, "\n*** Multiple '-geniosz' options not allowed\n" );
+                return 1;
+            }
+            if (  foundUsrfile )
+            {
+                fprintf( stderr, "\n*** '-geniosize' is incompatible with a user specified filename\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-geniosz'\n" );
+                return 1;
+            }
+            if (  valueConvert( argv[argno], &ctxt->geniosz )  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-geniosz'\n" );
+                return 1;
+            }
+            ctxt->usrgeniosz = foundGeniosz = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-membudget" ) == 0  )
+        {
+            if (  foundMembudget  )
+            {
+                fprintf( stderr, "\n*** Multiple '-membudget' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-membudget'\n" );
+                return 1;
+            }
+            if (  valueConvert( argv[argno], &ctxt->membudget ) ||
+                  (ctxt->membudget < 1)  )
+            {
+                fprintf( stderr, "\n*** Invalid value for '-membudget'\n" );
+                return 1;
+            }
+            foundMembudget = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-stats" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundStats  )
+            {
+                fprintf( stderr, "\n*** Multiple '-stats' options not allowed\n" );
+                return 1;
+            }
+            if (  ++argno >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-stats'\n" );
+                return 1;
+            }
+            statsfname = argv[argno];
+            foundStats = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-latency" ) == 0  )
+        {
+            if (  ctxt->testmode == MODE_CREATE  )
+            {
+                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+                return 1;
+            }
+            if (  foundLatency  )
+            {
+                fprintf( stderr, "\n*** Multiple '-latency' options not allowed\n" );
+                return 1;
+            }
+            ctxt->iolat = foundLatency = 1;
+        }
+        else
+        if (  strcmp( argv[argno], "-output" ) == 0  )
+        {
+            if (  foundOutput  )
+            {
+                fprintf( stderr, "\n*** Multiple '-output' options not allowed\n" );
+                return 1;
+            }
+            if (  (argno + 2) >= argc  )
+            {
+                fprintf( stderr, "\n*** Missing value for '-output'\n" );
+                return 1;
+            }
+            argno++;
+            if (  strcmp( argv[argno], "json" ) == 0  )
+                outfmt = OUT_JSON;
+            else
+            if (  strcmp( argv[argno], "csv" ) == 0  )
+                outfmt = OUT_CSV;
+            else
+            {
+                fprintf( stderr, "\n*** Invalid value for '-output'\n" );
+                return 1;
+            }
+            outfname = argv[++argno];
+            foundOutput = 1;
+        }
+        else
+        {
+            fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+            return 1;
+        }
+        argno += 1;
+    }
+
+    if (  foundTarget  )
+    {
+        if (  foundFile  )
+        {
+            fprintf( stderr, "\n*** '-target' and '-file' are mutually exclusive\n" );
+            return 1;
+        }
+        if (  ctxt->usrfile  )
+        {
+            fprintf( stderr, "\n*** '-target' is incompatible with a user specified filename\n" );
+            return 1;
+        }
+        if (  foundClone  )
+        {
+            fprintf( stderr, "\n*** '-target' and '-clone' are mutually exclusive\n" );
+            return 1;
+        }
+        ctxt->fname = targets[0].fname;
+    }
+
+    ctxt->tfname = ctxt->fname;
+
+    if (  foundClone && ctxt->onefile  )
+    {
+        fprintf( stderr, "\n*** '-clone' and '-1file' are mutually exclusive\n" );
+        return 1;
+    }
+
+    if (  foundReuse && ctxt->usrfile  )
+    {
+        fprintf( stderr, "\n*** '-reuse' is incompatible with a user specified filename\n" );
+        return 1;
+    }
+
+    if (  foundCompress || foundDedupe  )
+    {
+        if (  foundContent && (ctxt->content == CONT_ZERO)  )
+        {
+            fprintf( stderr, "\n*** '-compress' and '-dedupe' require random content\n" );
+            return 1;
+        }
+        ctxt->content = CONT_RANDOM;
+    }
+
+    if (  foundFsize && ( (ctxt->fsz < MIN_FSIZE) || (ctxt->fsz > MAX_FSIZE) )  )
+    {
+        fprintf( stderr, "\n*** Invalid value for '-fsize'\n" );
+        return 1;
+    }
+
+    if (  ctxt->usrfile  )
+    {
+#if defined( ALLOW_RAW )
+        if (  ctxt->rawwrite < 0  )
+            ctxt->rawwrite = 0;
+        errno = 0;
+        fd = open( ctxt->fname, O_RDONLY );
+        if (  fd < 0  )
+        {
+            fprintf( stderr, "\n*** Unable to open '%s'  - %d (%s)\n", ctxt->fname,
+                     errno, strerror(errno) );
+            return 1;
+        }
+        errno = 0;
+        if (  fstat( fd, &sbuf )  )
+        {
+            fprintf( stderr, "\n*** Unable to stat '%s'   - %d (%s)\n", ctxt->fname,
+                     errno, strerror(errno) );
+            close( fd );
+            return 1;
+        }
+        if (  ! ( sbuf.st_mode & S_IFREG ) &&
+              ! ( sbuf.st_mode & S_IFCHR ) &&
+              ! ( sbuf.st_mode & S_IFBLK )  )
+        {
+            fprintf( stderr, "\n*** '%s' is not a regular, block or raw file\n", ctxt->fname );
+            close( fd );
+            return 1;
+        }
+        if (  ( sbuf.st_mode & S_IFCHR ) || ( sbuf.st_mode & S_IFBLK )  )
+        {
+            ctxt->raw = 1;
+            if (  sbuf.st_mode & S_IFBLK  )
+                ctxt->blk = 1;
+            if (  foundRdahead  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-rdahead' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  foundCache  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-cache' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  foundNopreallocate  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nopreallocate' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  foundNodsync  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nodsync' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  foundNofsync  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nofsync' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  foundDurability  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, '-durability' not allowed\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  ctxt->noread && ! ctxt->rawwrite  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not enabled and '-noread' specified\n",
+                         ctxt->fname );
+                close( fd );
+                return 1;
+            }
+            if (  ctxt->noread  )
+            {
+#if ! defined(ALLOW_RAWWRITE)
+                fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not allowed and '-noread' specified\n",
+                         ctxt->fname );
+                close( fd );
+                return 1;
+#else  /* ALLOW_RAWWRITE */
+                if (  ! ctxt->rawwrite  )
+                {
+                    fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not enabled and '-noread' specified\n",
+                             ctxt->fname );
+                    close( fd );
+                    return 1;
+                }
+#endif /* ALLOW_RAWWRITE */
+            }
+#if ! defined(ALLOW_RAWWRITE)
+            ctxt->nowrite = foundNowrite = 1;
+#else  /* ALLOW_RAWWRITE */
+            if (  ! ctxt->nowrite  )
+            {
+                if (  ! ctxt->rawwrite  )
+                    ctxt->nowrite = foundNowrite = 1;
+            }
+#endif /* ALLOW_RAWWRITE */
+
+            ctxt->blksz = sbuf.st_blksize;
+            if (  foundIosz && ( ( ctxt->iosz % ctxt->blksz ) != 0 )  )
+            {
+                fprintf( stderr, "\n*** '%s' is a block or raw file, value for '-iosz' must be a multiple of %'ld\n",
+                         ctxt->fname, ctxt->blksz );
+                close( fd );
+                return 1;
+            }
+
+            fsz = findRawSize( fd, ctxt->blksz );
+            if (  fsz <= 0  )
+            {
+                fprintf( stderr, "*** Unable to determine size for '%s'\n", ctxt->fname );
+                close( fd );
+                return 1;
+            }
+
+            close( fd );
+        }
+        else
+            fsz = sbuf.st_size;
+#else /* !ALLOW_RAW */
+        errno = 0;
+        if (  stat( ctxt->fname, &sbuf )  )
+        {
+            fprintf( stderr, "\n*** Unable to stat '%s'   - %d (%s)\n", ctxt->fname,
+                     errno, strerror(errno) );
+            return 1;
+        }
+        if (  ! ( sbuf.st_mode & S_IFREG )  )
+        {
+            fprintf( stderr, "\n*** '%s' is not a regular file\n", ctxt->fname );
+            return 1;
+        }
+        fsz = sbuf.st_size;
+#endif /* ALLOW_RAW */
+        if (  foundFsize  )
+        {
+            if (  ctxt->fsz > fsz  )
+            {
+                fprintf( stderr, "\n*** Value specified for '-fsize' (%'ld) is greater than size of '%s'\n",
+                         ctxt->fsz, ctxt->fname );
+                return 1;
+            }
+        }
+        else
+        {
+            if (  fsz < MIN_FSIZE  )
+            {
+                fprintf( stderr, "\n*** File size (%'lld) less than %'ld\n", fsz, (long)MIN_FSIZE );
+                return 1;
+            }
+            if (  fsz > MAX_FSIZE  )
+            {
+                fprintf( stderr, "\n*** File size (%'lld) greater than %'ld\n", fsz, (long)MAX_FSIZE );
+                return 1;
+            }
+            ctxt->fsz = (long)fsz;
+        }
+    } // usrfile
+
+    if (  (ctxt->geniosz < 1) || (ctxt->geniosz > ctxt->fsz)  )
+    {
+        fprintf( stderr, "\n*** Invalid value for '-geniosz'\n" );
+        return 1;
+    }
+
+    if (  foundFile && found1file && ! foundUsrfile  )
+    {
+        if (  stat( ctxt->fname, &sbuf ) == 0  )
+        {
+            fprintf( stderr, "\n*** File '%s' already exists\n", ctxt->fname );
+            return 1;
+        }
+    }
+
+    if (  ctxt->testmode != MODE_CREATE  )
+    {
+        if (  foundSyncint &&
+              ( (ctxt->durability == DUR_DSYNC) || (ctxt->durability == DUR_RWFDSYNC) )  )
+        {
+            fprintf( stderr, "\n*** '-syncint' requires a '-durability' mode that flushes\n" );
+            return 1;
+        }
+
+        // any durability mode other than O_DSYNC opens the file without it
+        if (  ctxt->durability != DUR_DSYNC  )
+            ctxt->nodsync = 1;
+
+        if (  ctxt->nofsync && ! ctxt->nodsync  )
+        {
+            if (  foundDurability  )
+                fprintf( stderr, "\n*** '-durability dsync' and '-nofsync' are mutually exclusive\n" );
+            else
+                fprintf( stderr, "\n*** '-nofsync' requires '-nodsync' or a '-durability' other than 'dsync'\n" );
+            return 1;
+        }
+
+#if defined(ALLOW_DISCARD)
+        if (  foundDiscardpct && ! foundDiscard  )
+        {
+            fprintf( stderr, "\n*** '-discardpct' can only be specified with '-discard'\n" );
+            return 1;
+        }
+        if (  foundDiscard  )
+        {
+            if (  foundVerify  )
+            {
+                fprintf( stderr, "\n*** '-discard' and '-verify' are mutually exclusive\n" );
+                return 1;
+            }
+            if (  ctxt->nowrite  )
+            {
+                fprintf( stderr, "\n*** '-discard' requires write testing to be enabled\n" );
+                return 1;
+            }
+            if (  ctxt->raw  )
+            {
+                if (  ! ctxt->blk  )
+                {
+                    fprintf( stderr, "\n*** '%s' is a raw file, '-discard' requires a block device\n",
+                             ctxt->fname );
+                    return 1;
+                }
+                if (  (ctxt->discard == DISC_PUNCH) || (ctxt->discard == DISC_ZERO)  )
+                {
+                    fprintf( stderr, "\n*** '%s' is a block device, use '-discard trim' or '-discard zeroout'\n",
+                             ctxt->fname );
+                    return 1;
+                }
+            }
+            else
+            if (  (ctxt->discard == DISC_TRIM) || (ctxt->discard == DISC_ZEROOUT)  )
+            {
+                fprintf( stderr, "\n*** '-discard %s' requires a block device, use 'punch' or 'zero' for files\n",
+                         discardName( ctxt->discard ) );
+                return 1;
+            }
+        }
+#endif /* ALLOW_DISCARD */
+    
+        if (  (ctxt->iosz < 1) || (ctxt->iosz > ctxt->fsz)  )
+        {
+            fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
+            return 1;
+        }
+    
+        if (  ( ctxt->threads < MIN_THREADS ) || ( ctxt->threads > MAX_THREADS )  )
+        {
+            fprintf( stderr, "\n*** Invalid value for '-threads'\n" );
+            return 1;
+        }
+
+        // targets without a thread count use '-threads'
+        if (  ntargets == 0  )
+        {
+            targets[0].fname = ctxt->fname;
+            targets[0].threads = ctxt->threads;
+            ntargets = 1;
+        }
+        for ( nthreads = i = 0; i < ntargets; i++ )
+        {
+            if (  targets[i].threads == 0  )
+                targets[i].threads = ctxt->threads;
+            nthreads += targets[i].threads;
+        }
+        if (  nthreads > MAX_THREADS  )
+        {
+            fprintf( stderr, "\n*** Too many threads, the maximum is %d\n", MAX_THREADS );
+            return 1;
+        }
+        ctxt->threads = nthreads;
+    }
+
+    if (  foundCi && ! foundRepeat  )
+        ctxt->repeat = DFLT_CIREPEAT;
+
+    return 0;
+} // parseArgs
+
+/*
+ * Report CPU usage information.
+ */
+
+void
+reportTimes(
+            void
+           )
+{
+    long cpu_time = 0;
+    int  cpu_ustime = 0;
+    long cpu_user = 0;
+    int  cpu_ususer = 0;
+    long cpu_sys = 0;
+    int  cpu_ussys = 0;
+    long pcpu_seconds = 0;
+    int  pcpu_useconds = 0;
+    long numcpus = 1;
+    long totcpuus = 0;
+    long usedcpuus = 0;
+    double proccpu = 0.0;
+    double syscpu = 0.0;
+
+    cpu_user = rend.ru_utime.tv_sec - rstart.ru_utime.tv_sec;
+    cpu_ususer = rend.ru_utime.tv_usec - rstart.ru_utime.tv_usec;
+    if (  cpu_ususer < 0  )
+    {
+        cpu_user -= 1;
+        cpu_ususer += 1000000;
+    }
+
+    cpu_sys = rend.ru_stime.tv_sec - rstart.ru_stime.tv_sec;
+    cpu_ussys = rend.ru_stime.tv_usec - rstart.ru_stime.tv_usec;
+    if (  cpu_ussys < 0  )
+    {
+        cpu_sys -= 1;
+        cpu_ussys += 1000000;
+    }
+
+    cpu_time = cpu_user + cpu_sys;
+    cpu_ustime = cpu_ususer + cpu_ussys;
+    if (  cpu_ustime >= 1000000  )
+    {
+        cpu_time += 1;
+        cpu_ustime %= 1000000;
+    }
+
+    pcpu_seconds = pend.tv_sec - pstart.tv_sec;
+    pcpu_useconds = pend.tv_usec - pstart.tv_usec;
+    if (  pcpu_useconds < 0  )
+    {
+        pcpu_seconds -= 1;
+        pcpu_useconds += 1000000;
+    }
+
+    numcpus = sysconf( _SC_NPROCESSORS_ONLN );
+    totcpuus = numcpus * ( ( pcpu_seconds * 1000000 ) + pcpu_useconds );
+    usedcpuus = ( cpu_time * 1000000 ) + cpu_ustime;
+    proccpu = ( 100.0 * (double)usedcpuus ) / (double)( ( pcpu_seconds * 1000000 ) + pcpu_useconds );
+    syscpu = ( 100.0 * (double)usedcpuus ) / (double)totcpuus;
+
+    printf( "Elapsed time = %'ld.%3.3d seconds\n", pcpu_seconds, pcpu_useconds/1000 );
+    printf( "User CPU time = %'ld.%3.3d seconds\n", cpu_user, cpu_ususer/1000 );
+    printf( "System CPU time = %'ld.%3.3d seconds\n", cpu_sys, cpu_ussys/1000 );
+    printf( "Total CPU time = %'ld.%3.3d seconds\n", cpu_time, cpu_ustime/1000 );
+    printf( "Process CPU usage = %.3f%%\n", proccpu );
+    printf( "System CPU usage = %.3f%%\n", syscpu );
+    printf( "Page faults = %'ld minor, %'ld major\n",
+            (long)(rend.ru_minflt - rstart.ru_minflt),
+            (long)(rend.ru_majflt - rstart.ru_majflt) );
+} // reportTimes
+
+/*
+ * Return the CPU time used by a test thread during the measured part of
+ * a read or write phase.
+ */
+
+long
+threadCpuUs(
+            context_t * ctxt,
+            int         phase
+           )
+{
+    return (phase == RATE_READ) ? ctxt->rdcpuus : ctxt->wrcpuus;
+} // threadCpuUs
+
+/*
+ * Report the CPU time used by the test threads during the measured part
+ * of a read or write phase along with the CPU cost per I/O. Unlike
+ * reportTimes() this excludes the coordinator and any ramp time.
+ */
+
+void
+reportThreadCpu(
+                context_t * threadcontexts,
+                int         numcontexts,
+                int         phase
+               )
+{
+    int i;
+    long nops, cpuus, totops = 0L, totcpuus = 0L;
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        nops = (phase == RATE_READ) ? threadcontexts[i].nreads : threadcontexts[i].nwrites;
+        cpuus = threadCpuUs( &threadcontexts[i], phase );
+        totops += nops;
+        totcpuus += cpuus;
+        if (  threadcontexts[i].verbose && (numcontexts > 1) &&
+              (numcontexts <= VERBOSE_THREADS) && (cpuus > 0) && (nops > 0)  )
+            printf( "Thread %d: CPU time = %'ld µs, %.2f CPU µs per I/O, %.2f IOPS per core\n",
+                    i, cpuus, (double)cpuus / (double)nops,
+                    ((double)nops * 1000000.0) / (double)cpuus );
+    }
+    if (  (totcpuus <= 0) || (totops <= 0)  )
+        return;
+    printf( "Thread CPU time = %'ld.%3.3ld seconds\n",
+            totcpuus / 1000000L, (totcpuus % 1000000L) / 1000L );
+    printf( "CPU cost = %.2f CPU µs per I/O, %.2f IOPS per core\n",
+            (double)totcpuus / (double)totops,
+            ((double)totops * 1000000.0) / (double)totcpuus );
+} // reportThreadCpu
+
+#if defined(ALLOW_PERF)
+/*
+ * Return the total of performance counter 'event' across the test
+ * threads for a read or write phase, or -1 if any thread could not
+ * count it.
+ */
+
+long
+perfTotal(
+          context_t * threadcontexts,
+          int         numcontexts,
+          int         phase,
+          int         event
+         )
+{
+    long count, total = 0L;
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        count = (phase == RATE_READ) ? threadcontexts[i].rdperf[event] :
+                                        threadcontexts[i].wrperf[event];
+        if (  count < 0  )
+            return -1L;
+        total += count;
+    }
+
+    return total;
+} // perfTotal
+
+/*
+ * Report the performance counters for a read or write phase per I/O.
+ */
+
+void
+reportPerf(
+           context_t * threadcontexts,
+           int         numcontexts,
+           int         phase
+          )
+{
+    long nops = 0L, count, cycles = -1L;
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+        nops += (phase == RATE_READ) ? threadcontexts[i].nreads : threadcontexts[i].nwrites;
+    if (  nops <= 0  )
+        return;
+
+    for ( i = 0; i < PERF_NEVENTS; i++ )
+    {
+        count = perfTotal( threadcontexts, numcontexts, phase, i );
+        if (  i == 0  )
+            cycles = count;
+        if (  (count < 0) && perfErrno[i]  )
+            printf( "%s per I/O = unavailable - %d (%s)\n", perfNames[i],
+                    perfErrno[i], strerror( perfErrno[i] ) );
+        else
+        if (  count < 0  )
+            printf( "%s per I/O = unavailable\n", perfNames[i] );
+        else
+        if (  (i == 1) && (cycles > 0)  )
+            printf( "%s per I/O = %.2f (%.2f per cycle)\n", perfNames[i],
+                    (double)count / (double)nops, (double)count / (double)cycles );
+        else
+            printf( "%s per I/O = %.4f\n", perfNames[i], (double)count / (double)nops );
+    }
+    if (  perfUserOnly  )
+        printf( "Hardware counters include user space only\n" );
+} // reportPerf
+#endif /* ALLOW_PERF */
+
+/*
+ * Report the peak resident set size of the process.
+ */
+
+void
+reportPeakRSS(
+              void
+             )
+{
+    struct rusage ru;
+    long peakkb;
+
+    if (  getrusage( RUSAGE_SELF, &ru )  )
+        return;
+#if defined(MACOS)
+    peakkb = (long)ru.ru_maxrss / 1024; // bytes on macOS
+#else /* ! MACOS */
+    peakkb = (long)ru.ru_maxrss;
+#endif /* ! MACOS */
+    if (  peakkb > 0  )
+        printf( "Peak resident set size = %'ld KB\n\n", peakkb );
+} // reportPeakRSS
+
+/*
+ * Reusable test files are described by a small text file alongside
+ * them, '<file>.iops', which records how the file was generated. The
+ * test file itself is left untouched so offsets are unaffected.
+ */
+
+char *
+reuseInfoName(
+              char * fname
+             )
+{
+    char * iname;
+    size_t l = strlen( fname ) + sizeof(REUSE_SUFFIX);
+
+    iname = (char *)calloc( l, sizeof(char) );
+    if (  iname == NULL  )
+    {
+        fprintf( stderr, "*** Unable to malloc %'ld bytes\n", (long)l );
+        return NULL;
+    }
+    sprintf( iname, "%s%s", fname, REUSE_SUFFIX );
+
+    return iname;
+} // reuseInfoName
+
+/*
+ * Check whether a file is a reusable test file description.
+ */
+
+int
+isReuseInfo(
+            char * iname
+           )
+{
+    char line[REUSE_LINESZ];
+    FILE * fp;
+    int ret = 0;
+
+    fp = fopen( iname, "r" );
+    if (  fp == NULL  )
+        return 0;
+    if (  (fgets( line, sizeof(line), fp ) != NULL) &&
+          (strncmp( line, REUSE_MAGIC, strlen(REUSE_MAGIC) ) == 0)  )
+        ret = 1;
+    fclose( fp );
+
+    return ret;
+} // isReuseInfo
+
+/*
+ * Write the description for a newly generated reusable test file.
+ * Ratios are recorded in hundredths to avoid locale dependent output.
+ */
+
+int
+writeReuseInfo(
+               context_t * ctxt
+              )
+{
+    char * iname;
+    FILE * fp;
+    int ret = 0;
+
+    if (  (iname = reuseInfoName( ctxt->tfname )) == NULL  )
+        return 1;
+
+    errno = 0;
+    fp = fopen( iname, "w" );
+    if (  fp == NULL  )
+    {
+        fprintf( stderr, "*** Unable to create '%s' - %s\n", iname, strerror(errno) );
+        free( (void *)iname );
+        return 1;
+    }
+    fprintf( fp, "%s\n", REUSE_MAGIC );
+    fprintf( fp, "version %d\n", REUSE_VERSION );
+    fprintf( fp, "size %ld\n", ctxt->fsz );
+    fprintf( fp, "geniosz %ld\n", ctxt->geniosz );
+    fprintf( fp, "content %s\n", (ctxt->content == CONT_ZERO)?"zero":"random" );
+    fprintf( fp, "compress %ld\n", (long)((ctxt->compress * 100.0) + 0.5) );
+    fprintf( fp, "dedupe %ld\n", (long)((ctxt->dedupe * 100.0) + 0.5) );
+    fprintf( fp, "verify %d\n", ctxt->verify );
+    fprintf( fp, "seed %ld\n", ctxt->vseed );
+    fprintf( fp, "generated %ld\n", ctxt->gentime );
+    if (  fclose( fp )  )
+    {
+        fprintf( stderr, "*** Unable to write '%s' - %s\n", iname, strerror(errno) );
+        unlink( iname );
+        ret = 1;
+    }
+    free( (void *)iname );
+
+    return ret;
+} // writeReuseInfo
+
+/*
+ * Check whether an existing test file can be reused for this test.
+ * Returns -1 if there is no file (so it must be generated), 0 if it
+ * can be reused and 1 if it exists but cannot be used.
+ */
+
+int
+readReuseInfo(
+              context_t * ctxt
+             )
+{
+    char line[REUSE_LINESZ], key[REUSE_LINESZ], val[REUSE_LINESZ];
+    char * iname = NULL, * why = NULL;
+    FILE * fp;
+    struct stat sbuf;
+    long size = -1L, compress = 0L, dedupe = 0L, seed = 0L, gentime = 0L;
+    int version = 0, verify = 0, content = -1;
+
+    if (  (iname = reuseInfoName( ctxt->tfname )) == NULL  )
+        return 1;
+
+    if (  stat( ctxt->tfname, &sbuf )  )
+    {
+        // nothing to reuse, discard any orphaned description
+        unlink( iname );
+        free( (void *)iname );
+        return -1;
+    }
+
+    fp = fopen( iname, "r" );
+    if (  fp == NULL  )
+        why = "it is not a reusable test file";
+    else
+    {
+        if (  (fgets( line, sizeof(line), fp ) == NULL) ||
+              (strncmp( line, REUSE_MAGIC, strlen(REUSE_MAGIC) ) != 0)  )
+            why = "its description is invalid";
+        else
+        while (  fgets( line, sizeof(line), fp ) != NULL  )
+        {
+            if (  sscanf( line, "%127s %127s", key, val ) != 2  )
+                continue;
+            if (  strcmp( key, "version" ) == 0  )
+                version = atoi( val );
+            else
+            if (  strcmp( key, "size" ) == 0  )
+                size = atol( val );
+            else
+            if (  strcmp( key, "content" ) == 0  )
+                content = (strcmp( val, "zero" ) == 0) ? CONT_ZERO : CONT_RANDOM;
+            else
+            if (  strcmp( key, "compress" ) == 0  )
+                compress = atol( val );
+            else
+            if (  strcmp( key, "dedupe" ) == 0  )
+                dedupe = atol( val );
+            else
+            if (  strcmp( key, "verify" ) == 0  )
+                verify = atoi( val );
+            else
+            if (  strcmp( key, "seed" ) == 0  )
+                seed = atol( val );
+            else
+            if (  strcmp( key, "generated" ) == 0  )
+                gentime = atol( val );
+        }
+        fclose( fp );
+    }
+
+    if (  why == NULL  )
+    {
+        if (  version != REUSE_VERSION  )
+            why = "its description version is not supported";
+        else
+        if (  size != ctxt->fsz  )
+            why = "its size is different";
+        else
+        if (  (long)sbuf.st_size < size  )
+            why = "it is shorter than its description";
+        else
+        if (  (content != ctxt->content) ||
+              (compress != (long)((ctxt->compress * 100.0) + 0.5)) ||
+              (dedupe != (long)((ctxt->dedupe * 100.0) + 0.5))  )
+            why = "its content is different";
+        else
+        if (  ctxt->verify && ! verify  )
+            why = "it was not generated with '-verify'";
+    }
+    if (  why != NULL  )
+    {
+        fprintf( stderr, "\n*** Unable to reuse '%s', %s\n\n", ctxt->tfname, why );
+        free( (void *)iname );
+        return 1;
+    }
+    free( (void *)iname );
+
+    ctxt->reused = 1;
+    ctxt->gentime = gentime;
+    if (  ctxt->verify  )
+        ctxt->vseed = seed;
+    else
+    if (  verify && ! ctxt->nowrite && (ctxt->testmode != MODE_CREATE)  )
+        ctxt->reinfo = 1; // unverified writes will leave some blocks unstamped
+
+    return 0;
+} // readReuseInfo
+
+/*
+ * Remove reusable test files (CLEANUP mode). Only the CREATE mode file
+ * and the per thread files ('<file>-NN') found alongside it that have a
+ * valid description are removed.
+ */
+
+int
+cleanupFiles(
+             context_t * ctxt
+            )
+{
+    char * dname, * base, * tfname, * iname, * p;
+    DIR * dir;
+    struct dirent * de;
+    int nremoved = 0, ret = 0;
+    size_t blen, l;
+
+    dname = strdup( ctxt->fname );
+    if (  dname == NULL  )
+    {
+        fprintf( stderr, "*** Unable to malloc %'ld bytes\n", (long)strlen( ctxt->fname ) + 1 );
+        return 1;
+    }
+    if (  (p = strrchr( dname, '/' )) == NULL  )
+        base = ctxt->fname;
+    else
+    {
+        base = ctxt->fname + (p - dname) + 1;
+        p[1] = '\0';
+    }
+    blen = strlen( base );
+
+    errno = 0;
+    if (  (dir = opendir( (base == ctxt->fname) ? "." : dname )) == NULL  )
+    {
+        fprintf( stderr, "*** Unable to open directory for '%s' - %s\n",
+                 ctxt->fname, strerror(errno) );
+        free( (void *)dname );
+        return 1;
+    }
+    while (  (ret == 0) && ((de = readdir( dir )) != NULL)  )
+    {
+        if (  strncmp( de->d_name, base, blen ) != 0  )
+            continue;
+        p = de->d_name + blen;
+        if (  *p == '-'  )
+        {
+            for ( p++; isdigit( (unsigned char)*p ); p++ )
+                ;
+            if (  (p == de->d_name + blen + 1) || (*p != '\0')  )
+                continue;
+        }
+        else
+        if (  *p != '\0'  )
+            continue;
+
+        l = strlen( ctxt->fname ) + strlen( de->d_name + blen ) + 1;
+        tfname = (char *)calloc( l, sizeof(char) );
+        if (  tfname == NULL  )
+        {
+            fprintf( stderr, "*** Unable to malloc %'ld bytes\n", (long)l );
+            ret = 1;
+            break;
+        }
+        sprintf( tfname, "%s%s", ctxt->fname, de->d_name + blen );
+        if (  (iname = reuseInfoName( tfname )) == NULL  )
+            ret = 1;
+        else
+        if (  isReuseInfo( iname )  )
+        {
+            errno = 0;
+            if (  unlink( tfname ) && (errno != ENOENT)  )
+            {
+                fprintf( stderr, "*** Unable to remove '%s' - %s\n", tfname, strerror(errno) );
+                ret = 1;
+            }
+            else
+            {
+                unlink( iname );
+                printf("Removed '%s'\n", tfname );
+                nremoved++;
+            }
+        }
+        free( (void *)iname );
+        free( (void *)tfname );
+    }
+    closedir( dir );
+    free( (void *)dname );
+
+    if (  nremoved == 0  )
+        printf("No reusable test files found for '%s'\n", ctxt->fname );
+    printf("\n");
+
+    return ret;
+} // cleanupFiles
+
+/*
+ * Open the test file, optionally creating it.
+ */
+
+int
+openFile(
+          context_t * ctxt,
+          int create
+         )
+{
+    int flags, ret;
+    long startus, stopus;
+    struct stat sbuf;
+    struct statvfs fsbuf;
+
+    if (  create && ! stat( ctxt->tfname, &sbuf )  )
+    {
+        if (  ctxt->threads > 1  )
+            fprintf( stderr, "\n*** Thread %d: file '%s' already exists\n\n", 
+                     ctxt->threadno, ctxt->tfname );
+        else
+            fprintf( stderr, "\n*** File '%s' already exists\n\n", ctxt->tfname );
+        return 1;
+    }
+
+#if defined( ALLOW_RAW )
+    if (  ctxt->raw  )
+    {
+#if defined(ALLOW_RAWWRITE)
+        if (  ctxt->rawwrite && ! ctxt->nowrite  )
+            flags = O_RDWR;
+        else
+#endif /* ALLOW_RAWWRITE */
+            flags = O_RDONLY;
+    }
+    else
+    {
+        flags = O_RDWR;
+        if (  create  )
+            flags |= O_CREAT|O_EXCL;
+        if (  ! ctxt->nodsync  )
+            flags |= O_DSYNC;
+#if defined(LINUX)
+        if (  ! ctxt->cache  )
+            flags |= O_DIRECT;
+#endif /* LINUX */
+    }
+#else /* ! ALLOW_RAW */
+    flags = O_RDWR;
+    if (  create  )
+        flags |= O_CREAT|O_EXCL;
+    if (  ! ctxt->nodsync  )
+        flags |= O_DSYNC;
+#if defined(LINUX)
+    if (  ! ctxt->cache  )
+        flags |= O_DIRECT;
+#endif /* LINUX */
+#endif /* ! ALLOW_RAW */
+    errno = 0;
+    ctxt->fd = open( ctxt->tfname, flags, 0600 );
+    if (  ctxt->fd < 0  )
+    {
+        if (  ctxt->threads > 1  )
+            fprintf( stderr, "\n*** Thread %d: unable to %s file '%s' - %s\n\n",
+                     ctxt->threadno, create?"create":"open", ctxt->tfname, strerror(errno) );
+        else
+            fprintf( stderr, "\n*** Unable to %s file '%s' - %s\n\n",
+                     create?"create":"open", ctxt->tfname, strerror(errno) );
+        return 1;
+    }
+#if defined(SOLARIS)
+    if (  ctxt->cache  )
+        flags = DIRECTIO_OFF;
+    else
+        flags = DIRECTIO_ON;
+    errno = 0;
+    if (  directio( ctxt->fd, flags )  )
+    {
+        if (  ctxt->threads > 1  )
+            fprintf( stderr, "\n*** Thread %d: unable to %s caching for '%s'\n\n",
+                     ctxt->threadno, (flags==DIRECTIO_OFF)?"enable":"disable", ctxt->tfname );
+        else
+            fprintf( stderr, "\n*** Unable to %s caching for '%s'\n\n",
+                     (flags==DIRECTIO_OFF)?"enable":"disable", ctxt->tfname );
+    }
+#endif /* SOLARIS */
+
+#if defined( ALLOW_RAW )
+    if (  ! ctxt->raw  )
+    {
+#endif /* ALLOW_RAW */
+        if (  fstatvfs( ctxt->fd, &fsbuf ) == 0  )
+        {
+            if ( fsbuf.f_frsize > 0 )
+                ctxt->blksz = fsbuf.f_frsize;
+            if ( fsbuf.f_bsize > 0 )
+                ctxt->optiosz = fsbuf.f_bsize;
+        }
+#if defined( ALLOW_RAW )
+    }
+#endif /* ALLOW_RAW */
+
+#if defined(LINUX) || defined(SOLARIS)
+    if (  ! ctxt->cache  )
+    {
+        if (  ctxt->iosz % ctxt->blksz  )
+        {
+            if (  ctxt->threads > 1  )
+                fprintf( stderr, "\n*** Thread %d: value for '-iosz' is not a multiple of %'ld\n\n",
+                         ctxt->threadno, ctxt->blksz );
+            else
+                fprintf( stderr, "\n*** Value for '-iosz' is not a multiple of %'ld\n\n", ctxt->blksz );
+            close( ctxt->fd );
+            ctxt->fd = -1;
+            return 1;
+        }
+    }
+#endif /* LINUX || SOLARIS */
+
+#if defined(MACOS)
+    if (  ctxt->verbose && ! ctxt->usriosz && ! ctxt->optiosz  )
+    {
+        if (  ctxt->threads > 1  )
+            printf("\nThread %d: unable to determine optimal I/O size so using %'ld bytes\n\n",
+                    ctxt->threadno, DFLT_IOSZ );
+        else
+            printf("\nUnable to determine optimal I/O size so using %'ld bytes\n\n",
+                    DFLT_IOSZ );
+    }
+#endif /* MACOS */
+    if (  ! ctxt->optiosz  )
+        ctxt->optiosz = DFLT_IOSZ;
+
+#if defined(MACOS)
+#if defined( ALLOW_RAW )
+    if ( ! ctxt->raw  )
+    {
+#endif /* ALLOW_RAW */
+        if (  ! ctxt->rdahead  )
+        {
+            if (  fcntl( ctxt->fd, F_RDAHEAD, 0 )  )
+            {
+                if (  ctxt->threads > 1  )
+                    fprintf( stderr, "\n*** Thread %d: unable to disable read-ahead for '%s'\n\n",
+                             ctxt->threadno, ctxt->tfname );
+                else
+                    fprintf( stderr, "\n*** Unable to disable read-ahead for '%s'\n\n",
+                             ctxt->tfname );
+                close( ctxt->fd );
+                ctxt->fd = -1;
+                return 1;
+            }
+        }
+    
+        if (  ! ctxt->cache  )
+        {
+            if (  fcntl( ctxt->fd, F_NOCACHE, 1 )  )
+            {
+                if (  ctxt->threads > 1  )
+                    fprintf( stderr, "\n*** Thread %d: unable to disable caching for '%s'\n\n",
+                             ctxt->threadno, ctxt->tfname );
+                else
+                    fprintf( stderr, "\n*** : Unable to disable caching for '%s'\n\n",
+                             ctxt->tfname );
+                close( ctxt->fd );
+                ctxt->fd = -1;
+                return 1;
+            }
+        }
+#if defined( ALLOW_RAW )
+    }
+#endif /* ALLOW_RAW */
+#endif /* MACOS */
+
+    if ( ! ctxt->usrfile && ! ctxt->reused && ! ctxt->nopreallocate  )
+    {
+#if defined(LINUX) || defined(SOLARIS)
+        startus = getTimeAsUs();
+        ret = posix_fallocate( ctxt->fd, (off_t)0, (off_t)ctxt->fsz );
+        stopus = getTimeAsUs();
+        ctxt->preallocus = stopus - startus;
+        if (  ctxt->threads > 1  )
+        {
+            if (  ret == 0  )
+            {
+                if (  ctxt->verbose && (ctxt->threads <= VERBOSE_THREADS)  )
+                    printf("Thread %d: preallocated %'ld bytes in %'ld µs\n", ctxt->threadno, ctxt->fsz, ctxt->preallocus );
+            }
+            else
+            if (  (ctxt->threads <= VERBOSE_THREADS) || (ctxt->threadno == 0)  )
+                printf("Thread %d: preallocation failed or is not supported\n", ctxt->threadno );
+        }
+#else /* MACOS */
+        fstore_t prealloc;
+
+        // Let's try and pre-allocate the space, just for fun
+        prealloc.fst_flags = F_ALLOCATECONTIG|F_ALLOCATEALL;
+        prealloc.fst_posmode = F_PEOFPOSMODE;
+        prealloc.fst_offset = (off_t)0;
+        prealloc.fst_length = (off_t)ctxt->fsz;
+        prealloc.fst_bytesalloc = 0;
+        startus = getTimeAsUs();
+        ret = fcntl( ctxt->fd, F_PREALLOCATE, &prealloc );
+        stopus = getTimeAsUs();
+        ctxt->preallocus = stopus - startus;
+        if (  ret == 0  )
+        {
+            if (  ctxt->verbose && (ctxt->threads <= VERBOSE_THREADS)  )
+            {
+                if (  ctxt->threads > 1  )
+                    printf("Thread %d: preallocated %'ld contiguous bytes in %'ld µs\n",
+                            ctxt->threadno, (long)prealloc.fst_bytesalloc, ctxt->preallocus);
+            }
+        }
+        else
+        {
+            prealloc.fst_flags = F_ALLOCATEALL;
+            prealloc.fst_bytesalloc = 0;
+            startus = getTimeAsUs();
+            ret = fcntl( ctxt->fd, F_PREALLOCATE, &prealloc );
+            stopus = getTimeAsUs();
+            ctxt->preallocus = stopus - startus;
+            if (  ret == 0  )
+            {
+                if (  ctxt->verbose && (ctxt->threads <= VERBOSE_THREADS)  )
+                {
+                    if (  ctxt->threads > 1  )
+                        printf("Thread %d: preallocated %'ld bytes in %'ld µs\n",
+                                ctxt->threadno, (long)prealloc.fst_bytesalloc, ctxt->preallocus);
+                }
+            }
+            else
+            {
+                if (  ctxt->threads > VERBOSE_THREADS  )
+                {
+                    if (  ctxt->threadno == 0  )
+                        printf("Thread %d: preallocation failed or is not supported\n",
+                               ctxt->threadno );
+                }
+                else
+                if (  ctxt->threads > 1  )
+                    printf("Thread %d: preallocation failed or is not supported\n",
+                           ctxt->threadno );
+                else
+                    printf("Preallocation failed or is not supported\n");
+            }
+        }
+#endif /* MACOS */
+    } // pre-allocate
+
+    return 0;
+} // openFile
+
+
+#if defined(ALLOW_HUGEPAGES)
+/*
+ * Return the system's default huge page size.
+ */
+
+long
+hugePageSize(
+             void
+            )
+{
+    static long hpsz = 0;
+    char line[REUSE_LINESZ];
+    FILE * fp;
+    long kb;
+
+    if (  hpsz  )
+        return hpsz;
+    hpsz = DFLT_HUGEPAGESZ;
+    if (  (fp = fopen( "/proc/meminfo", "r" )) != NULL  )
+    {
+        while (  fgets( line, sizeof(line), fp ) != NULL  )
+            if (  sscanf( line, "Hugepagesize: %ld kB", &kb ) == 1  )
+            {
+                hpsz = kb * KB_MULT;
+                break;
+            }
+        fclose( fp );
+    }
+
+    return hpsz;
+} // hugePageSize
+#endif /* ALLOW_HUGEPAGES */
+
+/*
+ * Free an I/O buffer, unlocking it if it was locked.
+ */
+
+void
+freeBuffer(
+           context_t * ctxt,
+           void      * buf,
+           long        size,
+           int         locked
+          )
+{
+#if defined(ALLOW_HUGEPAGES)
+    long hpsz = hugePageSize();
+#endif /* ALLOW_HUGEPAGES */
+
+    if (  buf == NULL  )
+        return;
+    if (  locked && ctxt->lockbufs  )
+        munlock( buf, (size_t)size );
+#if defined(ALLOW_HUGEPAGES)
+    if (  ctxt->hugepages == BUF_HUGETLB  )
+        munmap( buf, (size_t)(((size + hpsz - 1) / hpsz) * hpsz) );
+    else
+#endif /* ALLOW_HUGEPAGES */
+        free( buf );
+} // freeBuffer
+
+/*
+ * Allocate a page aligned I/O buffer, using huge pages if requested.
+ * If 'prefault' is set the buffer is touched, and locked with '-mlock',
+ * so that using it during measurement does not cause page faults.
+ * Returns NULL, with errno set, on failure.
+ */
+
+void *
+allocBuffer(
+            context_t * ctxt,
+            long        size,
+            int         prefault
+           )
+{
+    void * buf = NULL;
+#if defined(ALLOW_HUGEPAGES)
+    long hpsz = hugePageSize();
+    long hsize = ((size + hpsz - 1) / hpsz) * hpsz;
+
+    if (  ctxt->hugepages == BUF_HUGETLB  )
+    {
+        buf = mmap( NULL, (size_t)hsize, PROT_READ|PROT_WRITE,
+                    MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0 );
+        if (  buf == MAP_FAILED  )
+            return NULL;
+    }
+    else
+    if (  ctxt->hugepages == BUF_THP  )
+    {
+        if (  (errno = posix_memalign( &buf, (size_t)hpsz, (size_t)hsize ))  )
+            return NULL;
+        madvise( buf, (size_t)hsize, MADV_HUGEPAGE );
+    }
+    else
+#endif /* ALLOW_HUGEPAGES */
+    if (  (buf = valloc( size )) == NULL  )
+        return NULL;
+
+    if (  prefault  )
+    {
+        memset( buf, 0, (size_t)size );
+        if (  ctxt->lockbufs && mlock( buf, (size_t)size )  )
+        {
+            int err = errno;
+
+            freeBuffer( ctxt, buf, size, 0 );
+            errno = err;
+            return NULL;
+        }
+    }
+
+    return buf;
+} // allocBuffer
+
+/*
+ * Zero content is never modified while a file is generated so all
+ * threads can write from a single shared generation buffer. Random
+ * content and '-verify' stamps are produced in place for every block.
+ */
+
+int
+shareGenBuffer(
+               context_t * ctxt
+              )
+{
+    return (ctxt->content == CONT_ZERO) && ! ctxt->verify;
+} // shareGenBuffer
+
+/*
+ * Acquire the file generation buffer for a context; the shared buffer
+ * if there is one, otherwise a private one that exists only while the
+ * file is being generated.
+ */
+
+int
+getGenBuffer(
+             context_t * ctxt
+            )
+{
+    if (  genShared != NULL  )
+    {
+        ctxt->genblk = genShared;
+        return 0;
+    }
+    if (  (ctxt->genblk = allocBuffer( ctxt, ctxt->geniosz, 0 )) == NULL  )
+    {
+        sprintf( ctxt->msgbuff, "unable to allocate %'ld bytes - %s",
+                 ctxt->geniosz, strerror(errno) );
+        return 1;
+    }
+    if (  ctxt->content == CONT_ZERO  )
+        memset( ctxt->genblk, 0, (size_t)ctxt->geniosz );
+
+    return 0;
+} // getGenBuffer
+
+/*
+ * Release a context's file generation buffer.
+ */
+
+void
+putGenBuffer(
+             context_t * ctxt
+            )
+{
+    if (  (ctxt->genblk != NULL) && (ctxt->genblk != genShared)  )
+        freeBuffer( ctxt, ctxt->genblk, ctxt->geniosz, 0 );
+    ctxt->genblk = NULL;
+} // putGenBuffer
+
+/*
+ * Free the shared file generation buffer, if any.
+ */
+
+void
+freeGenShared(
+              context_t * ctxt
+             )
+{
+    if (  genShared != NULL  )
+    {
+        freeBuffer( ctxt, genShared, genSharedSz, 0 );
+        genShared = NULL;
+        genSharedSz = 0L;
+    }
+} // freeGenShared
+
+/*
+ * Size the file generation buffer so that the I/O buffers of all threads,
+ * the dedupe pool and the generation buffer(s) fit within '-membudget'.
+ * The generation size is reduced, in whole I/O units, only if it was not
+ * specified explicitly. The budget covers every thread so this is called
+ * once, from the main thread, after all of the contexts are initialised.
+ */
+
+int
+fitMemBudget(
+             context_t   contexts[],
+             int         count
+            )
+{
+    long fixed, unit, avail, maxgen;
+    int i, ngen;
+
+    if (  contexts[0].membudget <= 0  )
+        return 0;
+
+    fixed = 0L;
+    for ( i = 0; i < count; i++ )
+        fixed += contexts[i].iosz;
+    if (  dedupePool != NULL  )
+        fixed += (long)DEDUPE_POOL * CONT_BLKSZ;
+    ngen = shareGenBuffer( &contexts[0] ) ? 1 : count;
+    avail = 0L;
+    if (  contexts[0].membudget > fixed  )
+        avail = (contexts[0].membudget - fixed) / ngen;
+
+    for ( i = 0; i < count; i++ )
+    {
+        unit = contexts[i].optiosz ? contexts[i].optiosz : contexts[i].blksz;
+        if (  (unit <= 0) || (contexts[i].verify && (unit % VERIFY_BLKSZ))  )
+            unit = VERIFY_BLKSZ;
+        maxgen = (avail / unit) * unit;
+        if (  contexts[i].geniosz <= maxgen  )
+            continue;
+        if (  (maxgen > 0) && ! contexts[i].usrgeniosz  )
+        {
+            contexts[i].geniosz = maxgen;
+            continue;
+        }
+
+        fprintf( stderr, "*** Memory budget of %'ld bytes is too small%s\n",
+                 contexts[i].membudget, contexts[i].usrgeniosz?" for '-geniosz'":"" );
+        return 1;
+    }
+
+    return 0;
+} // fitMemBudget
+
+/*
+ * Setup a bunch of stuff ready for the specific test.
+ */
+
+int
+initTests(
+          context_t * ctxt
+         )
+{
+    long nblocks, divvy, rem1, rem2;
+    int ret = 0;
+
+    if (  (ctxt->usrfile) || ctxt->reused || (ctxt->onefile && (ctxt->tgtno > 0))  )
+        ret = openFile( ctxt, 0 );
+    else
+        ret = openFile( ctxt, 1 );
+    if (  ret  )
+        return 1;
+
+    if (  ctxt->optiosz && ! ctxt->usriosz  )
+        ctxt->iosz = ctxt->optiosz;
+
+    if (  ctxt->optiosz && ! ctxt->usrgeniosz  )
+    {
+        divvy = DFLT_GENIOSZ / ctxt->optiosz;
+        rem1 = DFLT_GENIOSZ % ctxt->optiosz;
+        rem2 = (DFLT_GENIOSZ + ctxt->optiosz) % ctxt->optiosz;
+        ctxt->geniosz = (divvy * ctxt->optiosz);
+        if (  rem2 > rem1  )
+            ctxt->geniosz += ctxt->optiosz;
+    }
+
+    if (  ctxt->verify &&
+          ( (ctxt->iosz % VERIFY_BLKSZ) || (ctxt->geniosz % VERIFY_BLKSZ) )  )
+    {
+        if (  ctxt->threads > 1  )
+            fprintf( stderr, "*** Thread %d: '-verify' requires I/O sizes that are a multiple of %'d\n",
+                     ctxt->threadno, VERIFY_BLKSZ );
+        else
+            fprintf( stderr, "*** '-verify' requires I/O sizes that are a multiple of %'d\n",
+                     VERIFY_BLKSZ );
+        return 1;
+    }
+
+    ctxt->maxoffset = ((ctxt->fsz / ctxt->iosz) + 1) * ctxt->iosz;
+    nblocks = ( ctxt->maxoffset / ctxt->iosz );
+    if (  nblocks > (long)RAND_MAX  )
+        nblocks = (long)RAND_MAX + 1L;
+    ctxt->maxblock = nblocks - 1;
+
+    ctxt->ioblk = allocBuffer( ctxt, ctxt->iosz, 1 );
+    if (  ctxt->ioblk == NULL  )
+    {
+        if (  ctxt->threads > 1  )
+            fprintf( stderr, "*** Thread %d: unable to allocate %'ld bytes - %s\n", 
+                     ctxt->threadno, ctxt->iosz, strerror(errno) );
+        else
+            fprintf( stderr, "*** Unable to allocate %'ld bytes - %s\n", 
+                     ctxt->iosz, strerror(errno) );
+        return 1;
+    }
+
+    seedRandom( ctxt, (uint64_t)getTimeAsUs() ^ ((uint64_t)ctxt->threadno << 48) );
+    fillBuffer( ctxt, ctxt->ioblk, ctxt->iosz );
+
+    return 0;
+} // initTests
+
+#if defined(ALLOW_AFFINITY)
+/*
+ * Parse a Linux style CPU list ("0-3,8,10-11") into 'cpus'. Returns the
+ * number of CPUs in the list or -1 if the list is invalid.
+ */
+
+int
+parseCpuList(
+             char * str,
+             int    cpus[],
+             int    maxcpus
+            )
+{
+    long lo, hi;
+    char * p = str, * end;
+    int n = 0;
+
+    while (  *p && (*p != '\n')  )
+    {
+        errno = 0;
+        lo = strtol( p, &end, 10 );
+        if (  errno || (end == p) || (lo < 0) || (lo >= MAX_CPUS)  )
+            return -1;
+        hi = lo;
+        p = end;
+        if (  *p == '-'  )
+        {
+            p++;
+            hi = strtol( p, &end, 10 );
+            if (  errno || (end == p) || (hi < lo) || (hi >= MAX_CPUS)  )
+                return -1;
+            p = end;
+        }
+        for ( ; lo <= hi; lo++ )
+        {
+            if (  n >= maxcpus  )
+                return -1;
+            cpus[n++] = (int)lo;
+        }
+        if (  *p == ','  )
+            p++;
+        else
+        if (  *p && (*p != '\n')  )
+            return -1;
+    }
+
+    return n;
+} // parseCpuList
+
+/*
+ * Read a CPU (or node) list from a sysfs file. Returns the number of
+ * entries or -1 if the file cannot be read.
+ */
+
+int
+readCpuList(
+            char * path,
+            int    cpus[],
+            int    maxcpus
+           )
+{
+    FILE * fp;
+    char line[REUSE_LINESZ * 8];
+    int n = -1;
+
+    if (  (fp = fopen( path, "r" )) == NULL  )
+        return -1;
+    if (  fgets( line, sizeof(line), fp ) != NULL  )
+        n = parseCpuList( line, cpus, maxcpus );
+    fclose( fp );
+
+    return n;
+} // readCpuList
+
+/*
+ * Determine the NUMA node of the device holding an open file from sysfs.
+ * Returns -1 if it cannot be determined (for example for virtual or
+ * stacked devices).
+ */
+
+int
+deviceNode(
+           int fd
+          )
+{
+    struct stat sbuf;
+    dev_t dev;
+    char path[REUSE_LINESZ * 2];
+    char * dpath = NULL, * p;
+    FILE * fp;
+    int node = -1;
+
+    if (  fstat( fd, &sbuf )  )
+        return -1;
+    dev = S_ISBLK( sbuf.st_mode ) ? sbuf.st_rdev : sbuf.st_dev;
+    sprintf( path, "/sys/dev/block/%u:%u", major( dev ), minor( dev ) );
+    if (  (dpath = realpath( path, NULL )) == NULL  )
+        return -1;
+
+    // a partition's device is that of the disk that contains it
+    sprintf( path, "%.*s/partition", (int)sizeof(path) - 16, dpath );
+    if (  (access( path, F_OK ) == 0) && ((p = strrchr( dpath, '/' )) != NULL)  )
+        *p = '\0';
+
+    sprintf( path, "%.*s/device/numa_node", (int)sizeof(path) - 32, dpath );
+    if (  (fp = fopen( path, "r" )) == NULL  )
+    {
+        // NVMe namespaces hang off a controller
+        sprintf( path, "%.*s/device/device/numa_node", (int)sizeof(path) - 32, dpath );
+        fp = fopen( path, "r" );
+    }
+    if (  fp != NULL  )
+    {
+        if (  fscanf( fp, "%d", &node ) != 1  )
+            node = -1;
+        fclose( fp );
+    }
+    free( (void *)dpath );
+
+    return node;
+} // deviceNode
+
+/*
+ * Assign a CPU to each thread according to the requested placement.
+ * CPUs are taken from those the process may run on; threads wrap around
+ * if there are more threads than CPUs.
+ */
+
+int
+planAffinity(
+             context_t * mainctxt,
+             context_t   threadcontexts[],
+             int         numcontexts
+            )
+{
+    static int cpunode[MAX_CPUS];
+    int nodes[MAX_CPUS], cpus[MAX_CPUS], order[MAX_CPUS];
+    int allowed[MAX_CPUS];
+    int nnodes, ncpus, norder = 0, node = -1, i, j, k, more;
+    char path[REUSE_LINESZ];
+    cpu_set_t cset;
+
+    CPU_ZERO( &cset );
+    if (  sched_getaffinity( 0, sizeof(cset), &cset )  )
+    {
+        fprintf( stderr, "*** Unable to get CPU affinity - %d (%s)\n",
+                 errno, strerror(errno) );
+        return 1;
+    }
+    for ( i = 0; i < MAX_CPUS; i++ )
+    {
+        allowed[i] = (i < CPU_SETSIZE) && CPU_ISSET( i, &cset );
+        cpunode[i] = 0;
+    }
+
+    // map CPUs to NUMA nodes; without NUMA everything is node 0
+    nnodes = readCpuList( SYSFS_NODE "/online", nodes, MAX_CPUS );
+    if (  nnodes <= 0  )
+    {
+        nnodes = 1;
+        nodes[0] = 0;
+    }
+    for ( i = 0; i < nnodes; i++ )
+    {
+        sprintf( path, SYSFS_NODE "/node%d/cpulist", nodes[i] );
+        ncpus = readCpuList( path, cpus, MAX_CPUS );
+        for ( j = 0; j < ncpus; j++ )
+            cpunode[cpus[j]] = nodes[i];
+    }
+
+    mainctxt->devnode = deviceNode( threadcontexts[0].fd );
+    if (  (mainctxt->devnode < 0) && (nnodes == 1)  )
+        mainctxt->devnode = nodes[0];
+
+    switch (  mainctxt->affinity  )
+    {
+        case AFF_LIST:
+            norder = parseCpuList( mainctxt->cpulist, order, MAX_CPUS );
+            if (  norder <= 0  )
+            {
+                fprintf( stderr, "*** Invalid CPU list '%s'\n", mainctxt->cpulist );
+                return 1;
+            }
+            for ( i = 0; i < norder; i++ )
+                if (  ! allowed[order[i]]  )
+                {
+                    fprintf( stderr, "*** CPU %d is not available\n", order[i] );
+                    return 1;
+                }
+            break;
+
+        case AFF_COMPACT:
+            // fill each node in turn
+            for ( i = 0; i < nnodes; i++ )
+                for ( j = 0; j < MAX_CPUS; j++ )
+                    if (  allowed[j] && (cpunode[j] == nodes[i])  )
+                        order[norder++] = j;
+            break;
+
+        case AFF_SPREAD:
+            // take one CPU from each node in turn
+            for ( i = 0; i < nnodes; i++ )
+                cpus[i] = 0;
+            do {
+                more = 0;
+                for ( i = 0; i < nnodes; i++ )
+                {
+                    for ( j = cpus[i]; j < MAX_CPUS; j++ )
+                        if (  allowed[j] && (cpunode[j] == nodes[i])  )
+                            break;
+                    cpus[i] = j + 1;
+                    if (  j < MAX_CPUS  )
+                    {
+                        order[norder++] = j;
+                        more = 1;
+                    }
+                }
+            } while (  more  );
+            break;
+
+        case AFF_DEVICE:
+            // each target's threads use the CPUs on its own device's node
+            for ( i = 0; i < numcontexts; i++ )
+            {
+                if (  threadcontexts[i].tgtno == 0  )
+                {
+                    node = (i == 0) ? mainctxt->devnode : deviceNode( threadcontexts[i].fd );
+                    if (  (node < 0) && (nnodes == 1)  )
+                        node = nodes[0];
+                    if (  node < 0  )
+                    {
+                        fprintf( stderr, "*** Unable to determine the NUMA node for '%s'\n",
+                                 threadcontexts[i].tfname );
+                        return 1;
+                    }
+                    norder = 0;
+                    for ( j = 0; j < MAX_CPUS; j++ )
+                        if (  allowed[j] && (cpunode[j] == node)  )
+                            order[norder++] = j;
+                    if (  norder == 0  )
+                    {
+                        fprintf( stderr, "*** No CPUs available on NUMA node %d\n", node );
+                        return 1;
+                    }
+                }
+                k = order[threadcontexts[i].tgtno % norder];
+                threadcontexts[i].cpu = k;
+                threadcontexts[i].cpunode = cpunode[k];
+                threadcontexts[i].devnode = node;
+            }
+            return 0;
+    }
+
+    if (  norder == 0  )
+    {
+        fprintf( stderr, "*** No CPUs available for '%s' placement\n",
+                 affinityName( mainctxt->affinity ) );
+        return 1;
+    }
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        k = order[i % norder];
+        threadcontexts[i].cpu = k;
+        threadcontexts[i].cpunode = cpunode[k];
+        threadcontexts[i].devnode = mainctxt->devnode;
+    }
+
+    return 0;
+} // planAffinity
+
+/*
+ * Bind the calling thread to its assigned CPU and move its buffers to
+ * memory local to that CPU. The buffers were allocated by the main
+ * thread so they are reallocated here, where first touch places them.
+ */
+
+int
+bindThread(
+           context_t * ctxt
+          )
+{
+    cpu_set_t cset;
+    void * blk;
+
+    CPU_ZERO( &cset );
+    CPU_SET( ctxt->cpu, &cset );
+    if (  sched_setaffinity( 0, sizeof(cset), &cset )  )
+    {
+        sprintf( ctxt->msgbuff, "unable to bind to CPU %d - %d (%s)",
+                 ctxt->cpu, errno, strerror(errno) );
+        return 1;
+    }
+
+    if (  (blk = allocBuffer( ctxt, ctxt->iosz, 1 )) == NULL  )
+    {
+        sprintf( ctxt->msgbuff, "unable to allocate %'ld bytes - %s",
+                 ctxt->iosz, strerror(errno) );
+        return 1;
+    }
+    memcpy( blk, ctxt->ioblk, ctxt->iosz );
+    freeBuffer( ctxt, ctxt->ioblk, ctxt->iosz, 1 );
+    ctxt->ioblk = blk;
+
+    return 0;
+} // bindThread
+
+/*
+ * Report the thread placement.
+ */
+
+void
+reportAffinity(
+               context_t * mainctxt,
+               context_t   threadcontexts[],
+               int         numcontexts
+              )
+{
+    int i, n, node, next;
+
+    if (  ntargets > 1  )
+        printf("Thread placement is %s\n", affinityName( mainctxt->affinity ) );
+    else
+    if (  mainctxt->devnode >= 0  )
+        printf("Thread placement is %s, device NUMA node is %d\n",
+               affinityName( mainctxt->affinity ), mainctxt->devnode );
+    else
+        printf("Thread placement is %s, device NUMA node is unknown\n",
+               affinityName( mainctxt->affinity ) );
+    // summarise the threads on each node, in node order
+    for ( node = -1, n = 0; ; node = next, n = 0 )
+    {
+        next = -1;
+        for ( i = 0; i < numcontexts; i++ )
+        {
+            if (  threadcontexts[i].cpunode == node  )
+                n++;
+            else
+            if (  (threadcontexts[i].cpunode > node) &&
+                  ((next < 0) || (threadcontexts[i].cpunode < next))  )
+                next = threadcontexts[i].cpunode;
+        }
+        if (  n && (node < 0)  )
+            printf("%d thread%s not placed on a node\n", n, (n > 1) ? "s" : "" );
+        else
+        if (  n  )
+            printf("%d thread%s on node %d\n", n, (n > 1) ? "s" : "", node );
+        if (  next < 0  )
+            break;
+    }
+
+    if (  ! mainctxt->verbose || (numcontexts > VERBOSE_THREADS)  )
+        return;
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        if (  (i % 6) == 0  )
+            printf("%s", i ? "\n             " : "Thread CPUs: " );
+        printf("%d (node %d)%s", threadcontexts[i].cpu, threadcontexts[i].cpunode,
+               (i < (numcontexts - 1)) ? ", " : "\n" );
+    }
+} // reportAffinity
+#endif /* ALLOW_AFFINITY */
+
+/*
+ * Per thread initialisation (open, preallocate and allocate buffers) is
+ * shared out between a pool of workers so that it does not take a long
+ * time with large numbers of threads.
+ */
+
+struct s_initpool
+{
+    context_t * contexts;
+    int         count;
+    int         next;
+    int         failed;
+};
+
+typedef struct s_initpool initpool_t;
+
+void *
+initWorker(
+           void * arg
+          )
+{
+    initpool_t * pool = (initpool_t *)arg;
+    int i;
+
+    for ( ; ; )
+    {
+        pthread_mutex_lock( &phaseLock );
+        i = pool->failed ? pool->count : pool->next++;
+        pthread_mutex_unlock( &phaseLock );
+        if (  i >= pool->count  )
+            break;
+        if (  pool->contexts[i].tgtno == 0  )
+            continue;
+        if (  initTests( &pool->contexts[i] )  )
+        {
+            pthread_mutex_lock( &phaseLock );
+            pool->failed = 1;
+            pthread_mutex_unlock( &phaseLock );
+        }
+    }
+
+    return NULL;
+} // initWorker
+
+/*
+ * Initialise all but the first context of each target in parallel.
+ * Returns 0 on success and 1 if any of them failed.
+ */
+
+int
+initParallel(
+             context_t   contexts[],
+             int         count
+            )
+{
+    pthread_t workers[INIT_WORKERS];
+    initpool_t pool;
+    int i, nworkers;
+
+    pool.contexts = contexts;
+    pool.count = count;
+    pool.next = 0;
+    pool.failed = 0;
+
+    nworkers = ((count - ntargets) < INIT_WORKERS) ? (count - ntargets) : INIT_WORKERS;
+    for ( i = 0; i < nworkers; i++ )
+        if (  pthread_create( &workers[i], NULL, initWorker, (void *)&pool )  )
+            break;
+    nworkers = i;
+
+    // if no workers could be started do it all here
+    if (  nworkers == 0  )
+        initWorker( (void *)&pool );
+    for ( i = 0; i < nworkers; i++ )
+        pthread_join( workers[i], NULL );
+
+    return pool.failed;
+} // initParallel
+
+/*
+ * Make sure the open file limit allows one file per thread.
+ */
+
+void
+raiseFileLimit(
+               int nfiles
+              )
+{
+    struct rlimit rl;
+
+    if (  getrlimit( RLIMIT_NOFILE, &rl )  )
+        return;
+    if (  (rl.rlim_cur == RLIM_INFINITY) || (rl.rlim_cur >= (rlim_t)(nfiles + 64))  )
+        return;
+    rl.rlim_cur = (rlim_t)(nfiles + 64);
+    if (  (rl.rlim_max != RLIM_INFINITY) && (rl.rlim_cur > rl.rlim_max)  )
+        rl.rlim_cur = rl.rlim_max;
+    setrlimit( RLIMIT_NOFILE, &rl );
+} // raiseFileLimit
+
+/*
+ * Allocate and initialise the thread contexts.
+ */
+
+context_t *
+allocContexts(
+              context_t * mainctxt,
+              int         numcontexts
+             )
+{
+    context_t * contexts = NULL;
+    size_t l = (size_t)numcontexts * sizeof(context_t);
+    int i;
+
+    if (  posix_memalign( (void **)&contexts, CACHE_LINE_SZ, l )  )
+    {
+        fprintf( stderr, "*** Unable to allocate %'ld bytes for thread contexts\n", (long)l );
+        return NULL;
+    }
+    for ( i = 0; i < numcontexts; i++ )
+        memcpy( (void *)&contexts[i], (void *)mainctxt, sizeof(context_t) );
+
+    return contexts;
+} // allocContexts
+
+/*
+ * Setup the thread contexts for the test.
+ */
+
+int
+initContexts(
+             context_t * mainctxt,
+             context_t   threadcontexts[],
+             int         numcontexts
+            )
+{
+    int i, k, l, t = 0, j = 0, ret = 0;
+#if defined( ALLOW_RAW )
+    int fd;
+    struct stat sbuf;
+#endif /* ALLOW_RAW */
+
+#if defined( ALLOW_RAW )
+    if (  mainctxt->raw  )
+    {
+        errno = 0;
+        fd = open( mainctxt->fname, O_RDONLY, 0 );
+        if (  fd < 0  )
+        {
+            fprintf( stderr, "*** Unable to open '%s' - %d (%s)\n",
+                     mainctxt->fname, errno, strerror(errno) );
+            return 1;
+        }
+        if (  fstat( fd, &sbuf )  )
+        {
+            fprintf( stderr, "*** Unable to stat '%s' - %d (%s)\n",
+                     mainctxt->fname, errno, strerror(errno) );
+            close( fd );
+            return 1;
+        }
+        mainctxt->blksz = sbuf.st_blksize;
+        mainctxt->optiosz = sbuf.st_blksize;
+        mainctxt->fsz = findRawSize( fd, mainctxt->blksz );
+        if (  mainctxt->fsz <= 0  )
+        {
+            fprintf( stderr, "*** Unable to determine size for '%s'\n",
+                     mainctxt->fname );
+            close( fd );
+            return 1;
+        }
+        close( fd );
+    }
+#endif /* ALLOW_RAW */
+
+    if ( mainctxt->verbose && (mainctxt->threads > 1) )
+        printf("\n");
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        memcpy( (void *)&threadcontexts[i], (void *)mainctxt, sizeof(context_t) );
+        threadcontexts[i].threadno = i;
+        threadcontexts[i].fname = targets[t].fname;
+        threadcontexts[i].target = t;
+        threadcontexts[i].tgtno = j;
+        threadcontexts[i].tgtthreads = targets[t].threads;
+        if (  ++j >= targets[t].threads  )
+        {
+            t++;
+            j = 0;
+        }
+        l = strlen( threadcontexts[i].fname ) + 8;
+        threadcontexts[i].tfname = (char *)calloc( l, sizeof(char) );
+        if (  threadcontexts[i].tfname == NULL  )
+        {
+            if (  mainctxt->threads > 1  )
+                fprintf( stderr, "*** Thread %d: unable to malloc %d bytes\n",
+                         mainctxt->threadno, l );
+            else
+                fprintf( stderr, "*** Unable to malloc %d bytes\n", l );
+            ret = 1;
+            break;
+        }
+        threadcontexts[i].crfinished = 0;
+        threadcontexts[i].rdfinished = 0;
+        threadcontexts[i].wrfinished = 0;
+        if (  mainctxt->usrfile  )
+            strcpy( threadcontexts[i].tfname, mainctxt->fname );
+        else
+        if (  mainctxt->onefile  )
+            sprintf(  threadcontexts[i].tfname, "%s-%2.2d", threadcontexts[i].fname, 0  );
+        else
+            sprintf(  threadcontexts[i].tfname, "%s-%2.2d", threadcontexts[i].fname,
+                      threadcontexts[i].tgtno  );
+        if (  mainctxt->reuse  )
+        {
+            if (  mainctxt->onefile && (threadcontexts[i].tgtno > 0)  )
+            {
+                k = i - threadcontexts[i].tgtno;
+                threadcontexts[i].reused = threadcontexts[k].reused;
+                threadcontexts[i].vseed = threadcontexts[k].vseed;
+            }
+            else
+            if (  readReuseInfo( &threadcontexts[i] ) > 0  )
+            {
+                // leave the existing file alone
+                free( (void *)threadcontexts[i].tfname );
+                threadcontexts[i].tfname = NULL;
+                ret = 1;
+                break;
+            }
+        }
+    }
+
+    // the first thread of each target goes first as in single file mode
+    // it creates the shared file
+    for ( i = 0; (ret == 0) && (i < numcontexts); i++ )
+        if (  (threadcontexts[i].tgtno == 0) && initTests( &threadcontexts[i] )  )
+            ret = 1;
+    if (  (ret == 0) && (numcontexts > ntargets)  )
+        ret = initParallel( threadcontexts, numcontexts );
+    if (  ret == 0  )
+        ret = fitMemBudget( threadcontexts, numcontexts );
+
+    // the other per thread files are cloned from thread 0's file, which
+    // may be a reused file stamped with its own seed, so they take its seed
+    if (  mainctxt->clone && (ret == 0)  )
+        for ( i = 1; i < numcontexts; i++ )
+        {
+            threadcontexts[i].clonefd = threadcontexts[0].fd;
+            if (  ! threadcontexts[i].reused  )
+                threadcontexts[i].vseed = threadcontexts[0].vseed;
+        }
+
+#if defined(ALLOW_AFFINITY)
+    if (  (mainctxt->affinity != AFF_NONE) && (ret == 0)  )
+        ret = planAffinity( mainctxt, threadcontexts, numcontexts );
+#endif /* ALLOW_AFFINITY */
+
+    mainctxt->blksz = threadcontexts[0].blksz;
+    mainctxt->optiosz = threadcontexts[0].optiosz;
+    mainctxt->iosz = threadcontexts[0].iosz;
+    mainctxt->geniosz = threadcontexts[0].geniosz;
+
+    // the description is only rewritten once geniosz is final
+    for ( i = 0; (ret == 0) && (i < numcontexts); i++ )
+        if (  threadcontexts[i].reinfo && writeReuseInfo( &threadcontexts[i] )  )
+            ret = 1;
+
+    // one zero filled buffer serves every thread that generates a file,
+    // the targets may use different generation sizes so it fits the largest
+    if (  (ret == 0) && (numcontexts > 1) && shareGenBuffer( mainctxt ) &&
+          ! mainctxt->usrfile  )
+    {
+        genSharedSz = 0L;
+        for ( i = 0; i < numcontexts; i++ )
+            if (  ! threadcontexts[i].reused && (threadcontexts[i].geniosz > genSharedSz)  )
+                genSharedSz = threadcontexts[i].geniosz;
+        if (  genSharedSz > 0  )
+        {
+            genShared = allocBuffer( &threadcontexts[0], genSharedSz, 0 );
+            if (  genShared == NULL  )
+            {
+                fprintf( stderr, "*** Unable to allocate %'ld bytes - %s\n",
+                         genSharedSz, strerror(errno) );
+                genSharedSz = 0L;
+                ret = 1;
+            }
+            else
+                memset( genShared, 0, (size_t)genSharedSz );
+        }
+    }
+
+    // reusable files are kept unless this run failed to set them up
+    if (  ! mainctxt->usrfile && ( ! mainctxt->reuse || ret )  )
+    {
+        for ( i = 0; i < numcontexts; i++ )
+        {
+            if (  mainctxt->onefile && (threadcontexts[i].tgtno > 0)  )
+                continue;
+            if (  (threadcontexts[i].tfname != NULL) && ! threadcontexts[i].reused  )
+                unlink( threadcontexts[i].tfname );
+        }
+    }
+
+    return ret;
+} // initContexts
+
+/*
+ * cleanup the thread contexts.
+ */
+
+void
+cleanupContexts(
+                context_t  threadcontexts[],
+                int        numcontexts
+               )
+{
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        if (  threadcontexts[i].fd >= 0  )
+        {
+            close( threadcontexts[i].fd );
+            threadcontexts[i].fd = -1;
+        }
+        putGenBuffer( &threadcontexts[i] );
+        if (  threadcontexts[i].ioblk != NULL  )
+        {
+            freeBuffer( &threadcontexts[i], threadcontexts[i].ioblk,
+                        threadcontexts[i].iosz, 1 );
+            threadcontexts[i].ioblk = NULL;
+        }
+        // contexts that initContexts() did not reach still share the name
+        if (  (threadcontexts[i].tfname != NULL) &&
+              (threadcontexts[i].tfname != threadcontexts[i].fname)  )
+            free( (void *)threadcontexts[i].tfname );
+        threadcontexts[i].tfname = NULL;
+    }
+    if (  numcontexts > 0  )
+        freeGenShared( &threadcontexts[0] );
+} // cleanupContexts
+
+/*
+ * Write the test file for a context from its generation buffer. In single
+ * file mode each thread writes its own disjoint range of the shared file
+ * so that generation of large files is not limited to a single writer.
+ */
+
+int
+writeGenerated(
+               context_t * ctxt,
+               int doclose
+              )
+{
+    long numblks = 0L, remainder = 0L, blkno, firstblk, lastblk;
+    long startus, stopus;
+    ssize_t nbytes;
+
+    numblks = ctxt->fsz / ctxt->geniosz;
+    remainder = ctxt->fsz % ctxt->geniosz;
+    firstblk = 0L;
+    lastblk = numblks;
+    if (  ctxt->onefile && (ctxt->tgtthreads > 1)  )
+    {
+        // the last thread also writes any partial block at the end
+        firstblk = (numblks * ctxt->tgtno) / ctxt->tgtthreads;
+        lastblk = (numblks * (ctxt->tgtno + 1)) / ctxt->tgtthreads;
+        if (  ctxt->tgtno < (ctxt->tgtthreads - 1)  )
+            remainder = 0L;
+    }
+    ctxt->genbytes = ((lastblk - firstblk) * ctxt->geniosz) + remainder;
+
+    if (  stopReceived()  )
+        return RET_INTR;
+
+    ctxt->vgen++;
+    ctxt->gentime = (long)time( NULL );
+    ctxt->uscrstop = ctxt->uscrstart = getTimeAsUs();
+    for ( blkno = firstblk; blkno < lastblk; blkno++ )
+    {
+        fillBuffer( ctxt, ctxt->genblk, ctxt->geniosz );
+        if (  ctxt->verify  )
+            stampBlocks( ctxt, ctxt->genblk, ctxt->geniosz, blkno * ctxt->geniosz );
+        nbytes = pwrite( ctxt->fd, ctxt->genblk, (size_t)ctxt->geniosz,
+                         (off_t)(blkno * ctxt->geniosz) );
+        if (  nbytes != ctxt->geniosz  )
+        {
+            sprintf( ctxt->msgbuff, "%srite failed for block %'ld", 
+                     (ctxt->threads>1)?"w":"W", blkno );
+            return 1;
+        }
+        if (  stopReceived()  )
+            return RET_INTR;
+    }
+    if (  remainder > 0  )
+    {
+        fillBuffer( ctxt, ctxt->genblk, remainder );
+        if (  ctxt->verify  )
+            stampBlocks( ctxt, ctxt->genblk, remainder, blkno * ctxt->geniosz );
+        nbytes = pwrite( ctxt->fd, ctxt->genblk, (size_t)remainder,
+                         (off_t)(blkno * ctxt->geniosz) );
+        if (  nbytes != remainder  )
+        {
+            sprintf( ctxt->msgbuff, "%srite failed for block %'ld", 
+                     (ctxt->threads>1)?"w":"W", blkno );
+            return 1;
+        }
+    }
+
+    if (  stopReceived()  )
+        return RET_INTR;
+
+    if (  ctxt->nodsync && ! ctxt->nofsync  )
+    {
+        startus = getTimeAsUs();
+        errno = 0;
+#if defined(LINUX) || defined(SOLARIS)
+        if (  fdatasync( ctxt->fd )  )
+        {
+            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
+                     errno, strerror( errno )  );
+            return 1;
+        }
+#else /* MACOS */
+        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
+        {
+            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
+                     errno, strerror( errno )  );
+            return 1;
+        }
+#endif /* MACOS */
+        stopus = getTimeAsUs();
+        ctxt->fsyncus = stopus - startus;
+    }
+
+    if (  stopReceived()  )
+        return RET_INTR;
+
+    if (  doclose )
+    {
+        startus = getTimeAsUs();
+        close( ctxt->fd );
+        stopus = getTimeAsUs();
+        ctxt->fd = -1;
+        ctxt->closeus = stopus - startus;
+    }
+
+    ctxt->uscrstop = getTimeAsUs();
+    ctxt->crduration = ctxt->uscrstop - ctxt->uscrstart;
+
+    return 0;
+} // writeGenerated
+
+/*
+ * Generate the test file for a context. The generation buffer is only
+ * held for the duration of the generation.
+ */
+
+int
+generateFile(
+             context_t * ctxt,
+             int doclose
+            )
+{
+    int ret;
+
+    if (  getGenBuffer( ctxt )  )
+        return 1;
+    ret = writeGenerated( ctxt, doclose );
+    putGenBuffer( ctxt );
+
+    return ret;
+} // generateFile
+
+#if defined(ALLOW_CLONE)
+/*
+ * Populate a per thread test file from the template file generated by
+ * thread 0. A reflink clone is tried first, then copy_file_range() and
+ * if neither is supported the file is written as normal.
+ */
+
+int
+cloneFile(
+          context_t * ctxt
+         )
+{
+    long startus, stopus, remaining;
+    loff_t inoff = 0, outoff = 0;
+    ssize_t ncopied = 0;
+
+    if (  stopReceived()  )
+        return RET_INTR;
+
+    ctxt->uscrstop = ctxt->uscrstart = getTimeAsUs();
+    if (  ioctl( ctxt->fd, FICLONE, ctxt->clonefd ) == 0  )
+        ctxt->clonemethod = CLONE_REFLINK;
+#if defined(SYS_copy_file_range)
+    else
+    {
+        for ( remaining = ctxt->fsz; remaining > 0; remaining -= ncopied )
+        {
+            errno = 0;
+            ncopied = syscall( SYS_copy_file_range, ctxt->clonefd, &inoff,
+                               ctxt->fd, &outoff, (size_t)remaining, 0 );
+            if (  ncopied <= 0  )
+                break;
+            if (  stopReceived()  )
+                return RET_INTR;
+        }
+        if (  remaining <= 0  )
+            ctxt->clonemethod = CLONE_COPY;
+        else
+        if (  outoff > 0  )
+        {
+            sprintf( ctxt->msgbuff, "copy_file_range() failed at offset %'ld: %d (%s)",
+                     (long)outoff, errno, strerror( errno ) );
+            return 1;
+        }
+    }
+#endif /* SYS_copy_file_range */
+
+    if (  ctxt->clonemethod == CLONE_NONE  )
+    {
+        ctxt->clonemethod = CLONE_WRITE;
+        return generateFile( ctxt, 0 );
+    }
+
+    if (  ctxt->nodsync && ! ctxt->nofsync  )
+    {
+        startus = getTimeAsUs();
+        errno = 0;
+        if (  fdatasync( ctxt->fd )  )
+        {
+            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
+                     errno, strerror( errno )  );
+            return 1;
+        }
+        stopus = getTimeAsUs();
+        ctxt->fsyncus = stopus - startus;
+    }
+
+    ctxt->genbytes = ctxt->fsz;
+    ctxt->gentime = (long)time( NULL );
+    ctxt->uscrstop = getTimeAsUs();
+    ctxt->crduration = ctxt->uscrstop - ctxt->uscrstart;
+
+    return 0;
+} // cloneFile
+
+/*
+ * Report the results of provisioning test files by cloning. The time
+ * saved is estimated against writing every cloned file at the rate
+ * achieved for the template file.
+ */
+
+void
+reportClone(
+            context_t   threadcontexts[],
+            int         numcontexts
+           )
+{
+    int i, ncloned = 0, method = CLONE_NONE;
+    long start = 0L, stop = 0L, usclone, ustemplate, saved;
+    context_t * tmpl = &threadcontexts[0];
+
+    for ( i = 1; i < numcontexts; i++ )
+    {
+        if (  threadcontexts[i].reused  )
+            continue;
+        if (  (ncloned == 0) || (threadcontexts[i].uscrstart < start)  )
+            start = threadcontexts[i].uscrstart;
+        if (  threadcontexts[i].uscrstop > stop  )
+            stop = threadcontexts[i].uscrstop;
+        if (  threadcontexts[i].clonemethod > method  )
+            method = threadcontexts[i].clonemethod;
+        ncloned++;
+    }
+    usclone = stop - start;
+    ustemplate = tmpl->reused ? 0L : tmpl->crduration;
+
+    if (  ustemplate && (ustemplate >= 100000) && (tmpl->genbytes >= MB_MULT)  )
+        printf("Template write time = %'ld µs, rate = %.2f MB/s\n", ustemplate,
+               (((double)tmpl->genbytes/(double)MB_MULT)*1000000.0)/(double)ustemplate );
+    if (  method == CLONE_WRITE  )
+    {
+        printf("Cloning is not supported, %d file%s written in %'ld µs\n",
+               ncloned, (ncloned>1)?"s":"", usclone );
+        return;
+    }
+    printf("Cloned %d file%s using %s in %'ld µs\n",
+           ncloned, (ncloned>1)?"s":"", cloneName( method ), usclone );
+    saved = (ustemplate * ncloned) - usclone;
+    if (  ustemplate  )
+    {
+        if (  saved > 0  )
+            printf("Estimated time saved = %'ld µs\n", saved );
+        else
+            printf("Cloning was not faster than writing the files\n");
+    }
+    printf("NOTE: cloned files may share extents with the template so write results\n");
+    printf("      may be affected until all blocks have been overwritten\n");
+} // reportClone
+#endif /* ALLOW_CLONE */
+
+/*
+ * Generate a random block offset within the test file.
+ */
+
+long
+getRandomOffset(
+                context_t * ctxt
+               )
+{
+    double rval;
+
+    rval = ( (double)rand() * (double)ctxt->maxblock ) / (double)RAND_MAX;
+
+    return ctxt->iosz * (long)rval;
+} // getRandomOffset
+
+/*
+ * Write a test block at the current file offset, honouring the
+ * durability mode.
+ */
+
+ssize_t
+writeBlock(
+           context_t * ctxt
+          )
+{
+#if defined(ALLOW_RWFDSYNC)
+    struct iovec iov;
+
+    if (  ctxt->durability == DUR_RWFDSYNC  )
+    {
+        // offset -1 means use, and update, the current file offset
+        iov.iov_base = ctxt->ioblk;
+        iov.iov_len = (size_t)ctxt->iosz;
+        return pwritev2( ctxt->fd, &iov, 1, (off_t)-1, RWF_DSYNC );
+    }
+#endif /* ALLOW_RWFDSYNC */
+
+    return write( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
+} // writeBlock
+
+/*
+ * Account for a completed write and, if the durability mode calls for it
+ * and enough writes have accumulated, flush them. Each flush is timed
+ * separately and, while measuring, recorded in the flush histogram.
+ */
+
+int
+flushWrites(
+            context_t * ctxt,
+            long        offset,
+            int         measuring
+           )
+{
+    int ret = 0;
+    long startus, stopus;
+
+    if (  (ctxt->durability == DUR_DSYNC) || (ctxt->durability == DUR_RWFDSYNC)  )
+        return 0;
+
+    if (  (ctxt->sinceflush == 0) || (offset < ctxt->flushlo)  )
+        ctxt->flushlo = offset;
+    if (  (offset + ctxt->iosz) > ctxt->flushhi  )
+        ctxt->flushhi = offset + ctxt->iosz;
+    if (  ++ctxt->sinceflush < ctxt->syncint  )
+        return 0;
+
+    startus = getTimeAsUs();
+    errno = 0;
+    switch (  ctxt->durability  )
+    {
+        case DUR_FDATASYNC:
+#if defined(LINUX) || defined(SOLARIS)
+            ret = fdatasync( ctxt->fd );
+#else /* MACOS */
+            ret = ( fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1 );
+#endif /* MACOS */
+            break;
+
+        case DUR_FSYNC:
+            ret = fsync( ctxt->fd );
+            break;
+
+#if defined(ALLOW_SYNCRANGE)
+        case DUR_SYNCRANGE:
+            ret = sync_file_range( ctxt->fd, (off_t)ctxt->flushlo,
+                                   (off_t)(ctxt->flushhi - ctxt->flushlo),
+                                   SYNC_FILE_RANGE_WAIT_BEFORE |
+                                   SYNC_FILE_RANGE_WRITE |
+                                   SYNC_FILE_RANGE_WAIT_AFTER );
+            break;
+#endif /* ALLOW_SYNCRANGE */
+    }
+    stopus = getTimeAsUs();
+    if (  ret  )
+    {
+        sprintf( ctxt->msgbuff, "%s failed at offset %'ld: %d (%s)",
+                 flushCallName( ctxt->durability ),
+                 offset, errno, strerror( errno )  );
+        return 1;
+    }
+
+    if (  measuring  )
+    {
+        ctxt->nflushes++;
+        ctxt->flushus += (stopus - startus);
+        histRecord( &ctxt->flushhist, stopus - startus );
+    }
+    ctxt->sinceflush = 0;
+    ctxt->flushlo = ctxt->flushhi = 0;
+
+    return 0;
+} // flushWrites
+
+#if defined(ALLOW_DISCARD)
+
+/*
+ * Should the next write phase operation be a discard?
+ */
+
+int
+isDiscardOp(
+            context_t * ctxt
+           )
+{
+    if (  ctxt->discard == DISC_NONE  )
+        return 0;
+    if (  ctxt->discardpct >= MAX_DISCPCT  )
+        return 1;
+
+    // the thread's own generator, as rand() is shared by all threads
+    return ( (int)(nextRandom( ctxt ) % 100) < ctxt->discardpct );
+} // isDiscardOp
+
+/*
+ * Discard (or zero) one test block at 'offset'. The operation is timed
+ * and, while measuring, recorded in the discard histogram.
+ */
+
+int
+discardBlock(
+             context_t * ctxt,
+             long        offset,
+             int         measuring
+            )
+{
+    int ret = 0;
+    long startus, stopus;
+    unsigned long long range[2];
+
+    range[0] = (unsigned long long)offset;
+    range[1] = (unsigned long long)ctxt->iosz;
+
+    startus = getTimeAsUs();
+    errno = 0;
+    switch (  ctxt->discard  )
+    {
+        case DISC_TRIM:
+            ret = ioctl( ctxt->fd, BLKDISCARD, range );
+            break;
+
+        case DISC_ZEROOUT:
+            ret = ioctl( ctxt->fd, BLKZEROOUT, range );
+            break;
+
+        case DISC_PUNCH:
+            ret = fallocate( ctxt->fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,
+                             (off_t)offset, (off_t)ctxt->iosz );
+            break;
+
+        case DISC_ZERO:
+            ret = fallocate( ctxt->fd, FALLOC_FL_ZERO_RANGE|FALLOC_FL_KEEP_SIZE,
+                             (off_t)offset, (off_t)ctxt->iosz );
+            break;
+    }
+    stopus = getTimeAsUs();
+    if (  ret  )
+    {
+        sprintf( ctxt->msgbuff, "%siscard (%s) failed at offset %'ld - %d (%s)",
+                 (ctxt->threads>1)?"d":"D", discardName( ctxt->discard ),
+                 offset, errno, strerror(errno) );
+        return 1;
+    }
+
+    if (  measuring  )
+    {
+        ctxt->ndiscards++;
+        histRecord( &ctxt->discardhist, stopus - startus );
+    }
+
+    return 0;
+} // discardBlock
+
+#endif /* ALLOW_DISCARD */
+
+/*
+ * Perform the random I/O test.
+ */
+
+int
+testIOPSRandom(
+               context_t * ctxt,
+               int         readops,
+               int         doclose
+              )
+{
+    int measuring = 0, done;
+    long iooffset, startus = 0L, stopus, cpustart = 0L;
+    off_t res;
+    ssize_t nbytes;
+
+    ctxt->verifyus = ctxt->contentus = 0;
+    if (  ! readops  )
+        ctxt->vgen++;
+    if (  ctxt->tstate == MEASURE  )
+    {
+        measuring = 1;
+        if (  readops )
+            ctxt->usrdstart = getTimeAsUs();
+        else
+            ctxt->uswrstart = getTimeAsUs();
+        cpustart = getThreadCpuUs();
+        perfStart( ctxt );
+    }
+    done = 0;
+
+    while ( ! done )
+    {
+        iooffset = getRandomOffset( ctxt );
+        res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
+        if (  res != (off_t)iooffset  )
         {
-            if (  foundFile  )
-            {
-                fprintf( stderr, "\n*** Multiple '-file' options not allowed\n" );
-                return 1;
-            }
-            if (  foundUsrfile )
-            {
-                fprintf( stderr, "\n*** '-file' is incompatible with a user specified filename\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
-            {
-                fprintf( stderr, "\n*** Missing value for '-file'\n" );
-                return 1;
-            }
-            ctxt->fname = argv[argno];
-            foundFile = 1;
+            sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
+                     (ctxt->threads>1)?"s":"S", iooffset );
+            return 1;
         }
-        else
-        if (  strcmp( argv[argno], "-fsize" ) == 0  )
+        if (  readops  )
         {
-            if (  foundFsize  )
-            {
-                fprintf( stderr, "\n*** Multiple '-fsize' options not allowed\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
+            if (  measuring  )
+                ctxt->nreads++;
+            else
+                ctxt->nrampops++;
+            errno = 0;
+            if (  measuring && ctxt->iolat  )
+                startus = getTimeAsUs();
+            nbytes = read( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
+            if (  measuring && ctxt->iolat  )
+                histRecord( &ctxt->rdhist, getTimeAsUs() - startus );
+            if (  nbytes != ctxt->iosz  )
             {
-                fprintf( stderr, "\n*** Missing value for '-fsize'\n" );
+                sprintf( ctxt->msgbuff, 
+                         "%sead failed at offset %'ld - %d (%s)",
+                         (ctxt->threads>1)?"r":"R", iooffset, errno, strerror(errno) );
                 return 1;
             }
-            if (  valueConvert( argv[argno], &ctxt->fsz )  )
-            {
-                fprintf( stderr, "\n*** Invalid value for '-fsize'\n" );
+            if (  ctxt->verify && verifyIO( ctxt, iooffset, measuring )  )
                 return 1;
-            }
-            foundFsize = 1;
         }
         else
-        if (  strcmp( argv[argno], "-iosz" ) == 0  )
+#if defined(ALLOW_DISCARD)
+        if (  isDiscardOp( ctxt )  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundIosz  )
-            {
-                fprintf( stderr, "\n*** Multiple '-iosz' options not allowed\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
-            {
-                fprintf( stderr, "\n*** Missing value for '-iosz'\n" );
-                return 1;
-            }
-            if (  valueConvert( argv[argno], &ctxt->iosz )  )
-            {
-                fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
+            if (  discardBlock( ctxt, iooffset, measuring )  )
                 return 1;
-            }
-            if (  (ctxt->iosz < MIN_IOSZ) || (ctxt->iosz > MAX_IOSZ)  )
-            {
-                fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
-                return 1;
-            }
-            ctxt->usriosz = foundIosz = 1;
         }
         else
-        if (  strcmp( argv[argno], "-threads" ) == 0  )
+#endif /* ALLOW_DISCARD */
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundThreads )
-            {
-                fprintf( stderr, "\n*** Multiple '-threads' options not allowed\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
+            if (  measuring  )
+                ctxt->nwrites++;
+            else
+                ctxt->nrampops++;
+            if (  ctxt->content != CONT_ZERO  )
+                fillIO( ctxt, measuring );
+            if (  ctxt->verify  )
+                stampIO( ctxt, iooffset, measuring );
+            errno = 0;
+            if (  measuring && ctxt->iolat  )
+                startus = getTimeAsUs();
+            nbytes = writeBlock( ctxt );
+            if (  measuring && ctxt->iolat  )
+                histRecord( &ctxt->wrhist, getTimeAsUs() - startus );
+            if (  nbytes != ctxt->iosz  )
             {
-                fprintf( stderr, "\n*** Missing value for '-threads'\n" );
+                sprintf( ctxt->msgbuff, 
+                         "%srite failed at offset %'ld - %d (%s)",
+                         (ctxt->threads>1)?"w":"W", iooffset, errno, strerror(errno) );
                 return 1;
             }
-            if (  intConvert( argv[argno], &ctxt->threads )  )
-            {
-                fprintf( stderr, "\n*** Invalid value for '-threads'\n" );
+            if (  flushWrites( ctxt, iooffset, measuring )  )
                 return 1;
-            }
-            foundThreads = 1;
         }
-        else
-        if (  strcmp( argv[argno], "-dur" ) == 0  )
+
+        if (  ( ctxt->tstate == STOP ) || ( ctxt->tstate == END )  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundDur )
-            {
-                fprintf( stderr, "\n*** Multiple '-dur' options not allowed\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
-            {
-                fprintf( stderr, "\n*** Missing value for '-dur'\n" );
-                return 1;
-            }
-            if (  intConvert( argv[argno], &ctxt->duration )  )
+            if (  readops  )
             {
-                fprintf( stderr, "\n*** Invalid value for '-dur'\n" );
-                return 1;
+                if (  ctxt->usrdstart && ! ctxt->usrdstop  )
+                {
+                    ctxt->usrdstop = getTimeAsUs();
+                    ctxt->rdcpuus = getThreadCpuUs() - cpustart;
+                    perfStop( ctxt, ctxt->rdperf );
+                }
             }
-            if (  (ctxt->duration < MIN_DUR) || (ctxt->duration > MAX_DUR)  )
+            else
             {
-                fprintf( stderr, "\n*** Invalid value for '-dur'\n" );
-                return 1;
+                if (  ctxt->uswrstart && ! ctxt->uswrstop  )
+                {
+                    ctxt->uswrstop = getTimeAsUs();
+                    ctxt->wrcpuus = getThreadCpuUs() - cpustart;
+                    perfStop( ctxt, ctxt->wrperf );
+                }
             }
-            foundDur = 1;
+            measuring = 0;
+            done = 1;
         }
         else
-        if (  strcmp( argv[argno], "-ramp" ) == 0  )
+        if (  ctxt->tstate == RAMP  )
         {
-            if (  ctxt->testmode == MODE_CREATE  )
-            {
-                fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
-                return 1;
-            }
-            if (  foundRamp )
-            {
-                fprintf( stderr, "\n*** Multiple '-ramp' options not allowed\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
-            {
-                fprintf( stderr, "\n*** Missing value for '-ramp'\n" );
-                return 1;
-            }
-            if (  intConvert( argv[argno], &ctxt->ramp )  )
-            {
-                fprintf( stderr, "\n*** Invalid value for '-ramp'\n" );
-                return 1;
-            }
-            if (  (ctxt->ramp < MIN_RAMP) || (ctxt->ramp > MAX_RAMP)  )
+            if (  measuring  )
             {
-                fprintf( stderr, "\n*** Invalid value for '-ramp'\n" );
-                return 1;
+                if (  readops  )
+                {
+                    if (  ctxt->usrdstart && ! ctxt->usrdstop  )
+                    {
+                        ctxt->usrdstop = getTimeAsUs();
+                        ctxt->rdcpuus = getThreadCpuUs() - cpustart;
+                        perfStop( ctxt, ctxt->rdperf );
+                    }
+                }
+                else
+                {
+                    if (  ctxt->uswrstart && ! ctxt->uswrstop  )
+                    {
+                        ctxt->uswrstop = getTimeAsUs();
+                        ctxt->wrcpuus = getThreadCpuUs() - cpustart;
+                        perfStop( ctxt, ctxt->wrperf );
+                    }
+                }
+                measuring = 0;
             }
-            foundRamp = 1;
         }
         else
-        if (  strcmp( argv[argno], "-geniosz" ) == 0  )
+        if (  ctxt->tstate == MEASURE  )
         {
-            if (  foundGeniosz  )
-            {
-                fprintf( stderr, "\n*** Multiple '-geniosz' options not allowed\n" );
-                return 1;
-            }
-            if (  foundUsrfile )
-            {
-                fprintf( stderr, "\n*** '-geniosize' is incompatible with a user specified filename\n" );
-                return 1;
-            }
-            if (  ++argno >= argc  )
-            {
-                fprintf( stderr, "\n*** Missing value for '-geniosz'\n" );
-                return 1;
-            }
-            if (  valueConvert( argv[argno], &ctxt->geniosz )  )
+            if ( ! measuring )
             {
-                fprintf( stderr, "\n*** Invalid value for '-geniosz'\n" );
-                return 1;
+                if (  readops )
+                    ctxt->usrdstart = getTimeAsUs();
+                else
+                    ctxt->uswrstart = getTimeAsUs();
+                cpustart = getThreadCpuUs();
+                perfStart( ctxt );
+                measuring = 1;
             }
-            ctxt->usrgeniosz = foundGeniosz = 1;
         }
-        else
+    }
+
+    if (  ! readops && ctxt->nodsync && ! ctxt->nofsync  )
+    {
+        startus = getTimeAsUs();
+        errno = 0;
+#if defined(LINUX) || defined(SOLARIS)
+        if (  fdatasync( ctxt->fd )  )
         {
-            fprintf( stderr, "\n*** Invalid argument '%s'\n", argv[argno] );
+            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
+                     errno, strerror( errno )  );
             return 1;
         }
-        argno += 1;
+#else /* MACOS */
+        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
+        {
+            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
+                     errno, strerror( errno )  );
+            return 1;
+        }
+#endif /* MACOS */
+        stopus = getTimeAsUs();
+        ctxt->fsyncus = stopus - startus;
     }
+    else
+        ctxt->fsyncus = 0;
 
-    ctxt->tfname = ctxt->fname;
+    if (  doclose  )
+    {
+            startus = getTimeAsUs();
+            close( ctxt->fd );
+            stopus = getTimeAsUs();
+            ctxt->closeus = stopus - startus;
+            ctxt->fd = -1;
+    }
+    else
+        ctxt->closeus = 0;
 
-    if (  foundFsize && ( (ctxt->fsz < MIN_FSIZE) || (ctxt->fsz > MAX_FSIZE) )  )
+    if (  readops  )
+        ctxt->rdduration = ctxt->usrdstop - ctxt->usrdstart;
+    else
+        ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus;
+        // ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus + ctxt->closeus;
+
+    return 0;
+} // testIOPSRandom
+
+/*
+ * Perform the sequential I/O test.
+ */
+
+int
+testIOPSSequential(
+                   context_t * ctxt,
+                   int         readops,
+                   int         doclose
+                  )
+{
+    int measuring = 0, done;
+    long iooffset, startus = 0L, stopus, cpustart = 0L;
+    off_t res;
+    ssize_t nbytes;
+
+    // position to start of file
+    iooffset = 0;
+    res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
+    if (  res != (off_t)iooffset  )
     {
-        fprintf( stderr, "\n*** Invalid value for '-fsize'\n" );
+        sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
+                 (ctxt->threads>1)?"s":"S", iooffset );
         return 1;
     }
 
-    if (  ctxt->usrfile  )
+    // perform test
+    ctxt->verifyus = ctxt->contentus = 0;
+    if (  ! readops  )
+        ctxt->vgen++;
+    if (  ctxt->tstate == MEASURE  )
     {
-#if defined( ALLOW_RAW )
-        if (  ctxt->rawwrite < 0  )
-            ctxt->rawwrite = 0;
-        errno = 0;
-        fd = open( ctxt->fname, O_RDONLY );
-        if (  fd < 0  )
-        {
-            fprintf( stderr, "\n*** Unable to open '%s'  - %d (%s)\n", ctxt->fname,
-                     errno, strerror(errno) );
-            return 1;
-        }
-        errno = 0;
-        if (  fstat( fd, &sbuf )  )
-        {
-            fprintf( stderr, "\n*** Unable to stat '%s'   - %d (%s)\n", ctxt->fname,
-                     errno, strerror(errno) );
-            close( fd );
-            return 1;
-        }
-        if (  ! ( sbuf.st_mode & S_IFREG ) &&
-              ! ( sbuf.st_mode & S_IFCHR ) &&
-              ! ( sbuf.st_mode & S_IFBLK )  )
+        measuring = 1;
+        if (  readops )
+            ctxt->usrdstart = getTimeAsUs();
+        else
+            ctxt->uswrstart = getTimeAsUs();
+        cpustart = getThreadCpuUs();
+        perfStart( ctxt );
+    }
+    done = 0;
+
+    do {
+        if (  readops  )
         {
-            fprintf( stderr, "\n*** '%s' is not a regular, block or raw file\n", ctxt->fname );
-            close( fd );
-            return 1;
+            if (  measuring  )
+                ctxt->nreads++;
+            else
+                ctxt->nrampops++;
+            if (  measuring && ctxt->iolat  )
+                startus = getTimeAsUs();
+            nbytes = read( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
+            if (  measuring && ctxt->iolat  )
+                histRecord( &ctxt->rdhist, getTimeAsUs() - startus );
+            if (  ctxt->verify && (nbytes == ctxt->iosz) &&
+                  verifyIO( ctxt, iooffset, measuring )  )
+                return 1;
         }
-        if (  ( sbuf.st_mode & S_IFCHR ) || ( sbuf.st_mode & S_IFBLK )  )
+        else
+#if defined(ALLOW_DISCARD)
+        if (  isDiscardOp( ctxt )  )
         {
-            ctxt->raw = 1;
-            if (  sbuf.st_mode & S_IFBLK  )
-                ctxt->blk = 1;
-            if (  foundRdahead  )
-            {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, '-rdahead' not allowed\n", ctxt->fname );
-                close( fd );
-                return 1;
-            }
-            if (  foundCache  )
-            {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, '-cache' not allowed\n", ctxt->fname );
-                close( fd );
-                return 1;
-            }
-            if (  foundNopreallocate  )
-            {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nopreallocate' not allowed\n", ctxt->fname );
-                close( fd );
+            if (  discardBlock( ctxt, iooffset, measuring )  )
                 return 1;
-            }
-            if (  foundNodsync  )
+            // step over the discarded block
+            nbytes = ctxt->iosz;
+            res = lseek( ctxt->fd, (off_t)(iooffset + ctxt->iosz), SEEK_SET );
+            if (  res != (off_t)(iooffset + ctxt->iosz)  )
             {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nodsync' not allowed\n", ctxt->fname );
-                close( fd );
+                sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
+                         (ctxt->threads>1)?"s":"S", iooffset + ctxt->iosz );
                 return 1;
             }
-            if (  foundNofsync  )
-            {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, '-nofsync' not allowed\n", ctxt->fname );
-                close( fd );
+        }
+        else
+#endif /* ALLOW_DISCARD */
+        {
+            if (  measuring  )
+                ctxt->nwrites++;
+            else
+                ctxt->nrampops++;
+            if (  ctxt->content != CONT_ZERO  )
+                fillIO( ctxt, measuring );
+            if (  ctxt->verify  )
+                stampIO( ctxt, iooffset, measuring );
+            if (  measuring && ctxt->iolat  )
+                startus = getTimeAsUs();
+            nbytes = writeBlock( ctxt );
+            if (  measuring && ctxt->iolat  )
+                histRecord( &ctxt->wrhist, getTimeAsUs() - startus );
+            if (  (nbytes == ctxt->iosz) && flushWrites( ctxt, iooffset, measuring )  )
                 return 1;
-            }
-            if (  ctxt->noread && ! ctxt->rawwrite  )
+        }
+        iooffset += ctxt->iosz;
+        if (  (nbytes == 0) || (iooffset >= ctxt->fsz)  )
+        { // wrap to beginning of file
+            iooffset = 0;
+            res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
+            if (  res != (off_t)iooffset  )
             {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not enabled and '-noread' specified\n",
-                         ctxt->fname );
-                close( fd );
+                sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
+                         (ctxt->threads>1)?"s":"S", iooffset );
                 return 1;
             }
-            if (  ctxt->noread  )
+
+        }
+
+        if (  ( ctxt->tstate == STOP ) || ( ctxt->tstate == END )  )
+        {
+            if (  readops  )
             {
-#if ! defined(ALLOW_RAWWRITE)
-                fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not allowed and '-noread' specified\n",
-                         ctxt->fname );
-                close( fd );
-                return 1;
-#else  /* ALLOW_RAWWRITE */
-                if (  ! ctxt->rawwrite  )
+                if (  ctxt->usrdstart && ! ctxt->usrdstop  )
                 {
-                    fprintf( stderr, "\n*** '%s' is a block or raw file, raw writes are not enabled and '-noread' specified\n",
-                             ctxt->fname );
-                    close( fd );
-                    return 1;
+                    ctxt->usrdstop = getTimeAsUs();
+                    ctxt->rdcpuus = getThreadCpuUs() - cpustart;
+                    perfStop( ctxt, ctxt->rdperf );
                 }
-#endif /* ALLOW_RAWWRITE */
-            }
-#if ! defined(ALLOW_RAWWRITE)
-            ctxt->nowrite = foundNowrite = 1;
-#else  /* ALLOW_RAWWRITE */
-            if (  ! ctxt->nowrite  )
-            {
-                if (  ! ctxt->rawwrite  )
-                    ctxt->nowrite = foundNowrite = 1;
-            }
-#endif /* ALLOW_RAWWRITE */
-
-            ctxt->blksz = sbuf.st_blksize;
-            if (  foundIosz && ( ( ctxt->iosz % ctxt->blksz ) != 0 )  )
-            {
-                fprintf( stderr, "\n*** '%s' is a block or raw file, value for '-iosz' must be a multiple of %'ld\n",
-                         ctxt->fname, ctxt->blksz );
-                close( fd );
-                return 1;
             }
-
-            fsz = findRawSize( fd, ctxt->blksz );
-            if (  fsz <= 0  )
+            else
             {
-                fprintf( stderr, "*** Unable to determine size for '%s'\n", ctxt->fname );
-                close( fd );
-                return 1;
+                if (  ctxt->uswrstart && ! ctxt->uswrstop  )
+                {
+                    ctxt->uswrstop = getTimeAsUs();
+                    ctxt->wrcpuus = getThreadCpuUs() - cpustart;
+                    perfStop( ctxt, ctxt->wrperf );
+                }
             }
-
-            close( fd );
+            measuring = 0;
+            done = 1;
         }
         else
-            fsz = sbuf.st_size;
-#else /* !ALLOW_RAW */
-        errno = 0;
-        if (  stat( ctxt->fname, &sbuf )  )
-        {
-            fprintf( stderr, "\n*** Unable to stat '%s'   - %d (%s)\n", ctxt->fname,
-                     errno, strerror(errno) );
-            return 1;
-        }
-        if (  ! ( sbuf.st_mode & S_IFREG )  )
-        {
-            fprintf( stderr, "\n*** '%s' is not a regular file\n", ctxt->fname );
-            return 1;
-        }
-        fsz = sbuf.st_size;
-#endif /* ALLOW_RAW */
-        if (  foundFsize  )
+        if (  ctxt->tstate == RAMP  )
         {
-            if (  ctxt->fsz > fsz  )
+            if (  measuring  )
             {
-                fprintf( stderr, "\n*** Value specified for '-fsize' (%'ld) is greater than size of '%s'\n",
-                         ctxt->fsz, ctxt->fname );
-                return 1;
+                if (  readops  )
+                {
+                    if (  ctxt->usrdstart && ! ctxt->usrdstop  )
+                    {
+                        ctxt->usrdstop = getTimeAsUs();
+                        ctxt->rdcpuus = getThreadCpuUs() - cpustart;
+                        perfStop( ctxt, ctxt->rdperf );
+                    }
+                }
+                else
+                {
+                    if (  ctxt->uswrstart && ! ctxt->uswrstop  )
+                    {
+                        ctxt->uswrstop = getTimeAsUs();
+                        ctxt->wrcpuus = getThreadCpuUs() - cpustart;
+                        perfStop( ctxt, ctxt->wrperf );
+                    }
+                }
+                measuring = 0;
             }
         }
         else
+        if (  ctxt->tstate == MEASURE  )
         {
-            if (  fsz < MIN_FSIZE  )
-            {
-                fprintf( stderr, "\n*** File size (%'lld) less than %'ld\n", fsz, (long)MIN_FSIZE );
-                return 1;
-            }
-            if (  fsz > MAX_FSIZE  )
+            if ( ! measuring )
             {
-                fprintf( stderr, "\n*** File size (%'lld) greater than %'ld\n", fsz, (long)MAX_FSIZE );
-                return 1;
+                if (  readops )
+                    ctxt->usrdstart = getTimeAsUs();
+                else
+                    ctxt->uswrstart = getTimeAsUs();
+                cpustart = getThreadCpuUs();
+                perfStart( ctxt );
+                measuring = 1;
             }
-            ctxt->fsz = (long)fsz;
         }
-    } // usrfile
-
-    if (  (ctxt->geniosz < 1) || (ctxt->geniosz > ctxt->fsz)  )
-    {
-        fprintf( stderr, "\n*** Invalid value for '-geniosz'\n" );
-        return 1;
-    }
+    } while (  ! done  );
 
-    if (  foundFile && found1file && ! foundUsrfile  )
+    if (  nbytes != ctxt->iosz  )
     {
-        if (  stat( ctxt->fname, &sbuf ) == 0  )
+        if (  nbytes < 0  )
         {
-            fprintf( stderr, "\n*** File '%s' already exists\n", ctxt->fname );
+            if (  readops  )
+                sprintf( ctxt->msgbuff, "%sead failed at offset %'ld",
+                         (ctxt->threads>1)?"r":"R", iooffset );
+            else
+                sprintf( ctxt->msgbuff, "%srite failed at offset %'ld",
+                         (ctxt->threads>1)?"w":"W", iooffset );
             return 1;
         }
-    }
-
-    if (  ctxt->testmode != MODE_CREATE  )
-    {
-        if (  ctxt->nofsync && ! ctxt->nodsync  )
+        else
         {
-            fprintf( stderr, "\n*** '-nofsync' can only be specified with '-nodsync'\n" );
+            if (  readops  )
+                sprintf( ctxt->msgbuff, "%short read (%'ld) at offset %'ld",
+                         (ctxt->threads>1)?"s":"S", (long)nbytes, iooffset );
+            else
+                sprintf( ctxt->msgbuff, "%short write (%'ld) at offset %'ld",
+                         (ctxt->threads>1)?"s":"S", (long)nbytes, iooffset );
             return 1;
         }
-    
-        if (  (ctxt->iosz < 1) || (ctxt->iosz > ctxt->fsz)  )
+    }
+
+    if (  ! readops && ctxt->nodsync && ! ctxt->nofsync  )
+    {
+        startus = getTimeAsUs();
+        errno = 0;
+#if defined(LINUX) || defined(SOLARIS)
+        if (  fdatasync( ctxt->fd )  )
         {
-            fprintf( stderr, "\n*** Invalid value for '-iosz'\n" );
+            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
+                     errno, strerror( errno )  );
             return 1;
         }
-    
-        if (  ( ctxt->threads < MIN_THREADS ) || ( ctxt->threads > MAX_THREADS )  )
+#else /* MACOS */
+        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
         {
-            fprintf( stderr, "\n*** Invalid value for '-threads'\n" );
+            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
+                     errno, strerror( errno )  );
             return 1;
         }
+#endif /* MACOS */
+        stopus = getTimeAsUs();
+        ctxt->fsyncus = stopus - startus;
     }
-    
+    else
+        ctxt->fsyncus = 0;
+ 
+    if (  doclose  )
+    {
+            startus = getTimeAsUs();
+            close( ctxt->fd );
+            stopus = getTimeAsUs();
+            ctxt->closeus = stopus - startus;
+            ctxt->fd = -1;
+    }
+    else
+        ctxt->closeus = 0;
+
+    if (  readops  )
+	ctxt->rdduration = ctxt->usrdstop - ctxt->usrdstart;
+    else
+        ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus;
+        // ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus + ctxt->closeus;
+
     return 0;
-} // parseArgs
+} // testIOPSSequential
 
 /*
- * Report CPU usage information.
+ * The test execution thread.
  */
 
-void
-reportTimes(
-            void
-           )
+void *
+testThread(
+           void * arg
+          )
 {
-    long cpu_time = 0;
-    int  cpu_ustime = 0;
-    long cpu_user = 0;
-    int  cpu_ususer = 0;
-    long cpu_sys = 0;
-    int  cpu_ussys = 0;
-    long pcpu_seconds = 0;
-    int  pcpu_useconds = 0;
-    long numcpus = 1;
-    long totcpuus = 0;
-    long usedcpuus = 0;
-    double proccpu = 0.0;
-    double syscpu = 0.0;
+    int ret = 0;
+    context_t * ctxt = (context_t *)arg;
 
-    cpu_user = rend.ru_utime.tv_sec - rstart.ru_utime.tv_sec;
-    cpu_ususer = rend.ru_utime.tv_usec - rstart.ru_utime.tv_usec;
-    if (  cpu_ususer < 0  )
+    if (  arg == NULL  )
+        return NULL;
+
+
+#if defined(ALLOW_AFFINITY)
+    if (  (ctxt->cpu >= 0) && bindThread( ctxt )  )
     {
-        cpu_user -= 1;
-        cpu_ususer += 1000000;
+        ctxt->rdfinished = ctxt->wrfinished = ctxt->crfinished = -1;
+        ctxt->crready = 1;
+        goto fini;
     }
+#endif /* ALLOW_AFFINITY */
+#if defined(ALLOW_PERF)
+    if (  ctxt->perf  )
+        perfOpen( ctxt );
+#endif /* ALLOW_PERF */
 
-    cpu_sys = rend.ru_stime.tv_sec - rstart.ru_stime.tv_sec;
-    cpu_ussys = rend.ru_stime.tv_usec - rstart.ru_stime.tv_usec;
-    if (  cpu_ussys < 0  )
+    // Generate test file
+
+    // indicate ready
+    ctxt->retcode = -1;
+    ctxt->crready = 1;
+    postEvent();
+
+    if (  ! ctxt->usrfile && ! ctxt->reused  )
     {
-        cpu_sys -= 1;
-        cpu_ussys += 1000000;
+        // wait for start
+        while (  ! ctxt->crstart  )
+        {
+            if (  ctxt->tstate == STOP  )
+            {
+                ctxt->rdfinished = ctxt->wrfinished = ctxt->crfinished = -1;
+                ctxt->retcode = RET_INTR;
+                goto fini;
+            }
+            waitStart( ctxt, &ctxt->crstart );
+        }
+        // generate file
+#if defined(ALLOW_CLONE)
+        if (  ctxt->clonefd >= 0  )
+            ret = cloneFile( ctxt );
+        else
+#endif /* ALLOW_CLONE */
+            ret = generateFile( ctxt, 0 );
+        if (  ret == RET_INTR  )
+        {
+            ctxt->retcode = RET_INTR;
+            ctxt->crfinished = 1;
+            ctxt->rdfinished = ctxt->wrfinished = 1;
+            goto fini;
+        }
+        else
+        if (  ret  )
+        {
+            ctxt->rdfinished = ctxt->wrfinished = ctxt->crfinished = -1;
+            goto fini;
+        }
     }
+    ctxt->crfinished = 1;
+    postEvent();
 
-    cpu_time = cpu_user + cpu_sys;
-    cpu_ustime = cpu_ususer + cpu_ussys;
-    if (  cpu_ustime >= 1000000  )
+nextround:
+    // Test read IOPS
+    // indicate ready
+    ctxt->rdready = 1;
+    if (  ! ctxt->noread && (ctxt->rdstart >= 0)  )
     {
-        cpu_time += 1;
-        cpu_ustime %= 1000000;
+        // wait for start
+        while (  ! ctxt->rdstart  )
+        {
+            if (  ctxt->tstate == STOP  )
+            {
+                ctxt->retcode = RET_INTR;
+                ctxt->rdfinished = ctxt->wrfinished = -1;
+                goto fini;
+            }
+            waitStart( ctxt, &ctxt->rdstart );
+        }
+        // test IOPS
+        if (  ctxt->testmode == MODE_SEQUENTIAL  )
+            ret = testIOPSSequential( ctxt, 1, 0 );
+        else
+            ret = testIOPSRandom( ctxt, 1, 0 );
+        if (  ret == RET_INTR  )
+        {
+            ctxt->retcode = RET_INTR;
+            ctxt->rdfinished = 1;
+            ctxt->wrfinished = -1;
+            goto fini;
+        }
+        else
+        if (  ret  )
+        {
+            ctxt->rdfinished = ctxt->wrfinished = -1;
+            goto fini;
+        }
     }
+    ctxt->rdfinished = 1;
+    postEvent();
 
-    pcpu_seconds = pend.tv_sec - pstart.tv_sec;
-    pcpu_useconds = pend.tv_usec - pstart.tv_usec;
-    if (  pcpu_useconds < 0  )
+    // Test write IOPS
+    // indicate ready
+    ctxt->wrready = 1;
+    if (  ! ctxt->nowrite && (ctxt->wrstart >= 0)  )
     {
-        pcpu_seconds -= 1;
-        pcpu_useconds += 1000000;
+        // wait for start
+        while (  ! ctxt->wrstart  )
+        {
+            if (  ctxt->tstate == STOP  )
+            {
+                ctxt->wrfinished = -1;
+                goto fini;
+            }
+            waitStart( ctxt, &ctxt->wrstart );
+        }
+        // test IOPS
+        if (  ctxt->testmode == MODE_SEQUENTIAL  )
+            ret = testIOPSSequential( ctxt, 0, ctxt->repeat <= 1 );
+        else
+            ret = testIOPSRandom( ctxt, 0, ctxt->repeat <= 1 );
+        if (  ret == RET_INTR  )
+        {
+            ctxt->retcode = RET_INTR;
+            ctxt->wrfinished = 1;
+            goto fini;
+        }
+        else
+        if (  ret  )
+        {
+            ctxt->wrfinished = -1;
+            goto fini;
+        }
+    }
+    ctxt->wrfinished = 1;
+    ctxt->retcode = 0;
+
+    // the coordinator decides whether there is another round
+    if (  ctxt->repeat > 1  )
+    {
+        postEvent();
+        while (  ! ctxt->rnstart  )
+        {
+            if (  ctxt->tstate == STOP  )
+                goto fini;
+            waitStart( ctxt, &ctxt->rnstart );
+        }
+        if (  ctxt->rnstart > 0  )
+        {
+            ctxt->rnstart = 0;
+            goto nextround;
+        }
+    }
+
+fini:
+#if defined(ALLOW_PERF)
+    perfClose( ctxt );
+#endif /* ALLOW_PERF */
+    postEvent();
+
+    return NULL;
+} // testThread
+
+/*
+ * Return a thread's rate for a test phase (MB/s for file generation,
+ * IOPS otherwise) or -1 if there is nothing meaningful to report.
+ */
+
+double
+threadRate(
+           context_t * ctxt,
+           int         phase
+          )
+{
+    switch (  phase  )
+    {
+        case RATE_GEN:
+            if (  ctxt->reused || (ctxt->genbytes < MB_MULT) ||
+                  (ctxt->crduration <= 100000L)  )
+                return -1.0;
+            return (((double)ctxt->genbytes/(double)MB_MULT)*1000000.0)/(double)ctxt->crduration;
+        case RATE_READ:
+            if (  ctxt->rdduration <= 0  )
+                return -1.0;
+            return ((double)ctxt->nreads*(double)1000000.0)/(double)ctxt->rdduration;
+        case RATE_WRITE:
+            if (  ctxt->wrduration <= 0  )
+                return -1.0;
+            return ((double)ctxt->nwrites*(double)1000000.0)/(double)ctxt->wrduration;
     }
 
-    numcpus = sysconf( _SC_NPROCESSORS_ONLN );
-    totcpuus = numcpus * ( ( pcpu_seconds * 1000000 ) + pcpu_useconds );
-    usedcpuus = ( cpu_time * 1000000 ) + cpu_ustime;
-    proccpu = ( 100.0 * (double)usedcpuus ) / (double)( ( pcpu_seconds * 1000000 ) + pcpu_useconds );
-    syscpu = ( 100.0 * (double)usedcpuus ) / (double)totcpuus;
-
-    printf( "Elapsed time = %'ld.%3.3d seconds\n", pcpu_seconds, pcpu_useconds/1000 );
-    printf( "User CPU time = %'ld.%3.3d seconds\n", cpu_user, cpu_ususer/1000 );
-    printf( "System CPU time = %'ld.%3.3d seconds\n", cpu_sys, cpu_ussys/1000 );
-    printf( "Total CPU time = %'ld.%3.3d seconds\n", cpu_time, cpu_ustime/1000 );
-    printf( "Process CPU usage = %.3f%%\n", proccpu );
-    printf( "System CPU usage = %.3f%%\n", syscpu );
-} // reportTimes
+    return -1.0;
+} // threadRate
 
 /*
- * Open the test file, optionally creating it.
+ * qsort() comparison function for rates.
  */
 
 int
-openFile(
-          context_t * ctxt,
-          int create
-         )
+compareRates(
+             const void * a,
+             const void * b
+            )
 {
-    int flags, ret;
-    long startus, stopus;
-    struct stat sbuf;
-    struct statvfs fsbuf;
+    double da = *(const double *)a, db = *(const double *)b;
 
-    if (  create && ! stat( ctxt->tfname, &sbuf )  )
+    return (da < db) ? -1 : (da > db);
+} // compareRates
+
+/*
+ * Summarise how evenly the threads of one target, or of all targets if
+ * 'target' is negative, were served: the spread of the per thread rates,
+ * their standard deviation and Jain's fairness index, which is 1.0 when
+ * all threads achieved the same rate and 1/n when one thread did all the
+ * work. Threads that differ from the median by more than OUTLIER_PCT
+ * percent are listed along with their tail latency. Returns the number
+ * of outliers and sets 'fairness', or leaves it alone if there are no
+ * rates.
+ */
+
+int
+spreadGroup(
+            context_t   threadcontexts[],
+            int         numcontexts,
+            int         phase,
+            int         target,
+            char      * prefix,
+            double    * fairness
+           )
+{
+    double * rates, rate, median, diff, sum = 0.0, sumsq = 0.0, mean, stddev;
+    histogram_t * hist;
+    char dev[32];
+    int i, n = 0, noutliers = 0;
+    char * what = (phase == RATE_GEN) ? "write rate (MB/s)" :
+                  (phase == RATE_READ) ? "read IOPS" : "write IOPS";
+
+    rates = (double *)malloc( numcontexts * sizeof(double) );
+    if (  rates == NULL  )
+        return 0;
+    for ( i = 0; i < numcontexts; i++ )
+        if (  ((target < 0) || (threadcontexts[i].target == target)) &&
+              ((rate = threadRate( &threadcontexts[i], phase )) >= 0.0)  )
+        {
+            rates[n++] = rate;
+            sum += rate;
+            sumsq += rate * rate;
+        }
+    if (  n == 0  )
     {
-        if (  ctxt->threads > 1  )
-            fprintf( stderr, "\n*** Thread %d: file '%s' already exists\n\n", 
-                     ctxt->threadno, ctxt->tfname );
-        else
-            fprintf( stderr, "\n*** File '%s' already exists\n\n", ctxt->tfname );
-        return 1;
+        free( (void *)rates );
+        return 0;
     }
+    qsort( (void *)rates, n, sizeof(double), compareRates );
+    median = (n % 2) ? rates[n / 2] : (rates[(n / 2) - 1] + rates[n / 2]) / 2.0;
+    mean = sum / (double)n;
+    stddev = ((sumsq / (double)n) > (mean * mean)) ? sqrt( (sumsq / (double)n) - (mean * mean) ) : 0.0;
+    *fairness = (sumsq > 0.0) ? (sum * sum) / ((double)n * sumsq) : 1.0;
+    printf("%sPer thread %s: min = %.2f, median = %.2f, max = %.2f\n",
+           prefix, what, rates[0], median, rates[n - 1] );
+    if (  sumsq > 0.0  )
+        printf("%sPer thread %s: standard deviation = %.2f (%.1f%% of mean), "
+               "Jain's fairness index = %.4f\n",
+               prefix, what, stddev, (mean > 0.0) ? (100.0 * stddev) / mean : 0.0,
+               *fairness );
+    free( (void *)rates );
 
-#if defined( ALLOW_RAW )
-    if (  ctxt->raw  )
+    for ( i = 0; i < numcontexts; i++ )
     {
-#if defined(ALLOW_RAWWRITE)
-        if (  ctxt->rawwrite && ! ctxt->nowrite  )
-            flags = O_RDWR;
+        if (  (target >= 0) && (threadcontexts[i].target != target)  )
+            continue;
+        if (  (rate = threadRate( &threadcontexts[i], phase )) < 0.0  )
+            continue;
+        diff = rate - median;
+        if (  ((diff < 0.0) ? -diff : diff) <= ((median * OUTLIER_PCT) / 100.0)  )
+            continue;
+        if (  (noutliers++ == 0) && (median > 0.0)  )
+            printf("%sThreads more than %d%% from the median:\n", prefix, OUTLIER_PCT );
         else
-#endif /* ALLOW_RAWWRITE */
-            flags = O_RDONLY;
-    }
-    else
-    {
-        flags = O_RDWR;
-        if (  create  )
-            flags |= O_CREAT|O_EXCL;
-        if (  ! ctxt->nodsync  )
-            flags |= O_DSYNC;
-#if defined(LINUX)
-        if (  ! ctxt->cache  )
-            flags |= O_DIRECT;
-#endif /* LINUX */
-    }
-#else /* ! ALLOW_RAW */
-    flags = O_RDWR;
-    if (  create  )
-        flags |= O_CREAT|O_EXCL;
-    if (  ! ctxt->nodsync  )
-        flags |= O_DSYNC;
-#if defined(LINUX)
-    if (  ! ctxt->cache  )
-        flags |= O_DIRECT;
-#endif /* LINUX */
-#endif /* ! ALLOW_RAW */
-    errno = 0;
-    ctxt->fd = open( ctxt->tfname, flags, 0600 );
-    if (  ctxt->fd < 0  )
-    {
-        if (  ctxt->threads > 1  )
-            fprintf( stderr, "\n*** Thread %d: unable to %s file '%s' - %s\n\n",
-                     ctxt->threadno, create?"create":"open", ctxt->tfname, strerror(errno) );
+        if (  noutliers == 1  )
+            printf("%sThreads that differ from the median of 0:\n", prefix );
+        if (  noutliers > MAX_OUTLIERS  )
+            continue;
+        // with a median of 0 (starved threads) only the difference is meaningful
+        if (  median > 0.0  )
+            sprintf( dev, "%+.1f%%", (100.0 * diff) / median );
         else
-            fprintf( stderr, "\n*** Unable to %s file '%s' - %s\n\n",
-                     create?"create":"open", ctxt->tfname, strerror(errno) );
-        return 1;
-    }
-#if defined(SOLARIS)
-    if (  ctxt->cache  )
-        flags = DIRECTIO_OFF;
-    else
-        flags = DIRECTIO_ON;
-    errno = 0;
-    if (  directio( ctxt->fd, flags )  )
-    {
-        if (  ctxt->threads > 1  )
-            fprintf( stderr, "\n*** Thread %d: unable to %s caching for '%s'\n\n",
-                     ctxt->threadno, (flags==DIRECTIO_OFF)?"enable":"disable", ctxt->tfname );
+            sprintf( dev, "%+.2f", diff );
+        hist = (phase == RATE_READ) ? &threadcontexts[i].rdhist : &threadcontexts[i].wrhist;
+        if (  (phase != RATE_GEN) && (hist->count > 0)  )
+            printf("    Thread %d: %.2f (%s), p99 latency = %'ld µs\n", i, rate,
+                   dev, histPercentile( hist, 99.0 ) );
         else
-            fprintf( stderr, "\n*** Unable to %s caching for '%s'\n\n",
-                     (flags==DIRECTIO_OFF)?"enable":"disable", ctxt->tfname );
+            printf("    Thread %d: %.2f (%s)\n", i, rate, dev );
     }
-#endif /* SOLARIS */
+    if (  noutliers > MAX_OUTLIERS  )
+        printf("    ... and %d more\n", noutliers - MAX_OUTLIERS );
 
-#if defined( ALLOW_RAW )
-    if (  ! ctxt->raw  )
-    {
-#endif /* ALLOW_RAW */
-        if (  fstatvfs( ctxt->fd, &fsbuf ) == 0  )
-        {
-            if ( fsbuf.f_frsize > 0 )
-                ctxt->blksz = fsbuf.f_frsize;
-            if ( fsbuf.f_bsize > 0 )
-                ctxt->optiosz = fsbuf.f_bsize;
-        }
-#if defined( ALLOW_RAW )
-    }
-#endif /* ALLOW_RAW */
+    return noutliers;
+} // spreadGroup
 
-#if defined(LINUX) || defined(SOLARIS)
-    if (  ! ctxt->cache  )
+/*
+ * Summarise how evenly the threads were served. Targets on different
+ * devices are expected to run at different rates, so with more than one
+ * target the spread is judged within each target and then summarised.
+ * With 'showlat' the latency percentiles of every thread are shown too.
+ */
+
+void
+reportSpread(
+             context_t   threadcontexts[],
+             int         numcontexts,
+             int         phase,
+             int         showlat
+            )
+{
+    histogram_t * hist;
+    char prefix[32];
+    double fairness, lowest = 2.0;
+    int i, t, lowtgt = -1, noutliers = 0;
+
+    for ( i = 0; showlat && (phase != RATE_GEN) && (i < numcontexts); i++ )
     {
-        if (  ctxt->iosz % ctxt->blksz  )
-        {
-            if (  ctxt->threads > 1  )
-                fprintf( stderr, "\n*** Thread %d: value for '-iosz' is not a multiple of %'ld\n\n",
-                         ctxt->threadno, ctxt->blksz );
-            else
-                fprintf( stderr, "\n*** Value for '-iosz' is not a multiple of %'ld\n\n", ctxt->blksz );
-            close( ctxt->fd );
-            ctxt->fd = -1;
-            return 1;
-        }
+        hist = (phase == RATE_READ) ? &threadcontexts[i].rdhist : &threadcontexts[i].wrhist;
+        if (  hist->count > 0  )
+            printf("Thread %d: latency p50 = %'ld µs, p99 = %'ld µs, p99.9 = %'ld µs, max = %'ld µs\n",
+                   i, histPercentile( hist, 50.0 ), histPercentile( hist, 99.0 ),
+                   histPercentile( hist, 99.9 ), hist->maxus );
     }
-#endif /* LINUX || SOLARIS */
 
-#if defined(MACOS)
-    if (  ctxt->verbose && ! ctxt->usriosz && ! ctxt->optiosz  )
+    if (  ntargets <= 1  )
     {
-        if (  ctxt->threads > 1  )
-            printf("\nThread %d: unable to determine optimal I/O size so using %'ld bytes\n\n",
-                    ctxt->threadno, DFLT_IOSZ );
-        else
-            printf("\nUnable to determine optimal I/O size so using %'ld bytes\n\n",
-                    DFLT_IOSZ );
+        spreadGroup( threadcontexts, numcontexts, phase, -1, "", &fairness );
+        return;
     }
-#endif /* MACOS */
-    if (  ! ctxt->optiosz  )
-        ctxt->optiosz = DFLT_IOSZ;
 
-#if defined(MACOS)
-#if defined( ALLOW_RAW )
-    if ( ! ctxt->raw  )
+    for ( t = 0; t < ntargets; t++ )
     {
-#endif /* ALLOW_RAW */
-        if (  ! ctxt->rdahead  )
-        {
-            if (  fcntl( ctxt->fd, F_RDAHEAD, 0 )  )
-            {
-                if (  ctxt->threads > 1  )
-                    fprintf( stderr, "\n*** Thread %d: unable to disable read-ahead for '%s'\n\n",
-                             ctxt->threadno, ctxt->tfname );
-                else
-                    fprintf( stderr, "\n*** Unable to disable read-ahead for '%s'\n\n",
-                             ctxt->tfname );
-                close( ctxt->fd );
-                ctxt->fd = -1;
-                return 1;
-            }
-        }
-    
-        if (  ! ctxt->cache  )
+        if (  targets[t].threads < 2  )
+            continue;
+        fairness = 2.0;
+        snprintf( prefix, sizeof(prefix), "Target %d: ", t );
+        noutliers += spreadGroup( threadcontexts, numcontexts, phase, t, prefix, &fairness );
+        if (  fairness < lowest  )
         {
-            if (  fcntl( ctxt->fd, F_NOCACHE, 1 )  )
-            {
-                if (  ctxt->threads > 1  )
-                    fprintf( stderr, "\n*** Thread %d: unable to disable caching for '%s'\n\n",
-                             ctxt->threadno, ctxt->tfname );
-                else
-                    fprintf( stderr, "\n*** : Unable to disable caching for '%s'\n\n",
-                             ctxt->tfname );
-                close( ctxt->fd );
-                ctxt->fd = -1;
-                return 1;
-            }
+            lowest = fairness;
+            lowtgt = t;
         }
-#if defined( ALLOW_RAW )
     }
-#endif /* ALLOW_RAW */
-#endif /* MACOS */
+    if (  lowtgt >= 0  )
+        printf("All targets: lowest Jain's fairness index = %.4f (target %d), "
+               "%d thread%s more than %d%% from its target's median\n",
+               lowest, lowtgt, noutliers, (noutliers == 1)?"":"s", OUTLIER_PCT );
+} // reportSpread
+
+/*
+ * Report the read or write results for each target and for all targets
+ * together. As each thread does synchronous I/O the average latency is
+ * the measured time per operation.
+ */
+
+void
+reportTargets(
+              context_t   threadcontexts[],
+              int         numcontexts,
+              int         readops
+             )
+{
+    long nops, usdur, ops, dur, totops = 0L, totus = 0L;
+    double iops, mbs, totiops = 0.0, totmbs = 0.0;
+    char * what = readops ? "read" : "write";
+    int i, t;
 
-    if ( ! ctxt->usrfile && ! ctxt->nopreallocate  )
+    printf("\n");
+    for ( t = 0; t <= ntargets; t++ )
     {
-#if defined(LINUX) || defined(SOLARIS)
-        startus = getTimeAsUs();
-        ret = posix_fallocate( ctxt->fd, (off_t)0, (off_t)ctxt->fsz );
-        stopus = getTimeAsUs();
-        ctxt->preallocus = stopus - startus;
-        if (  ctxt->threads > 1  )
+        if (  t == ntargets  )
         {
-            if (  ret == 0  )
-            {
-                if (  ctxt->verbose  )
-                    printf("Thread %d: preallocated %'ld bytes in %'ld µs\n", ctxt->threadno, ctxt->fsz, ctxt->preallocus );
-            }
-            else
-                printf("Thread %d: preallocation failed or is not supported\n", ctxt->threadno );
+            // all targets
+            nops = totops;
+            usdur = totus;
+            iops = totiops;
+            mbs = totmbs;
+            printf("All targets: ");
         }
-#else /* MACOS */
-        fstore_t prealloc;
-
-        // Let's try and pre-allocate the space, just for fun
-        prealloc.fst_flags = F_ALLOCATECONTIG|F_ALLOCATEALL;
-        prealloc.fst_posmode = F_PEOFPOSMODE;
-        prealloc.fst_offset = (off_t)0;
-        prealloc.fst_length = (off_t)ctxt->fsz;
-        prealloc.fst_bytesalloc = 0;
-        startus = getTimeAsUs();
-        ret = fcntl( ctxt->fd, F_PREALLOCATE, &prealloc );
-        stopus = getTimeAsUs();
-        ctxt->preallocus = stopus - startus;
-        if (  ret == 0  )
+        else
         {
-            if (  ctxt->verbose  )
+            nops = usdur = 0L;
+            iops = mbs = 0.0;
+            for ( i = 0; i < numcontexts; i++ )
             {
-                if (  ctxt->threads > 1  )
-                    printf("Thread %d: preallocated %'ld contiguous bytes in %'ld µs\n",
-                            ctxt->threadno, (long)prealloc.fst_bytesalloc, ctxt->preallocus);
+                if (  threadcontexts[i].target != t  )
+                    continue;
+                ops = readops ? threadcontexts[i].nreads : threadcontexts[i].nwrites;
+                dur = readops ? threadcontexts[i].rdduration : threadcontexts[i].wrduration;
+                if (  dur <= 0  )
+                    continue;
+                nops += ops;
+                usdur += dur;
+                iops += ((double)ops*(double)1000000.0)/(double)dur;
+                mbs += ((double)ops*(double)threadcontexts[i].iosz*(double)1000000.0)/(double)(MB_MULT*dur);
             }
+            totops += nops;
+            totus += usdur;
+            totiops += iops;
+            totmbs += mbs;
+            printf("Target %d '%s' (%d thread%s): ", t, targets[t].fname,
+                   targets[t].threads, (targets[t].threads>1)?"s":"" );
         }
+        if (  nops > 0  )
+            printf("%'ld %ss = %.2f %s IOPS, %.2f MB/s, average latency = %.1f µs\n",
+                   nops, what, iops, what, mbs, (double)usdur / (double)nops );
         else
+            printf("no %ss measured\n", what );
+    }
+} // reportTargets
+
+#if defined(ALLOW_DEVSTATS)
+/*
+ * Add the disk(s) behind the sysfs block device directory 'dpath' to the
+ * set being monitored. Stacked devices are followed through their slaves.
+ */
+
+void
+addDevice(
+          char * dpath,
+          int    depth
+         )
+{
+    char path[REUSE_LINESZ * 4];
+    char * spath, * p;
+    DIR * dir;
+    struct dirent * de;
+    int i, nslaves = 0;
+
+    if (  depth > 8  )
+        return;
+
+    // a partition's statistics are taken from the disk that contains it
+    sprintf( path, "%.*s/partition", (int)sizeof(path) - 16, dpath );
+    if (  (access( path, F_OK ) == 0) && ((p = strrchr( dpath, '/' )) != NULL)  )
+        *p = '\0';
+
+    sprintf( path, "%.*s/slaves", (int)sizeof(path) - 16, dpath );
+    if (  (dir = opendir( path )) != NULL  )
+    {
+        while (  (de = readdir( dir )) != NULL  )
         {
-            prealloc.fst_flags = F_ALLOCATEALL;
-            prealloc.fst_bytesalloc = 0;
-            startus = getTimeAsUs();
-            ret = fcntl( ctxt->fd, F_PREALLOCATE, &prealloc );
-            stopus = getTimeAsUs();
-            ctxt->preallocus = stopus - startus;
-            if (  ret == 0  )
-            {
-                if (  ctxt->verbose  )
-                {
-                    if (  ctxt->threads > 1  )
-                        printf("Thread %d: preallocated %'ld bytes in %'ld µs\n",
-                                ctxt->threadno, (long)prealloc.fst_bytesalloc, ctxt->preallocus);
-                }
-            }
-            else
+            if (  de->d_name[0] == '.'  )
+                continue;
+            snprintf( path, sizeof(path), "%s/slaves/%s", dpath, de->d_name );
+            if (  (spath = realpath( path, NULL )) != NULL  )
             {
-                if (  ctxt->threads > 1  )
-                    printf("Thread %d: preallocation failed or is not supported\n",
-                           ctxt->threadno );
-                else
-                    printf("Preallocation failed or is not supported\n");
-            }
-        }
-#endif /* MACOS */
-    } // pre-allocate
-
-    return 0;
-} // openFile
+                nslaves++;
+                addDevice( spath, depth + 1 );
+                free( (void *)spath );
+            }
+        }
+        closedir( dir );
+    }
+    if (  (nslaves > 0) || ((p = strrchr( dpath, '/' )) == NULL)  )
+        return;
 
+    p++;
+    for ( i = 0; i < ndevices; i++ )
+        if (  strcmp( devices[i].name, p ) == 0  )
+            return;
+    if (  (ndevices < MAX_DEVICES) && (strlen( p ) < sizeof(devices[0].name))  )
+        strcpy( devices[ndevices++].name, p );
+} // addDevice
 
 /*
- * Setup a bunch of stuff ready for the specific test.
+ * Find the disks holding the test threads' files. Returns the number of
+ * disks found.
  */
 
 int
-initTests(
-          context_t * ctxt
-         )
+findDevices(
+            context_t   threadcontexts[],
+            int         numcontexts
+           )
 {
-    long nblocks, divvy, rem1, rem2;
-    int ret = 0;
-
-    if (  (ctxt->usrfile) || (ctxt->onefile && (ctxt->threadno > 0))  )
-        ret = openFile( ctxt, 0 );
-    else
-        ret = openFile( ctxt, 1 );
-    if (  ret  )
-        return 1;
-
-    if (  ctxt->optiosz && ! ctxt->usriosz  )
-        ctxt->iosz = ctxt->optiosz;
+    struct stat sbuf;
+    dev_t dev, lastdev = 0;
+    char path[REUSE_LINESZ];
+    char * dpath;
+    int i;
 
-    if (  ctxt->optiosz && ! ctxt->usrgeniosz  )
+    for ( i = 0; i < numcontexts; i++ )
     {
-        divvy = DFLT_GENIOSZ / ctxt->optiosz;
-        rem1 = DFLT_GENIOSZ % ctxt->optiosz;
-        rem2 = (DFLT_GENIOSZ + ctxt->optiosz) % ctxt->optiosz;
-        ctxt->geniosz = (divvy * ctxt->optiosz);
-        if (  rem2 > rem1  )
-            ctxt->geniosz += ctxt->optiosz;
+        if (  (threadcontexts[i].fd < 0) || fstat( threadcontexts[i].fd, &sbuf )  )
+            continue;
+        dev = S_ISBLK( sbuf.st_mode ) ? sbuf.st_rdev : sbuf.st_dev;
+        if (  (i > 0) && (dev == lastdev)  )
+            continue;
+        lastdev = dev;
+        sprintf( path, "/sys/dev/block/%u:%u", major( dev ), minor( dev ) );
+        if (  (dpath = realpath( path, NULL )) != NULL  )
+        {
+            addDevice( dpath, 0 );
+            free( (void *)dpath );
+        }
     }
 
-    ctxt->maxoffset = ((ctxt->fsz / ctxt->iosz) + 1) * ctxt->iosz;
-    nblocks = ( ctxt->maxoffset / ctxt->iosz );
-    if (  nblocks > (long)RAND_MAX  )
-        nblocks = (long)RAND_MAX + 1L;
-    ctxt->maxblock = nblocks - 1;
+    return ndevices;
+} // findDevices
 
-    ctxt->genblk = valloc( ctxt->geniosz );
-    if (  ctxt->genblk == NULL  )
-    {
-        if (  ctxt->threads > 1  )
-            fprintf( stderr, "*** Thread %d: unable to valloc %'ld bytes\n", 
-                     ctxt->threadno, ctxt->geniosz );
-        else
-            fprintf( stderr, "*** Unable to valloc %'ld bytes\n", 
-                     ctxt->geniosz );
-        return 1;
-    }
+/*
+ * Read the statistics of a disk. Returns 0 on success.
+ */
 
-    ctxt->ioblk = valloc( ctxt->iosz );
-    if (  ctxt->ioblk == NULL  )
-    {
-        if (  ctxt->threads > 1  )
-            fprintf( stderr, "*** Thread %d: unable to valloc %'ld bytes\n", 
-                     ctxt->threadno, ctxt->iosz );
-        else
-            fprintf( stderr, "*** Unable to valloc %'ld bytes\n", 
-                     ctxt->iosz );
+int
+readDevice(
+           char * name,
+           long   fields[]
+          )
+{
+    char path[REUSE_LINESZ];
+    FILE * fp;
+    int i, ret = 0;
+
+    sprintf( path, "/sys/block/%.*s/stat", (int)sizeof(devices[0].name), name );
+    if (  (fp = fopen( path, "r" )) == NULL  )
         return 1;
-    }
+    for ( i = 0; (ret == 0) && (i < DEV_NFIELDS); i++ )
+        if (  fscanf( fp, "%ld", &fields[i] ) != 1  )
+            ret = 1;
+    fclose( fp );
 
-    return 0;
-} // initTests
+    return ret;
+} // readDevice
 
 /*
- * Setup the thread contexts for the test.
+ * Snapshot the statistics of all monitored disks at the start (start != 0)
+ * or end of a measurement.
  */
 
-int
-initContexts(
-             context_t * mainctxt,
-             context_t   threadcontexts[],
-             int         numcontexts
-            )
+void
+snapDevices(
+            int  start,
+            long now
+           )
 {
-    int i, l, ret = 0;
-#if defined( ALLOW_RAW )
-    int fd;
-    struct stat sbuf;
-#endif /* ALLOW_RAW */
+    int i;
 
-#if defined( ALLOW_RAW )
-    if (  mainctxt->raw  )
-    {
-        errno = 0;
-        fd = open( mainctxt->fname, O_RDONLY, 0 );
-        if (  fd < 0  )
+    for ( i = 0; i < ndevices; i++ )
+        if (  start  )
         {
-            fprintf( stderr, "*** Unable to open '%s' - %d (%s)\n",
-                     mainctxt->fname, errno, strerror(errno) );
-            return 1;
+            if (  readDevice( devices[i].name, devices[i].start )  )
+                memset( (void *)devices[i].start, 0, sizeof(devices[i].start) );
+            devices[i].startus = now;
+            devices[i].stopus = 0L;
+            devices[i].inflight = devices[i].maxinflight = devices[i].nsamples = 0L;
         }
-        if (  fstat( fd, &sbuf )  )
+        else
+        if (  devices[i].startus && ! devices[i].stopus  )
         {
-            fprintf( stderr, "*** Unable to stat '%s' - %d (%s)\n",
-                     mainctxt->fname, errno, strerror(errno) );
-            close( fd );
-            return 1;
+            if (  readDevice( devices[i].name, devices[i].stop )  )
+                memcpy( (void *)devices[i].stop, (void *)devices[i].start,
+                        sizeof(devices[i].stop) );
+            devices[i].stopus = now;
         }
-        mainctxt->blksz = sbuf.st_blksize;
-        mainctxt->optiosz = sbuf.st_blksize;
-        mainctxt->fsz = findRawSize( fd, mainctxt->blksz );
-        if (  mainctxt->fsz <= 0  )
+} // snapDevices
+
+/*
+ * Sample the number of in-flight I/Os on each monitored disk.
+ */
+
+void
+sampleDevices(
+              void
+             )
+{
+    char path[REUSE_LINESZ];
+    FILE * fp;
+    long rd, wr;
+    int i;
+
+    for ( i = 0; i < ndevices; i++ )
+    {
+        sprintf( path, "/sys/block/%.*s/inflight", (int)sizeof(devices[i].name), devices[i].name );
+        if (  (fp = fopen( path, "r" )) == NULL  )
+            continue;
+        if (  fscanf( fp, "%ld %ld", &rd, &wr ) == 2  )
         {
-            fprintf( stderr, "*** Unable to determine size for '%s'\n",
-                     mainctxt->fname );
-            close( fd );
-            return 1;
+            devices[i].inflight += rd + wr;
+            if (  (rd + wr) > devices[i].maxinflight  )
+                devices[i].maxinflight = rd + wr;
+            devices[i].nsamples++;
         }
-        close( fd );
+        fclose( fp );
     }
-#endif /* ALLOW_RAW */
+} // sampleDevices
+
+/*
+ * Change in a disk statistic over the measurement.
+ */
+
+long
+deviceDelta(
+            device_t * dev,
+            int        field
+           )
+{
+    return dev->stop[field] - dev->start[field];
+} // deviceDelta
+
+/*
+ * Report the statistics of the monitored disks for a read or write phase
+ * and the ratio of device bytes to application bytes.
+ */
+
+void
+reportDevices(
+              context_t   threadcontexts[],
+              int         numcontexts,
+              int         phase
+             )
+{
+    device_t * dev;
+    long usdur, appbytes = 0L, devbytes = 0L, ios;
+    int i;
 
-    if ( mainctxt->verbose && (mainctxt->threads > 1) )
-        printf("\n");
-    l = strlen( mainctxt->fname ) + 8;
     for ( i = 0; i < numcontexts; i++ )
+        appbytes += ((phase == RATE_READ) ? threadcontexts[i].nreads :
+                                            threadcontexts[i].nwrites) * threadcontexts[i].iosz;
+    for ( i = 0; i < ndevices; i++ )
     {
-        memcpy( (void *)&threadcontexts[i], (void *)mainctxt, sizeof(context_t) );
-        threadcontexts[i].threadno = i;
-        threadcontexts[i].tfname = (char *)calloc( l, sizeof(char) );
-        if (  threadcontexts[i].tfname == NULL  )
-        {
-            if (  mainctxt->threads > 1  )
-                fprintf( stderr, "*** Thread %d: unable to malloc %d bytes\n",
-                         mainctxt->threadno, l );
-            else
-                fprintf( stderr, "*** Unable to malloc %d bytes\n", l );
-            ret = 1;
+        dev = &devices[i];
+        usdur = dev->stopus - dev->startus;
+        if (  usdur <= 0  )
+            continue;
+        ios = deviceDelta( dev, DEV_RDIOS ) + deviceDelta( dev, DEV_WRIOS );
+        devbytes += DEV_SECTORSZ * deviceDelta( dev, (phase == RATE_READ) ? DEV_RDSECTORS :
+                                                                            DEV_WRSECTORS );
+        printf( "Device %s: %.2f IOPS (%.2f read, %.2f write), %'ld merges\n",
+                dev->name, ((double)ios * 1000000.0) / (double)usdur,
+                ((double)deviceDelta( dev, DEV_RDIOS ) * 1000000.0) / (double)usdur,
+                ((double)deviceDelta( dev, DEV_WRIOS ) * 1000000.0) / (double)usdur,
+                deviceDelta( dev, DEV_RDMERGES ) + deviceDelta( dev, DEV_WRMERGES ) );
+        printf( "Device %s: average queue depth = %.2f, utilization = %.2f%%\n",
+                dev->name,
+                ((double)deviceDelta( dev, DEV_QUEUETICKS ) * 1000.0) / (double)usdur,
+                ((double)deviceDelta( dev, DEV_IOTICKS ) * 100000.0) / (double)usdur );
+        if (  dev->nsamples > 0  )
+            printf( "Device %s: average in-flight I/Os = %.2f, maximum = %'ld\n",
+                    dev->name, (double)dev->inflight / (double)dev->nsamples,
+                    dev->maxinflight );
+    }
+    if (  appbytes > 0  )
+        printf( "Device/application bytes %s = %.2f\n",
+                (phase == RATE_READ) ? "read" : "written",
+                (double)devbytes / (double)appbytes );
+} // reportDevices
+#endif /* ALLOW_DEVSTATS */
+
+#if defined(ALLOW_SYSCPU)
+/*
+ * Snapshot /proc/stat at the start (start != 0) or end of a measurement.
+ * CPUs that are not present in both snapshots are not reported.
+ */
+
+void
+snapCpuStats(
+             int start
+            )
+{
+    FILE * fp;
+    char line[REUSE_LINESZ * 8];
+    long fields[CPU_NFIELDS];
+    char * p;
+    int cpu, i;
+
+    if (  (fp = fopen( "/proc/stat", "r" )) == NULL  )
+        return;
+    if (  start  )
+        for ( cpu = 0; cpu <= MAX_CPUS; cpu++ )
+            cpustats[cpu].valid = 0;
+    while (  fgets( line, sizeof(line), fp ) != NULL  )
+    {
+        if (  strncmp( line, "cpu", 3 ) != 0  )
             break;
-        }
-        threadcontexts[i].crfinished = 0;
-        threadcontexts[i].rdfinished = 0;
-        threadcontexts[i].wrfinished = 0;
-        if (  mainctxt->usrfile  )
-            strcpy( threadcontexts[i].tfname, mainctxt->fname );
+        p = line + 3;
+        if (  *p == ' '  )
+            cpu = MAX_CPUS;
         else
-        if (  mainctxt->onefile  )
-            sprintf(  threadcontexts[i].tfname, "%s-%2.2d", mainctxt->fname, 0  );
+        {
+            cpu = (int)strtol( p, &p, 10 );
+            if (  (cpu < 0) || (cpu >= MAX_CPUS)  )
+                continue;
+        }
+        memset( (void *)fields, 0, sizeof(fields) );
+        for ( i = 0; i < CPU_NFIELDS; i++ )
+            fields[i] = strtol( p, &p, 10 );
+        if (  start  )
+        {
+            memcpy( (void *)cpustats[cpu].start, (void *)fields, sizeof(fields) );
+            cpustats[cpu].valid = 1;
+        }
         else
-            sprintf(  threadcontexts[i].tfname, "%s-%2.2d", mainctxt->fname, i  );
-        if (  initTests( &threadcontexts[i] )  )
+        if (  cpustats[cpu].valid  )
         {
-            ret = 1;
-            break;
+            memcpy( (void *)cpustats[cpu].stop, (void *)fields, sizeof(fields) );
+            cpustats[cpu].valid = 2;
         }
     }
+    fclose( fp );
+} // snapCpuStats
 
-    mainctxt->blksz = threadcontexts[0].blksz;
-    mainctxt->optiosz = threadcontexts[0].optiosz;
-    mainctxt->iosz = threadcontexts[0].iosz;
-    mainctxt->geniosz = threadcontexts[0].geniosz;
+/*
+ * Compute the percentage of a CPU's time spent in each category over the
+ * measurement: user (including nice), system, iowait, irq, softirq, idle
+ * and steal. Returns 0 if there is nothing to report.
+ */
 
-    if (  ! mainctxt->usrfile  )
+int
+cpuPercentages(
+               cpustat_t * cs,
+               double      pct[]
+              )
+{
+    long delta[CPU_NFIELDS], total = 0L;
+    int i;
+
+    if (  cs->valid != 2  )
+        return 0;
+    for ( i = 0; i < CPU_NFIELDS; i++ )
     {
-        if (  mainctxt->onefile  )
-        {
-            if (  threadcontexts[0].tfname != NULL  )
-                unlink( threadcontexts[0].tfname );
-        }
-        else
-        for ( i = 0; i < numcontexts; i++ )
+        delta[i] = cs->stop[i] - cs->start[i];
+        total += delta[i];
+    }
+    if (  total <= 0  )
+        return 0;
+    pct[0] = (100.0 * (double)(delta[CPU_USER] + delta[CPU_NICE])) / (double)total;
+    pct[1] = (100.0 * (double)delta[CPU_SYSTEM]) / (double)total;
+    pct[2] = (100.0 * (double)delta[CPU_IOWAIT]) / (double)total;
+    pct[3] = (100.0 * (double)delta[CPU_IRQ]) / (double)total;
+    pct[4] = (100.0 * (double)delta[CPU_SOFTIRQ]) / (double)total;
+    pct[5] = (100.0 * (double)delta[CPU_IDLE]) / (double)total;
+    pct[6] = (100.0 * (double)delta[CPU_STEAL]) / (double)total;
+
+    return 1;
+} // cpuPercentages
+
+/*
+ * Report system wide CPU usage for the measurement, per CPU if verbose,
+ * and list the CPUs that spent a significant part of their time handling
+ * interrupts.
+ */
+
+void
+reportSystemCpu(
+                int verbose
+               )
+{
+    double pct[7];
+    int cpu, nhot = 0;
+
+    if (  ! cpuPercentages( &cpustats[MAX_CPUS], pct )  )
+        return;
+    printf( "System CPU: user = %.2f%%, system = %.2f%%, iowait = %.2f%%, irq = %.2f%%, "
+            "softirq = %.2f%%, idle = %.2f%%, steal = %.2f%%\n",
+            pct[0], pct[1], pct[2], pct[3], pct[4], pct[5], pct[6] );
+    for ( cpu = 0; cpu < MAX_CPUS; cpu++ )
+    {
+        if (  ! cpuPercentages( &cpustats[cpu], pct )  )
+            continue;
+        if (  verbose  )
+            printf( "CPU %d: user = %.2f%%, system = %.2f%%, iowait = %.2f%%, irq = %.2f%%, "
+                    "softirq = %.2f%%, idle = %.2f%%, steal = %.2f%%%s\n",
+                    cpu, pct[0], pct[1], pct[2], pct[3], pct[4], pct[5], pct[6],
+                    ((pct[3] + pct[4]) >= HOT_IRQ_PCT) ? " (hot interrupts)" : "" );
+    }
+
+    // the hot list goes on its own line after any per CPU lines
+    for ( cpu = 0; cpu < MAX_CPUS; cpu++ )
+    {
+        if (  ! cpuPercentages( &cpustats[cpu], pct )  )
+            continue;
+        if (  (pct[3] + pct[4]) >= HOT_IRQ_PCT  )
         {
-            if (  threadcontexts[i].tfname != NULL  )
-                unlink( threadcontexts[i].tfname );
+            printf( "%s %d (%.2f%%)", nhot ? "," : "Hot interrupt CPUs (irq + softirq):",
+                    cpu, pct[3] + pct[4] );
+            nhot++;
         }
     }
+    if (  nhot  )
+        printf( "\n" );
+} // reportSystemCpu
+#endif /* ALLOW_SYSCPU */
+
+/*
+ * Operations completed so far in a read or write phase. The counters are
+ * read without locking while the threads update them; a sample that is
+ * one operation stale does not matter.
+ */
+
+long
+phaseOps(
+         context_t   threadcontexts[],
+         int         numcontexts,
+         int         readops
+        )
+{
+    long ops = 0L;
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+        ops += readops ? threadcontexts[i].nreads : threadcontexts[i].nwrites;
+
+    return ops;
+} // phaseOps
+
+/*
+ * Start sampling aggregate IOPS for the measured part of a phase.
+ */
+
+void
+startSamples(
+             context_t   threadcontexts[],
+             int         numcontexts,
+             int         readops,
+             long        now
+            )
+{
+    sampler.count = 0;
+    sampler.lastops = phaseOps( threadcontexts, numcontexts, readops );
+    sampler.lastus = now;
+    sampler.nextus = now + SAMPLE_US;
+#if defined(ALLOW_DEVSTATS)
+    snapDevices( 1, now );
+#endif /* ALLOW_DEVSTATS */
+#if defined(ALLOW_SYSCPU)
+    if (  threadcontexts[0].reportcpu || (outfp != NULL)  )
+        snapCpuStats( 1 );
+#endif /* ALLOW_SYSCPU */
+} // startSamples
+
+/*
+ * Record the aggregate IOPS for the interval just ended, if it is due.
+ */
+
+void
+takeSample(
+           context_t   threadcontexts[],
+           int         numcontexts,
+           int         readops,
+           long        now
+          )
+{
+    long ops;
+
+    if (  now < sampler.nextus  )
+        return;
+    ops = phaseOps( threadcontexts, numcontexts, readops );
+    if (  (sampler.count < MAX_SAMPLES) && (now > sampler.lastus)  )
+        sampler.rate[sampler.count++] =
+            ((double)(ops - sampler.lastops) * 1000000.0) / (double)(now - sampler.lastus);
+    sampler.lastops = ops;
+    sampler.lastus = now;
+    sampler.nextus += SAMPLE_US;
+    if (  sampler.nextus <= now  )
+        sampler.nextus = now + SAMPLE_US;
+#if defined(ALLOW_DEVSTATS)
+    sampleDevices();
+#endif /* ALLOW_DEVSTATS */
+} // takeSample
+
+/*
+ * Note the end of the measured part of a phase.
+ */
+
+void
+stopSamples(
+            long now
+           )
+{
+#if defined(ALLOW_DEVSTATS)
+    snapDevices( 0, now );
+#endif /* ALLOW_DEVSTATS */
+#if defined(ALLOW_SYSCPU)
+    snapCpuStats( 0 );
+#endif /* ALLOW_SYSCPU */
+} // stopSamples
+
+/*
+ * Operations completed so far outside measurement, by all threads.
+ */
+
+long
+rampOps(
+        context_t   threadcontexts[],
+        int         numcontexts
+       )
+{
+    long ops = 0L;
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+        ops += threadcontexts[i].nrampops;
+
+    return ops;
+} // rampOps
+
+/*
+ * Start looking for steady state at the beginning of ramp up.
+ */
+
+void
+startSteady(
+            context_t   threadcontexts[],
+            int         numcontexts,
+            long        now
+           )
+{
+    memset( (void *)&steady, 0, sizeof(steady) );
+    steady.active = 1;
+    steady.startus = steady.lastus = now;
+    steady.nextus = now + SAMPLE_US;
+    steady.lastops = rampOps( threadcontexts, numcontexts );
+} // startSteady
+
+/*
+ * Record the IOPS for the ramp up interval just ended, if it is due, and
+ * return 1 if steady state has now been reached.
+ */
+
+int
+steadyState(
+            context_t   threadcontexts[],
+            int         numcontexts,
+            long        now
+           )
+{
+    double rate, mean = 0.0, min = 0.0, max = 0.0, sxy = 0.0, sxx = 0.0, x;
+    long ops;
+    int i, j;
+
+    if (  ! steady.active || (now < steady.nextus)  )
+        return 0;
+    ops = rampOps( threadcontexts, numcontexts );
+    if (  now > steady.lastus  )
+        steady.rate[steady.count++ % STEADY_WINDOW] =
+            ((double)(ops - steady.lastops) * 1000000.0) / (double)(now - steady.lastus);
+    steady.lastops = ops;
+    steady.lastus = now;
+    steady.nextus += SAMPLE_US;
+    if (  steady.nextus <= now  )
+        steady.nextus = now + SAMPLE_US;
+    if (  steady.count < STEADY_WINDOW  )
+        return 0;
+
+    // oldest interval first
+    for ( i = 0; i < STEADY_WINDOW; i++ )
+    {
+        rate = steady.rate[(steady.count + i) % STEADY_WINDOW];
+        mean += rate;
+        if (  (i == 0) || (rate < min)  )
+            min = rate;
+        if (  (i == 0) || (rate > max)  )
+            max = rate;
+    }
+    mean /= (double)STEADY_WINDOW;
+    if (  mean <= 0.0  )
+        return 0;
+    for ( i = 0; i < STEADY_WINDOW; i++ )
+    {
+        j = (steady.count + i) % STEADY_WINDOW;
+        x = (double)i - ((double)(STEADY_WINDOW - 1) / 2.0);
+        sxy += x * (steady.rate[j] - mean);
+        sxx += x * x;
+    }
+    steady.range = (100.0 * (max - min)) / mean;
+    steady.slope = (100.0 * (sxy / sxx) * (double)(STEADY_WINDOW - 1)) / mean;
+    if (  (steady.range > STEADY_RANGE_PCT) ||
+          (fabs( steady.slope ) > STEADY_SLOPE_PCT)  )
+        return 0;
 
-    return ret;
-} // initContexts
+    steady.active = 0;
+    steady.reached = 1;
+    steady.tookus = now - steady.startus;
+    return 1;
+} // steadyState
 
 /*
- * cleanup the thread contexts.
+ * Report how long the ramp up took to reach steady state.
  */
 
 void
-cleanupContexts(
-                context_t  threadcontexts[],
-                int        numcontexts
-               )
+reportSteady(
+             context_t * mainctxt
+            )
 {
-    int i;
+    if (  steady.reached  )
+        printf("Steady state reached after %.1f seconds of ramp up "
+               "(IOPS range = %.1f%%, slope = %+.1f%%)\n",
+               (double)steady.tookus / 1000000.0, steady.range, steady.slope );
+    else
+        printf("Steady state not reached within %'d seconds of ramp up\n",
+               mainctxt->steady );
+} // reportSteady
 
-    for ( i = 0; i < numcontexts; i++ )
+/*
+ * Structured result output ('-output'). Every phase produces one record
+ * (JSON) or one aggregate row plus a row per thread (CSV). Numbers are
+ * written in the "C" locale without thousands separators so that results
+ * can be loaded directly; OUTPUT_SCHEMA changes if the layout does.
+ */
+
+char *
+phaseName(
+          int phase
+         )
+{
+    switch (  phase  )
     {
-        if (  threadcontexts[i].fd >= 0  )
-        {
-            close( threadcontexts[i].fd );
-            threadcontexts[i].fd = -1;
-        }
-        if (  threadcontexts[i].genblk != NULL  )
-        {
-            free( (void *)threadcontexts[i].genblk );
-            threadcontexts[i].genblk = NULL;
-        }
-        if (  threadcontexts[i].ioblk != NULL  )
-        {
-            free( (void *)threadcontexts[i].ioblk );
-            threadcontexts[i].ioblk = NULL;
-        }
+        case RATE_GEN:
+            return "create";
+        case RATE_READ:
+            return "read";
+        case RATE_WRITE:
+            return "write";
     }
-} // cleanupContexts
+
+    return "unknown";
+} // phaseName
 
 /*
- * Generate the test file for a context.
+ * Write a string as a quoted JSON or CSV value.
  */
 
-int
-generateFile(
-             context_t * ctxt,
-             int doclose
+void
+outputString(
+             char * str
             )
 {
-    long numblks = 0L, remainder = 0L, blkno;
-    long startus, stopus;
-    ssize_t nbytes;
-
-    numblks = ctxt->fsz / ctxt->geniosz;
-    remainder = ctxt->fsz % ctxt->geniosz;
-
-    if (  stopReceived()  )
-        return RET_INTR;
-
-    ctxt->uscrstop = ctxt->uscrstart = getTimeAsUs();
-    for ( blkno = 0L; blkno < numblks; blkno++ )
+    fputc( '"', outfp );
+    for ( ; (str != NULL) && *str; str++ )
     {
-        nbytes = write( ctxt->fd, ctxt->genblk, (size_t)ctxt->geniosz );
-        if (  nbytes != ctxt->geniosz  )
-        {
-            sprintf( ctxt->msgbuff, "%srite failed for block %'ld", 
-                     (ctxt->threads>1)?"w":"W", blkno );
-            return 1;
-        }
-        if (  stopReceived()  )
-            return RET_INTR;
-    }
-    if (  remainder > 0  )
-    {
-        nbytes = write( ctxt->fd, ctxt->genblk, (size_t)remainder );
-        if (  nbytes != remainder  )
+        if (  outfmt == OUT_CSV  )
         {
-            sprintf( ctxt->msgbuff, "%srite failed for block %'ld", 
-                     (ctxt->threads>1)?"w":"W", blkno );
-            return 1;
+            if (  *str == '"'  )
+                fputc( '"', outfp );
+            fputc( *str, outfp );
         }
+        else
+        if (  (*str == '"') || (*str == '\\')  )
+            fprintf( outfp, "\\%c", *str );
+        else
+        if (  (unsigned char)*str < 0x20  )
+            fprintf( outfp, "\\u%4.4x", (unsigned int)(unsigned char)*str );
+        else
+            fputc( *str, outfp );
     }
+    fputc( '"', outfp );
+} // outputString
 
-    if (  stopReceived()  )
-        return RET_INTR;
+/*
+ * Open the '-output' file and, for CSV, write the column headings.
+ */
 
-    if (  ctxt->nodsync && ! ctxt->nofsync  )
+int
+openOutput(
+           void
+          )
+{
+    if (  (outfp = fopen( outfname, "w" )) == NULL  )
     {
-        startus = getTimeAsUs();
-        errno = 0;
-#if defined(LINUX) || defined(SOLARIS)
-        if (  fdatasync( ctxt->fd )  )
-        {
-            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
-                     errno, strerror( errno )  );
-            return 1;
-        }
-#else /* MACOS */
-        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
-        {
-            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
-                     errno, strerror( errno )  );
-            return 1;
-        }
-#endif /* MACOS */
-        stopus = getTimeAsUs();
-        ctxt->fsyncus = stopus - startus;
+        fprintf( stderr, "\n*** Unable to open '%s' - %d (%s)\n",
+                 outfname, errno, strerror( errno ) );
+        return 1;
     }
+    if (  outfmt == OUT_CSV  )
+        fprintf( outfp, "schema,version,time,mode,phase,thread,target,path,"
+                        "fsize,iosz,geniosz,threads,duration,ramp,durability,content,"
+                        "blksz,optiosz,ops,bytes,seconds,iops,mbs,avg_latency_us,"
+                        "flushes,flush_p50_us,flush_p99_us,discards,discard_p50_us,discard_p99_us,"
+                        "cpu_elapsed,cpu_user,cpu_system,cpu_process_pct,minor_faults,major_faults,"
+                        "lat_p50_us,lat_p99_us,lat_p999_us%s\n",
+                 (njobs > 0) ? ",job" : "" );
 
-    if (  stopReceived()  )
-        return RET_INTR;
+    return 0;
+} // openOutput
 
-    if (  doclose )
+/*
+ * Close the '-output' file.
+ */
+
+int
+closeOutput(
+            void
+           )
+{
+    int ret = 0;
+
+    if (  outfp == NULL  )
+        return 0;
+    if (  ferror( outfp )  )
+        ret = 1;
+    if (  fclose( outfp )  )
+        ret = 1;
+    if (  ret  )
     {
-        startus = getTimeAsUs();
-        close( ctxt->fd );
-        stopus = getTimeAsUs();
-        ctxt->fd = -1;
-        ctxt->closeus = stopus - startus;
+        fprintf( stderr, "*** Error writing '%s'\n", outfname );
     }
+    outfp = NULL;
 
-    ctxt->uscrstop = getTimeAsUs();
-    ctxt->crduration = ctxt->uscrstop - ctxt->uscrstart;
-
-    return 0;
-} // generateFile
+    return ret;
+} // closeOutput
 
 /*
- * Generate a random block offset within the test file.
+ * Microseconds between two timevals.
  */
 
 long
-getRandomOffset(
-                context_t * ctxt
-               )
+tvDiffUs(
+         struct timeval * start,
+         struct timeval * end
+        )
 {
-    double rval;
+    return ((long)(end->tv_sec - start->tv_sec) * 1000000L) +
+           (long)(end->tv_usec - start->tv_usec);
+} // tvDiffUs
 
-    rval = ( (double)rand() * (double)ctxt->maxblock ) / (double)RAND_MAX;
+/*
+ * Gather a thread's (or the aggregate's) operations, bytes and measured
+ * duration for a phase.
+ */
 
-    return ctxt->iosz * (long)rval;
-} // getRandomOffset
+void
+phaseCounts(
+            context_t * ctxt,
+            int         phase,
+            long      * ops,
+            long      * bytes,
+            long      * usdur
+           )
+{
+    switch (  phase  )
+    {
+        case RATE_GEN:
+            *bytes = ctxt->genbytes;
+            *ops = (ctxt->geniosz > 0) ? (ctxt->genbytes + ctxt->geniosz - 1) / ctxt->geniosz : 0L;
+            *usdur = ctxt->crduration;
+            break;
+        case RATE_READ:
+            *ops = ctxt->nreads;
+            *bytes = ctxt->rdbytes;
+            *usdur = ctxt->rdduration;
+            break;
+        default:
+            *ops = ctxt->nwrites;
+            *bytes = ctxt->wrbytes;
+            *usdur = ctxt->wrduration;
+            break;
+    }
+} // phaseCounts
 
 /*
- * Perform the random I/O test.
+ * Write the structured record for a completed phase. For the create phase
+ * of a test run the aggregate 'genbytes' is taken from the main context's
+ * 'fsz', which runTests sets to the total generated.
  */
 
-int
-testIOPSRandom(
-               context_t * ctxt,
-               int         readops,
-               int         doclose
-              )
+void
+outputPhase(
+            context_t * mainctxt,
+            context_t   threadcontexts[],
+            int         numcontexts,
+            int         phase
+           )
 {
-    int measuring = 0, done;
-    long iooffset, startus, stopus;
-    off_t res;
-    ssize_t nbytes;
-
-    if (  ctxt->tstate == MEASURE  )
+    long ops, bytes, usdur, sumus = 0L, tops, tbytes, tusdur, elapsedus;
+    long cpuus = 0L;
+#if defined(ALLOW_SYSCPU)
+    double pct[7];
+#endif /* ALLOW_SYSCPU */
+    double secs, iops, mbs, avglat, proccpu;
+    histogram_t * flush = &mainctxt->flushhist;
+    histogram_t * discard = &mainctxt->discardhist;
+    histogram_t * iohist = (phase == RATE_READ) ? &mainctxt->rdhist : &mainctxt->wrhist;
+    char * mode, * path;
+    char locale[64];
+    int i, first;
+
+    if (  outfp == NULL  )
+        return;
+
+    strncpy( locale, setlocale( LC_NUMERIC, NULL ), sizeof(locale) - 1 );
+    locale[sizeof(locale) - 1] = '\0';
+    setlocale( LC_NUMERIC, "C" );
+
+    mode = (mainctxt->testmode == MODE_CREATE) ? "create" :
+           (mainctxt->testmode == MODE_SEQUENTIAL) ? "sequential" : "random";
+    path = (ntargets == 1) ? targets[0].fname :
+           (ntargets == 0) ? mainctxt->fname : "";
+
+    phaseCounts( mainctxt, phase, &ops, &bytes, &usdur );
+    if (  phase == RATE_GEN  )
     {
-        measuring = 1;
-        if (  readops )
-            ctxt->usrdstart = getTimeAsUs();
-        else
-            ctxt->uswrstart = getTimeAsUs();
+        bytes = (mainctxt->testmode == MODE_CREATE) ? mainctxt->genbytes : mainctxt->fsz;
+        ops = (mainctxt->geniosz > 0) ? (bytes + mainctxt->geniosz - 1) / mainctxt->geniosz : 0L;
     }
-    done = 0;
-
-    while ( ! done )
+    for ( i = 0; i < numcontexts; i++ )
     {
-        iooffset = getRandomOffset( ctxt );
-        res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
-        if (  res != (off_t)iooffset  )
-        {
-            sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
-                     (ctxt->threads>1)?"s":"S", iooffset );
-            return 1;
-        }
-        if (  readops  )
+        phaseCounts( &threadcontexts[i], phase, &tops, &tbytes, &tusdur );
+        if (  ! ((phase == RATE_GEN) && threadcontexts[i].reused)  )
+            sumus += tusdur;
+        if (  phase != RATE_GEN  )
+            cpuus += threadCpuUs( &threadcontexts[i], phase );
+    }
+    secs = (double)usdur / 1000000.0;
+    iops = (usdur > 0) ? ((double)ops * 1000000.0) / (double)usdur : 0.0;
+    mbs = (usdur > 0) ? ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur) : 0.0;
+    avglat = (ops > 0) ? (double)sumus / (double)ops : 0.0;
+    elapsedus = tvDiffUs( &pstart, &pend );
+    proccpu = (elapsedus > 0) ?
+              (100.0 * (double)(tvDiffUs( &rstart.ru_utime, &rend.ru_utime ) +
+                                tvDiffUs( &rstart.ru_stime, &rend.ru_stime ))) / (double)elapsedus :
+              0.0;
+    if (  phase != RATE_WRITE  )
+        flush = discard = NULL;
+    if (  (phase == RATE_GEN) || (iohist->count == 0)  )
+        iohist = NULL;
+
+    if (  outfmt == OUT_CSV  )
+    {
+        for ( i = -1; i < numcontexts; i++ )
         {
-            if (  measuring  )
-                ctxt->nreads++;
-            errno = 0;
-            nbytes = read( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
-            if (  nbytes != ctxt->iosz  )
+            if (  i >= 0  )
             {
-                sprintf( ctxt->msgbuff, 
-                         "%sead failed at offset %'ld - %d (%s)",
-                         (ctxt->threads>1)?"r":"R", iooffset, errno, strerror(errno) );
-                return 1;
+                if (  (numcontexts == 1) ||
+                      ((phase == RATE_GEN) && threadcontexts[i].reused)  )
+                    continue;
+                phaseCounts( &threadcontexts[i], phase, &ops, &bytes, &usdur );
+                secs = (double)usdur / 1000000.0;
+                iops = (usdur > 0) ? ((double)ops * 1000000.0) / (double)usdur : 0.0;
+                mbs = (usdur > 0) ? ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur) : 0.0;
+                avglat = (ops > 0) ? (double)usdur / (double)ops : 0.0;
+                path = (ntargets > 0) ? targets[threadcontexts[i].target].fname : mainctxt->fname;
             }
-        }
-        else
-        {
-            if (  measuring  )
-                ctxt->nwrites++;
-            errno = 0;
-            nbytes = write( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
-            if (  nbytes != ctxt->iosz  )
+            fprintf( outfp, "%d,", OUTPUT_SCHEMA );
+            outputString( VERSION );
+            fprintf( outfp, ",%ld,%s,%s,", (long)time( NULL ), mode, phaseName( phase ) );
+            if (  i < 0  )
+                fprintf( outfp, "all,," );
+            else
+                fprintf( outfp, "%d,%d,", i, threadcontexts[i].target );
+            outputString( path );
+            fprintf( outfp, ",%ld,%ld,%ld,%d,%d,%d,%s,%s,%ld,%ld",
+                     threadcontexts[0].fsz,
+                     mainctxt->iosz, mainctxt->geniosz, mainctxt->threads,
+                     mainctxt->duration, mainctxt->ramp,
+                     durabilityName( mainctxt->durability ),
+                     (mainctxt->content == CONT_ZERO) ? "zero" : "random",
+                     mainctxt->blksz, mainctxt->optiosz );
+            fprintf( outfp, ",%ld,%ld,%.6f,%.2f,%.2f,%.1f", ops, bytes, secs, iops, mbs, avglat );
+            if (  (i < 0) && (flush != NULL) && flush->count  )
+                fprintf( outfp, ",%ld,%ld,%ld", flush->count,
+                         histPercentile( flush, 50.0 ), histPercentile( flush, 99.0 ) );
+            else
+                fprintf( outfp, ",,," );
+            if (  (i < 0) && (discard != NULL) && discard->count  )
+                fprintf( outfp, ",%ld,%ld,%ld", discard->count,
+                         histPercentile( discard, 50.0 ), histPercentile( discard, 99.0 ) );
+            else
+                fprintf( outfp, ",,," );
+            if (  i < 0  )
+                fprintf( outfp, ",%.6f,%.6f,%.6f,%.3f,%ld,%ld",
+                         (double)elapsedus / 1000000.0,
+                         (double)tvDiffUs( &rstart.ru_utime, &rend.ru_utime ) / 1000000.0,
+                         (double)tvDiffUs( &rstart.ru_stime, &rend.ru_stime ) / 1000000.0,
+                         proccpu, (long)(rend.ru_minflt - rstart.ru_minflt),
+                         (long)(rend.ru_majflt - rstart.ru_majflt) );
+            else
+                fprintf( outfp, ",,,,,," );
+            if (  (i < 0) && (iohist != NULL)  )
+                fprintf( outfp, ",%ld,%ld,%ld", histPercentile( iohist, 50.0 ),
+                         histPercentile( iohist, 99.0 ), histPercentile( iohist, 99.9 ) );
+            else
+                fprintf( outfp, ",,," );
+            if (  njobs > 0  )
             {
-                sprintf( ctxt->msgbuff, 
-                         "%srite failed at offset %'ld - %d (%s)",
-                         (ctxt->threads>1)?"w":"W", iooffset, errno, strerror(errno) );
-                return 1;
+                fprintf( outfp, "," );
+                outputString( jobname );
             }
+            fprintf( outfp, "\n" );
         }
-
-        if (  ( ctxt->tstate == STOP ) || ( ctxt->tstate == END )  )
+    }
+    else
+    {
+        fprintf( outfp, "{\"schema\":%d,\"version\":", OUTPUT_SCHEMA );
+        outputString( VERSION );
+        fprintf( outfp, ",\"time\":%ld,\"mode\":\"%s\",\"phase\":\"%s\",",
+                 (long)time( NULL ), mode, phaseName( phase ) );
+        if (  jobname != NULL  )
         {
-            if (  readops  )
-            {
-                if (  ctxt->usrdstart && ! ctxt->usrdstop  )
-                    ctxt->usrdstop = getTimeAsUs();
-            }
-            else
+            fprintf( outfp, "\"job\":" );
+            outputString( jobname );
+            fprintf( outfp, "," );
+        }
+        fprintf( outfp, "\"config\":{\"fsize\":%ld,\"iosz\":%ld,\"geniosz\":%ld,"
+                        "\"threads\":%d,\"duration\":%d,\"ramp\":%d,\"steady\":%d,\"onefile\":%d,"
+                        "\"cache\":%d,\"durability\":\"%s\",\"content\":\"%s\","
+                        "\"compress\":%.2f,\"dedupe\":%.2f,\"verify\":%d,\"syncint\":%d,"
+                        "\"nodsync\":%d,\"nofsync\":%d,\"usrfile\":%d,\"targets\":[",
+                 threadcontexts[0].fsz,
+                 mainctxt->iosz, mainctxt->geniosz, mainctxt->threads,
+                 mainctxt->duration, mainctxt->ramp, mainctxt->steady, mainctxt->onefile,
+                 mainctxt->cache, durabilityName( mainctxt->durability ),
+                 (mainctxt->content == CONT_ZERO) ? "zero" : "random",
+                 mainctxt->compress, mainctxt->dedupe, mainctxt->verify,
+                 mainctxt->syncint, mainctxt->nodsync, mainctxt->nofsync,
+                 mainctxt->usrfile );
+        if (  ntargets == 0  )
+        {
+            fprintf( outfp, "{\"path\":" );
+            outputString( mainctxt->fname );
+            fprintf( outfp, ",\"threads\":%d}", mainctxt->threads );
+        }
+        for ( i = 0; i < ntargets; i++ )
+        {
+            fprintf( outfp, "%s{\"path\":", i ? "," : "" );
+            outputString( targets[i].fname );
+            fprintf( outfp, ",\"threads\":%d}", targets[i].threads );
+        }
+        fprintf( outfp, "]},\"device\":{\"blksz\":%ld,\"optiosz\":%ld},",
+                 mainctxt->blksz, mainctxt->optiosz );
+        fprintf( outfp, "\"result\":{\"ops\":%ld,\"bytes\":%ld,\"seconds\":%.6f,"
+                        "\"iops\":%.2f,\"mbs\":%.2f,\"avg_latency_us\":%.1f",
+                 ops, bytes, secs, iops, mbs, avglat );
+        if (  (phase == RATE_WRITE) && mainctxt->ndiscards  )
+            fprintf( outfp, ",\"discards\":%ld", mainctxt->ndiscards );
+        fprintf( outfp, "}," );
+        if (  mainctxt->steady && (phase != RATE_GEN)  )
+            fprintf( outfp, "\"steady_state\":{\"reached\":%d,\"seconds\":%.1f,"
+                            "\"range_pct\":%.1f,\"slope_pct\":%.1f},",
+                     steady.reached,
+                     (double)(steady.reached ? steady.tookus : mainctxt->steady * 1000000L) / 1000000.0,
+                     steady.range, steady.slope );
+#if defined(ALLOW_PERF)
+        if (  mainctxt->perf && (phase != RATE_GEN) && (ops > 0)  )
+        {
+            fprintf( outfp, "\"perf_per_io\":{\"user_only\":%d", perfUserOnly ? 1 : 0 );
+            for ( i = 0; i < PERF_NEVENTS; i++ )
             {
-                if (  ctxt->uswrstart && ! ctxt->uswrstop  )
-                    ctxt->uswrstop = getTimeAsUs();
+                tops = perfTotal( threadcontexts, numcontexts, phase, i );
+                if (  tops >= 0  )
+                    fprintf( outfp, ",\"%s\":%.4f", perfKeys[i], (double)tops / (double)ops );
             }
-            measuring = 0;
-            done = 1;
+            fprintf( outfp, "}," );
         }
-        else
-        if (  ctxt->tstate == RAMP  )
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_SYSCPU)
+        if (  (phase != RATE_GEN) && cpuPercentages( &cpustats[MAX_CPUS], pct )  )
         {
-            if (  measuring  )
+            fprintf( outfp, "\"system_cpu\":{\"user_pct\":%.2f,\"system_pct\":%.2f,"
+                            "\"iowait_pct\":%.2f,\"irq_pct\":%.2f,\"softirq_pct\":%.2f,"
+                            "\"idle_pct\":%.2f,\"steal_pct\":%.2f,\"per_cpu\":[",
+                     pct[0], pct[1], pct[2], pct[3], pct[4], pct[5], pct[6] );
+            for ( first = 1, i = 0; i < MAX_CPUS; i++ )
             {
-                if (  readops  )
-                {
-                    if (  ctxt->usrdstart && ! ctxt->usrdstop  )
-                        ctxt->usrdstop = getTimeAsUs();
-                }
-                else
-                {
-                    if (  ctxt->uswrstart && ! ctxt->uswrstop  )
-                        ctxt->uswrstop = getTimeAsUs();
-                }
-                measuring = 0;
+                if (  ! cpuPercentages( &cpustats[i], pct )  )
+                    continue;
+                fprintf( outfp, "%s{\"cpu\":%d,\"user_pct\":%.2f,\"system_pct\":%.2f,"
+                                "\"iowait_pct\":%.2f,\"irq_pct\":%.2f,\"softirq_pct\":%.2f,"
+                                "\"idle_pct\":%.2f,\"steal_pct\":%.2f}",
+                         first ? "" : ",", i,
+                         pct[0], pct[1], pct[2], pct[3], pct[4], pct[5], pct[6] );
+                first = 0;
             }
+            fprintf( outfp, "]}," );
         }
-        else
-        if (  ctxt->tstate == MEASURE  )
+#endif /* ALLOW_SYSCPU */
+#if defined(ALLOW_DEVSTATS)
+        if (  mainctxt->devstats && (phase != RATE_GEN) && (ndevices > 0)  )
         {
-            if ( ! measuring )
+            tbytes = 0L;
+            fprintf( outfp, "\"devices\":[" );
+            for ( i = 0; i < ndevices; i++ )
             {
-                if (  readops )
-                    ctxt->usrdstart = getTimeAsUs();
-                else
-                    ctxt->uswrstart = getTimeAsUs();
-                measuring = 1;
+                device_t * dev = &devices[i];
+
+                tusdur = dev->stopus - dev->startus;
+                tbytes += DEV_SECTORSZ * deviceDelta( dev, (phase == RATE_READ) ? DEV_RDSECTORS :
+                                                                                  DEV_WRSECTORS );
+                fprintf( outfp, "%s{\"name\":", i ? "," : "" );
+                outputString( dev->name );
+                fprintf( outfp, ",\"seconds\":%.6f,\"read_ios\":%ld,\"write_ios\":%ld,"
+                                "\"read_merges\":%ld,\"write_merges\":%ld,"
+                                "\"read_bytes\":%ld,\"write_bytes\":%ld,"
+                                "\"avg_queue_depth\":%.2f,\"utilization_pct\":%.2f,"
+                                "\"avg_inflight\":%.2f,\"max_inflight\":%ld}",
+                         (double)tusdur / 1000000.0,
+                         deviceDelta( dev, DEV_RDIOS ), deviceDelta( dev, DEV_WRIOS ),
+                         deviceDelta( dev, DEV_RDMERGES ), deviceDelta( dev, DEV_WRMERGES ),
+                         DEV_SECTORSZ * deviceDelta( dev, DEV_RDSECTORS ),
+                         DEV_SECTORSZ * deviceDelta( dev, DEV_WRSECTORS ),
+                         (tusdur > 0) ? ((double)deviceDelta( dev, DEV_QUEUETICKS ) * 1000.0) / (double)tusdur : 0.0,
+                         (tusdur > 0) ? ((double)deviceDelta( dev, DEV_IOTICKS ) * 100000.0) / (double)tusdur : 0.0,
+                         dev->nsamples ? (double)dev->inflight / (double)dev->nsamples : 0.0,
+                         dev->maxinflight );
             }
+            fprintf( outfp, "],\"device_app_bytes\":%.4f,",
+                     (bytes > 0) ? (double)tbytes / (double)bytes : 0.0 );
         }
-    }
-
-    if (  ! readops && ctxt->nodsync && ! ctxt->nofsync  )
-    {
-        startus = getTimeAsUs();
-        errno = 0;
-#if defined(LINUX) || defined(SOLARIS)
-        if (  fdatasync( ctxt->fd )  )
+#endif /* ALLOW_DEVSTATS */
+        for ( i = 0; i < 3; i++ )
         {
-            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
-                     errno, strerror( errno )  );
-            return 1;
+            histogram_t * hist = (i == 0) ? iohist : (i == 1) ? flush : discard;
+
+            if (  (hist == NULL) || (hist->count == 0)  )
+                continue;
+            fprintf( outfp, "\"%slatency_us\":{\"count\":%ld,\"min\":%ld,\"avg\":%ld,"
+                            "\"p50\":%ld,\"p90\":%ld,\"p99\":%ld,\"p99.9\":%ld,\"max\":%ld},",
+                     (i == 0) ? "" : (i == 1) ? "flush_" : "discard_",
+                     hist->count, hist->minus,
+                     hist->totalus / hist->count,
+                     histPercentile( hist, 50.0 ), histPercentile( hist, 90.0 ),
+                     histPercentile( hist, 99.0 ), histPercentile( hist, 99.9 ),
+                     hist->maxus );
         }
-#else /* MACOS */
-        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
+        fprintf( outfp, "\"cpu\":{\"elapsed\":%.6f,\"user\":%.6f,\"system\":%.6f,"
+                        "\"process_pct\":%.3f,\"minor_faults\":%ld,\"major_faults\":%ld",
+                 (double)elapsedus / 1000000.0,
+                 (double)tvDiffUs( &rstart.ru_utime, &rend.ru_utime ) / 1000000.0,
+                 (double)tvDiffUs( &rstart.ru_stime, &rend.ru_stime ) / 1000000.0,
+                 proccpu, (long)(rend.ru_minflt - rstart.ru_minflt),
+                 (long)(rend.ru_majflt - rstart.ru_majflt) );
+        if (  (cpuus > 0) && (ops > 0)  )
+            fprintf( outfp, ",\"thread_cpu_us\":%ld,\"cpu_us_per_io\":%.2f,\"iops_per_core\":%.2f",
+                     cpuus, (double)cpuus / (double)ops,
+                     ((double)ops * 1000000.0) / (double)cpuus );
+        fprintf( outfp, "}," );
+        if (  (phase != RATE_GEN) && (sampler.count > 0)  )
+        {
+            fprintf( outfp, "\"samples\":{\"interval_us\":%ld,\"iops\":[", SAMPLE_US );
+            for ( i = 0; i < sampler.count; i++ )
+                fprintf( outfp, "%s%.2f", i ? "," : "", sampler.rate[i] );
+            fprintf( outfp, "]}," );
+        }
+        fprintf( outfp, "\"threads\":[" );
+        for ( first = 1, i = 0; i < numcontexts; i++ )
         {
-            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
-                     errno, strerror( errno )  );
-            return 1;
+            if (  (phase == RATE_GEN) && threadcontexts[i].reused  )
+                continue;
+            phaseCounts( &threadcontexts[i], phase, &ops, &bytes, &usdur );
+            fprintf( outfp, "%s{\"thread\":%d,\"target\":%d,\"ops\":%ld,\"bytes\":%ld,"
+                            "\"seconds\":%.6f,\"iops\":%.2f,\"mbs\":%.2f,\"avg_latency_us\":%.1f",
+                     first ? "" : ",", i, threadcontexts[i].target, ops, bytes,
+                     (double)usdur / 1000000.0,
+                     (usdur > 0) ? ((double)ops * 1000000.0) / (double)usdur : 0.0,
+                     (usdur > 0) ? ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur) : 0.0,
+                     (ops > 0) ? (double)usdur / (double)ops : 0.0 );
+            if (  phase != RATE_GEN  )
+                fprintf( outfp, ",\"cpu_us\":%ld", threadCpuUs( &threadcontexts[i], phase ) );
+            fprintf( outfp, "}" );
+            first = 0;
         }
-#endif /* MACOS */
-        stopus = getTimeAsUs();
-        ctxt->fsyncus = stopus - startus;
+        fprintf( outfp, "]}\n" );
     }
-    else
-        ctxt->fsyncus = 0;
+    fflush( outfp );
 
-    if (  doclose  )
+    setlocale( LC_NUMERIC, locale );
+} // outputPhase
+
+/*
+ * Baseline comparison ('compare'). The baseline is a JSON result file
+ * written by '-output json'. The test is re-run with the same settings
+ * and, for each read and write phase, the interval IOPS samples of both
+ * runs give 95% confidence intervals and a Welch t-test. A change is a
+ * regression if it is statistically significant and worse than the
+ * threshold. Tail (p99) latency has no per-interval samples so only the
+ * threshold applies to it.
+ */
+
+/*
+ * Locate the value of "key" in a JSON record, optionally only after
+ * 'section'. Returns NULL if not found.
+ */
+
+char *
+jsonValue(
+          char * rec,
+          char * section,
+          char * key
+         )
+{
+    char pattern[64];
+    char * p = rec;
+
+    if (  (section != NULL) && ((p = strstr( rec, section )) == NULL)  )
+        return NULL;
+    snprintf( pattern, sizeof(pattern), "\"%s\":", key );
+    if (  (p = strstr( p, pattern )) == NULL  )
+        return NULL;
+
+    return p + strlen( pattern );
+} // jsonValue
+
+/*
+ * Numeric value of "key", or 'dflt' if it is not present.
+ */
+
+double
+jsonNumber(
+           char * rec,
+           char * section,
+           char * key,
+           double dflt
+          )
+{
+    char * p = jsonValue( rec, section, key );
+
+    return (p == NULL) ? dflt : strtod( p, NULL );
+} // jsonNumber
+
+/*
+ * Copy the string value of "key" into 'buf' (unescaping \" and \\).
+ * Returns the position after the value or NULL if not found.
+ */
+
+char *
+jsonString(
+           char * rec,
+           char * section,
+           char * key,
+           char * buf,
+           int    bufsz
+          )
+{
+    char * p = jsonValue( rec, section, key );
+    int n = 0;
+
+    if (  (p == NULL) || (*p++ != '"')  )
+        return NULL;
+    for ( ; *p && (*p != '"'); p++ )
     {
-            startus = getTimeAsUs();
-            close( ctxt->fd );
-            stopus = getTimeAsUs();
-            ctxt->closeus = stopus - startus;
-            ctxt->fd = -1;
+        if (  (*p == '\\') && p[1]  )
+            p++;
+        if (  n < (bufsz - 1)  )
+            buf[n++] = *p;
     }
-    else
-        ctxt->closeus = 0;
+    buf[n] = '\0';
 
-    if (  readops  )
-        ctxt->rdduration = ctxt->usrdstop - ctxt->usrdstart;
-    else
-        ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus;
-        // ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus + ctxt->closeus;
+    return *p ? p + 1 : p;
+} // jsonString
+
+/*
+ * Add an argument for the re-run, copying it so that it outlives the
+ * baseline record.
+ */
+
+int
+addCompareArg(
+              char * cargv[],
+              int  * cargc,
+              char * arg
+             )
+{
+    if (  *cargc >= MAX_CMPARGS  )
+        return 1;
+    if (  (cargv[*cargc] = strdup( arg )) == NULL  )
+        return 1;
+    *cargc += 1;
 
     return 0;
-} // testIOPSRandom
+} // addCompareArg
 
 /*
- * Perform the sequential I/O test.
+ * Load the baseline result file and build the arguments that repeat its
+ * configuration. The arguments start at cargv[1] (the mode) so that they
+ * can be handed to parseArgs() like a normal command line.
  */
 
 int
-testIOPSSequential(
-                   context_t * ctxt,
-                   int         readops,
-                   int         doclose
-                  )
+loadBaseline(
+             char * fname,
+             char * cargv[],
+             int  * cargc
+            )
 {
-    int measuring = 0, done;
-    long iooffset, startus, stopus;
-    off_t res;
-    ssize_t nbytes;
-
-    // position to start of file
-    iooffset = 0;
-    res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
-    if (  res != (off_t)iooffset  )
+    FILE * fp;
+    char * line = NULL, * cfg = NULL, * p;
+    size_t linesz = 0;
+    char str[MAX_CMPARGS * 8], num[64], job[256], curjob[256];
+    double * rate, p99sum[RATE_WRITE + 1];
+    int nrec[RATE_WRITE + 1], nlat[RATE_WRITE + 1];
+    int phase, schema, n, i, ret = 1;
+
+    if (  (fp = fopen( fname, "r" )) == NULL  )
     {
-        sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
-                 (ctxt->threads>1)?"s":"S", iooffset );
+        fprintf( stderr, "\n*** Unable to open '%s' - %d (%s)\n",
+                 fname, errno, strerror( errno ) );
         return 1;
     }
 
-    // perform test
-    if (  ctxt->tstate == MEASURE  )
+    // every round of the last test in the file is used: the per second
+    // samples of all of its records for a phase are merged and the rates
+    // and p99 latency are averaged over them
+    curjob[0] = '\0';
+    for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
     {
-        measuring = 1;
-        if (  readops )
-            ctxt->usrdstart = getTimeAsUs();
-        else
-            ctxt->uswrstart = getTimeAsUs();
+        nrec[phase] = nlat[phase] = 0;
+        p99sum[phase] = 0.0;
     }
-    done = 0;
-
-    do {
-        if (  readops  )
-        {
-            if (  measuring  )
-                ctxt->nreads++;
-            nbytes = read( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
-        }
+    while (  getline( &line, &linesz, fp ) > 0  )
+    {
+        if (  jsonString( line, NULL, "phase", str, sizeof(str) ) == NULL  )
+            continue;
+        if (  strcmp( str, "read" ) == 0  )
+            phase = RATE_READ;
         else
+        if (  strcmp( str, "write" ) == 0  )
+            phase = RATE_WRITE;
+        else
+            continue;
+        schema = (int)jsonNumber( line, NULL, "schema", 0.0 );
+        if (  (schema < 1) || (schema > OUTPUT_SCHEMA)  )
         {
-            if (  measuring  )
-                ctxt->nwrites++;
-            nbytes = write( ctxt->fd, ctxt->ioblk, (size_t)ctxt->iosz );
+            fprintf( stderr, "\n*** Unsupported result schema %d in '%s'\n", schema, fname );
+            goto done;
         }
-        iooffset += ctxt->iosz;
-        if (  (nbytes == 0) || (iooffset >= ctxt->fsz)  )
-        { // wrap to beginning of file
-            iooffset = 0;
-            res = lseek( ctxt->fd, (off_t)iooffset, SEEK_SET );
-            if (  res != (off_t)iooffset  )
+        // a job file's results hold several tests, start again for each
+        if (  jsonString( line, NULL, "job", job, sizeof(job) ) == NULL  )
+            job[0] = '\0';
+        if (  strcmp( job, curjob ) != 0  )
+        {
+            strcpy( curjob, job );
+            for ( i = RATE_READ; i <= RATE_WRITE; i++ )
             {
-                sprintf( ctxt->msgbuff, "%seek failed for offset %'ld",
-                         (ctxt->threads>1)?"s":"S", iooffset );
-                return 1;
+                free( (void *)baseline[i].rate );
+                memset( (void *)&baseline[i], 0, sizeof(baseline_t) );
+                nrec[i] = nlat[i] = 0;
+                p99sum[i] = 0.0;
             }
-
         }
-
-        if (  ( ctxt->tstate == STOP ) || ( ctxt->tstate == END )  )
+        baseline[phase].present = 1;
+        baseline[phase].iosz = (long)jsonNumber( line, "\"config\":{", "iosz", 0.0 );
+        baseline[phase].iops += jsonNumber( line, "\"result\":{", "iops", 0.0 );
+        baseline[phase].mbs += jsonNumber( line, "\"result\":{", "mbs", 0.0 );
+        nrec[phase]++;
+        if (  jsonValue( line, "\"latency_us\":{", "p99" ) != NULL  )
         {
-            if (  readops  )
+            p99sum[phase] += jsonNumber( line, "\"latency_us\":{", "p99", 0.0 );
+            nlat[phase]++;
+        }
+        if (  (p = jsonValue( line, "\"samples\":{", "iops" )) != NULL  )
+        {
+            for ( n = 1, i = 0; p[i] && (p[i] != ']'); i++ )
+                if (  p[i] == ','  )
+                    n++;
+            rate = (double *)realloc( (void *)baseline[phase].rate,
+                                      (baseline[phase].count + n) * sizeof(double) );
+            if (  rate == NULL  )
             {
-                if (  ctxt->usrdstart && ! ctxt->usrdstop  )
-                    ctxt->usrdstop = getTimeAsUs();
+                fprintf( stderr, "\n*** Unable to allocate memory for baseline samples\n" );
+                goto done;
             }
-            else
+            baseline[phase].rate = rate;
+            for ( p++; *p && (*p != ']'); )
             {
-                if (  ctxt->uswrstart && ! ctxt->uswrstop  )
-                    ctxt->uswrstop = getTimeAsUs();
+                baseline[phase].rate[baseline[phase].count++] = strtod( p, &p );
+                if (  *p == ','  )
+                    p++;
             }
-            measuring = 0;
-            done = 1;
         }
-        else
-        if (  ctxt->tstate == RAMP  )
+        free( (void *)cfg );
+        if (  (cfg = strdup( line )) == NULL  )
         {
-            if (  measuring  )
-            {
-                if (  readops  )
-                {
-                    if (  ctxt->usrdstart && ! ctxt->usrdstop  )
-                        ctxt->usrdstop = getTimeAsUs();
-                }
-                else
-                {
-                    if (  ctxt->uswrstart && ! ctxt->uswrstop  )
-                        ctxt->uswrstop = getTimeAsUs();
-                }
-                measuring = 0;
-            }
+            fprintf( stderr, "\n*** Unable to allocate memory for baseline\n" );
+            goto done;
         }
-        else
-        if (  ctxt->tstate == MEASURE  )
+    }
+
+    if (  cfg == NULL  )
+    {
+        fprintf( stderr, "\n*** No read or write results found in '%s'\n", fname );
+        goto done;
+    }
+    for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
+    {
+        if (  nrec[phase] == 0  )
+            continue;
+        baseline[phase].iops /= (double)nrec[phase];
+        baseline[phase].mbs /= (double)nrec[phase];
+        // latency is only compared if every round recorded it
+        baseline[phase].p99us = (nlat[phase] == nrec[phase]) ?
+                                (long)((p99sum[phase] / (double)nlat[phase]) + 0.5) : -1L;
+    }
+
+    // repeat the configuration
+    jsonString( cfg, NULL, "mode", str, sizeof(str) );
+    if (  addCompareArg( cargv, cargc, (strcmp( str, "sequential" ) == 0) ? "s" : "r" )  )
+        goto toomany;
+    if (  ! baseline[RATE_READ].present && addCompareArg( cargv, cargc, "-noread" )  )
+        goto toomany;
+    if (  ! baseline[RATE_WRITE].present && addCompareArg( cargv, cargc, "-nowrite" )  )
+        goto toomany;
+    if (  (int)jsonNumber( cfg, "\"config\":{", "usrfile", 0.0 )  )
+    {
+        jsonString( cfg, "\"targets\":[", "path", str, sizeof(str) );
+        snprintf( num, sizeof(num), "%d", (int)jsonNumber( cfg, "\"config\":{", "threads", 1.0 ) );
+        if (  addCompareArg( cargv, cargc, "-1file" ) || addCompareArg( cargv, cargc, str ) ||
+              addCompareArg( cargv, cargc, "-threads" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+    }
+    else
+    {
+        if (  (int)jsonNumber( cfg, "\"config\":{", "onefile", 0.0 ) &&
+              addCompareArg( cargv, cargc, "-1file" )  )
+            goto toomany;
+        snprintf( num, sizeof(num), "%ld", (long)jsonNumber( cfg, "\"config\":{", "fsize", 0.0 ) );
+        if (  addCompareArg( cargv, cargc, "-fsize" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+        snprintf( num, sizeof(num), "%ld", (long)jsonNumber( cfg, "\"config\":{", "geniosz", 0.0 ) );
+        if (  addCompareArg( cargv, cargc, "-geniosz" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+        // a single target is repeated with '-file', several with '-target'
+        for ( n = 0, p = jsonValue( cfg, NULL, "targets" );
+              (p != NULL) && ((p = jsonValue( p, NULL, "path" )) != NULL); n++ )
+            ;
+        for ( p = jsonValue( cfg, NULL, "targets" );
+              (p != NULL) && ((p = jsonString( p, NULL, "path", str, sizeof(str) - 16 )) != NULL); )
         {
-            if ( ! measuring )
+            i = (int)jsonNumber( p, NULL, "threads", 1.0 );
+            if (  n == 1  )
             {
-                if (  readops )
-                    ctxt->usrdstart = getTimeAsUs();
-                else
-                    ctxt->uswrstart = getTimeAsUs();
-                measuring = 1;
+                snprintf( num, sizeof(num), "%d", i );
+                if (  addCompareArg( cargv, cargc, "-file" ) ||
+                      addCompareArg( cargv, cargc, str ) ||
+                      addCompareArg( cargv, cargc, "-threads" ) ||
+                      addCompareArg( cargv, cargc, num )  )
+                    goto toomany;
+            }
+            else
+            {
+                snprintf( str + strlen( str ), 16, ":%d", i );
+                if (  addCompareArg( cargv, cargc, "-target" ) ||
+                      addCompareArg( cargv, cargc, str )  )
+                    goto toomany;
             }
         }
-    } while (  ! done  );
+    }
+    snprintf( num, sizeof(num), "%ld", (long)jsonNumber( cfg, "\"config\":{", "iosz", 0.0 ) );
+    if (  addCompareArg( cargv, cargc, "-iosz" ) || addCompareArg( cargv, cargc, num )  )
+        goto toomany;
+    snprintf( num, sizeof(num), "%d", (int)jsonNumber( cfg, "\"config\":{", "duration", DFLT_DUR ) );
+    if (  addCompareArg( cargv, cargc, "-dur" ) || addCompareArg( cargv, cargc, num )  )
+        goto toomany;
+    snprintf( num, sizeof(num), "%d", (int)jsonNumber( cfg, "\"config\":{", "ramp", DFLT_RAMP ) );
+    if (  addCompareArg( cargv, cargc, "-ramp" ) || addCompareArg( cargv, cargc, num )  )
+        goto toomany;
+    if (  (i = (int)jsonNumber( cfg, "\"config\":{", "steady", 0.0 )) > 0  )
+    {
+        snprintf( num, sizeof(num), "%d", i );
+        if (  addCompareArg( cargv, cargc, "-steady" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+    }
+    if (  (int)jsonNumber( cfg, "\"config\":{", "cache", 0.0 ) &&
+          addCompareArg( cargv, cargc, "-cache" )  )
+        goto toomany;
+    if (  (int)jsonNumber( cfg, "\"config\":{", "verify", 0.0 ) &&
+          addCompareArg( cargv, cargc, "-verify" )  )
+        goto toomany;
+    if (  (int)jsonNumber( cfg, "\"config\":{", "nodsync", 0.0 )  )
+    {
+        if (  addCompareArg( cargv, cargc, "-nodsync" )  )
+            goto toomany;
+        if (  (int)jsonNumber( cfg, "\"config\":{", "nofsync", 0.0 ) &&
+              addCompareArg( cargv, cargc, "-nofsync" )  )
+            goto toomany;
+    }
+    jsonString( cfg, "\"config\":{", "durability", str, sizeof(str) );
+    if (  strcmp( str, "dsync" ) != 0  )
+    {
+        if (  addCompareArg( cargv, cargc, "-durability" ) || addCompareArg( cargv, cargc, str )  )
+            goto toomany;
+        if (  (strcmp( str, "fdatasync" ) == 0) || (strcmp( str, "fsync" ) == 0) ||
+              (strcmp( str, "syncrange" ) == 0)  )
+        {
+            snprintf( num, sizeof(num), "%d", (int)jsonNumber( cfg, "\"config\":{", "syncint", 1.0 ) );
+            if (  addCompareArg( cargv, cargc, "-syncint" ) || addCompareArg( cargv, cargc, num )  )
+                goto toomany;
+        }
+        if (  (int)jsonNumber( cfg, "\"config\":{", "nofsync", 0.0 ) &&
+              ! (int)jsonNumber( cfg, "\"config\":{", "nodsync", 0.0 ) &&
+              addCompareArg( cargv, cargc, "-nofsync" )  )
+            goto toomany;
+    }
+    jsonString( cfg, "\"config\":{", "content", str, sizeof(str) );
+    if (  strcmp( str, "random" ) == 0  )
+    {
+        if (  addCompareArg( cargv, cargc, "-content" ) || addCompareArg( cargv, cargc, "random" )  )
+            goto toomany;
+        snprintf( num, sizeof(num), "%.2f", jsonNumber( cfg, "\"config\":{", "compress", 1.0 ) );
+        if (  addCompareArg( cargv, cargc, "-compress" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+        snprintf( num, sizeof(num), "%.2f", jsonNumber( cfg, "\"config\":{", "dedupe", 1.0 ) );
+        if (  addCompareArg( cargv, cargc, "-dedupe" ) || addCompareArg( cargv, cargc, num )  )
+            goto toomany;
+    }
+    ret = 0;
+    goto done;
 
-    if (  nbytes != ctxt->iosz  )
+toomany:
+    fprintf( stderr, "\n*** Too many arguments needed to repeat '%s'\n", fname );
+
+done:
+    free( (void *)cfg );
+    free( (void *)line );
+    fclose( fp );
+
+    return ret;
+} // loadBaseline
+
+/*
+ * Two sided 95% critical value of Student's t distribution. Values for
+ * degrees of freedom between table entries use the next lower entry, which
+ * errs on the side of not reporting a change.
+ */
+
+double
+tCrit95(
+        double df
+       )
+{
+    static const double tdf[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 15, 20, 30, 60, 120 };
+    static const double tval[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262, 2.228, 2.179, 2.131, 2.086, 2.042, 2.000, 1.980 };
+    int i;
+
+    if (  df > 120.0  )
+        return 1.960;
+    for ( i = (int)(sizeof(tdf) / sizeof(tdf[0])) - 1; i > 0; i-- )
+        if (  df >= tdf[i]  )
+            break;
+
+    return tval[i];
+} // tCrit95
+
+/*
+ * Mean and standard deviation of scaled samples.
+ */
+
+void
+sampleStats(
+            double * rate,
+            int      n,
+            double   scale,
+            double * mean,
+            double * sd
+           )
+{
+    double sum = 0.0, sumsq = 0.0;
+    int i;
+
+    for ( i = 0; i < n; i++ )
+        sum += rate[i] * scale;
+    *mean = sum / (double)n;
+    for ( i = 0; i < n; i++ )
+        sumsq += ((rate[i] * scale) - *mean) * ((rate[i] * scale) - *mean);
+    *sd = (n > 1) ? sqrt( sumsq / (double)(n - 1) ) : 0.0;
+} // sampleStats
+
+/*
+ * Compare one metric with the baseline and report the outcome. 'higher'
+ * is set if larger values are better. Returns 1 for a regression.
+ */
+
+int
+compareMetric(
+              char   * label,
+              double * brate,
+              int      bn,
+              double   bscale,
+              double   bval,
+              double * crate,
+              int      cn,
+              double   cscale,
+              double   cval,
+              int      higher
+             )
+{
+    double bm = bval, bsd = 0.0, cm = cval, csd = 0.0, bv, cv, se, df, change;
+    int sampled = (bn > 1) && (cn > 1), signif = 1, regress;
+
+    if (  sampled  )
     {
-        if (  nbytes < 0  )
+        sampleStats( brate, bn, bscale, &bm, &bsd );
+        sampleStats( crate, cn, cscale, &cm, &csd );
+        bv = (bsd * bsd) / (double)bn;
+        cv = (csd * csd) / (double)cn;
+        se = sqrt( bv + cv );
+        if (  se > 0.0  )
         {
-            if (  readops  )
-                sprintf( ctxt->msgbuff, "%sead failed at offset %'ld",
-                         (ctxt->threads>1)?"r":"R", iooffset );
-            else
-                sprintf( ctxt->msgbuff, "%srite failed at offset %'ld",
-                         (ctxt->threads>1)?"w":"W", iooffset );
-            return 1;
+            df = ((bv + cv) * (bv + cv)) /
+                 (((bv * bv) / (double)(bn - 1)) + ((cv * cv) / (double)(cn - 1)));
+            signif = (fabs( cm - bm ) / se) > tCrit95( df );
         }
         else
-        {
-            if (  readops  )
-                sprintf( ctxt->msgbuff, "%short read (%'ld) at offset %'ld",
-                         (ctxt->threads>1)?"s":"S", (long)nbytes, iooffset );
-            else
-                sprintf( ctxt->msgbuff, "%short write (%'ld) at offset %'ld",
-                         (ctxt->threads>1)?"s":"S", (long)nbytes, iooffset );
-            return 1;
+            signif = (cm != bm);
+    }
+    change = (bm > 0.0) ? (100.0 * (cm - bm)) / bm : 0.0;
+    regress = signif && (higher ? (change < -threshold) : (change > threshold));
+
+    if (  sampled  )
+        printf("%s: baseline %.2f ±%.2f, now %.2f ±%.2f (%+.2f%%) - %s\n", label,
+               bm, tCrit95( (double)(bn - 1) ) * bsd / sqrt( (double)bn ),
+               cm, tCrit95( (double)(cn - 1) ) * csd / sqrt( (double)cn ), change,
+               regress ? "REGRESSION" : signif ? "significant change" : "no significant change" );
+    else
+        printf("%s: baseline %.2f, now %.2f (%+.2f%%) - %s\n", label, bm, cm, change,
+               regress ? "REGRESSION" : "within threshold" );
+
+    return regress;
+} // compareMetric
+
+/*
+ * Compare a completed read or write phase with the baseline.
+ */
+
+void
+comparePhase(
+             context_t * mainctxt,
+             int         phase
+            )
+{
+    baseline_t * base = &baseline[phase];
+    histogram_t * hist = (phase == RATE_READ) ? &mainctxt->rdhist : &mainctxt->wrhist;
+    char * what = (phase == RATE_READ) ? "read" : "write";
+    char label[64];
+    long ops = (phase == RATE_READ) ? mainctxt->nreads : mainctxt->nwrites;
+    long bytes = (phase == RATE_READ) ? mainctxt->rdbytes : mainctxt->wrbytes;
+    long usdur = (phase == RATE_READ) ? mainctxt->rdduration : mainctxt->wrduration;
+    double iops, mbs, bscale, cscale;
+    int nreg = 0;
+
+    if (  (cmpfname == NULL) || ! base->present || (usdur <= 0)  )
+        return;
+
+    iops = ((double)ops * 1000000.0) / (double)usdur;
+    mbs = ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur);
+
+    // the IOPS samples are scaled by the average bytes per operation as
+    // targets on different filesystems may use different I/O sizes
+    bscale = (base->iops > 0.0) ? base->mbs / base->iops : (double)base->iosz / (double)MB_MULT;
+    cscale = (ops > 0) ? ((double)bytes / (double)ops) / (double)MB_MULT :
+                         (double)mainctxt->iosz / (double)MB_MULT;
+
+    printf("Comparison with baseline (95%% confidence, threshold %.1f%%):\n", threshold );
+    snprintf( label, sizeof(label), "    %s IOPS", what );
+    nreg += compareMetric( label, base->rate, base->count, 1.0, base->iops,
+                           sampler.rate, sampler.count, 1.0, iops, 1 );
+    snprintf( label, sizeof(label), "    %s MB/s", what );
+    nreg += compareMetric( label, base->rate, base->count, bscale, base->mbs,
+                           sampler.rate, sampler.count, cscale, mbs, 1 );
+    if (  (base->p99us >= 0) && (hist->count > 0)  )
+    {
+        snprintf( label, sizeof(label), "    %s p99 latency (µs)", what );
+        nreg += compareMetric( label, NULL, 0, 1.0, (double)base->p99us,
+                               NULL, 0, 1.0, (double)histPercentile( hist, 99.0 ), 0 );
+    }
+    printf("\n");
+
+    regressions += nreg;
+} // comparePhase
+
+/*
+ * Write the live statistics in the Prometheus text format. Counters are
+ * read without locking so values may be a few operations behind, but the
+ * test threads are never disturbed. Latency percentiles are only
+ * available if per I/O latency is being recorded ('-latency').
+ */
+
+void
+writeStats(
+           FILE      * fp,
+           context_t   threadcontexts[],
+           int         numcontexts
+          )
+{
+    static histogram_t hist;
+    int phase = livePhase, i, j;
+    long nreads = 0L, nwrites = 0L, ndiscards = 0L, nflushes = 0L;
+    long rdbytes = 0L, wrbytes = 0L;
+    double q[] = { 50.0, 90.0, 99.0, 99.9 };
+    char * qname[] = { "0.5", "0.9", "0.99", "0.999" };
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        nreads += threadcontexts[i].nreads;
+        nwrites += threadcontexts[i].nwrites;
+        rdbytes += threadcontexts[i].nreads * threadcontexts[i].iosz;
+        wrbytes += threadcontexts[i].nwrites * threadcontexts[i].iosz;
+        ndiscards += threadcontexts[i].ndiscards;
+        nflushes += threadcontexts[i].nflushes;
+    }
+
+    fprintf( fp, "# HELP iops_phase Current test phase (-1 = none).\n" );
+    fprintf( fp, "# TYPE iops_phase gauge\n" );
+    fprintf( fp, "iops_phase{name=\"%s\"} %d\n",
+             (phase < 0) ? "none" : phaseName( phase ), phase );
+    fprintf( fp, "# HELP iops_phase_elapsed_us Time since the current phase started.\n" );
+    fprintf( fp, "# TYPE iops_phase_elapsed_us gauge\n" );
+    fprintf( fp, "iops_phase_elapsed_us %ld\n",
+             (phase < 0) ? 0L : getTimeAsUs() - livePhaseUs );
+    fprintf( fp, "# HELP iops_measuring Whether the current phase is being measured.\n" );
+    fprintf( fp, "# TYPE iops_measuring gauge\n" );
+    fprintf( fp, "iops_measuring %d\n",
+             (numcontexts > 0) && (threadcontexts[0].tstate == MEASURE) );
+    fprintf( fp, "# HELP iops_threads Number of test threads.\n" );
+    fprintf( fp, "# TYPE iops_threads gauge\n" );
+    fprintf( fp, "iops_threads %d\n", numcontexts );
+
+    fprintf( fp, "# HELP iops_ops_total Measured operations.\n" );
+    fprintf( fp, "# TYPE iops_ops_total counter\n" );
+    fprintf( fp, "iops_ops_total{op=\"read\"} %ld\n", nreads );
+    fprintf( fp, "iops_ops_total{op=\"write\"} %ld\n", nwrites );
+    fprintf( fp, "iops_ops_total{op=\"discard\"} %ld\n", ndiscards );
+    fprintf( fp, "iops_ops_total{op=\"flush\"} %ld\n", nflushes );
+    fprintf( fp, "# HELP iops_bytes_total Measured bytes transferred.\n" );
+    fprintf( fp, "# TYPE iops_bytes_total counter\n" );
+    fprintf( fp, "iops_bytes_total{op=\"read\"} %ld\n", rdbytes );
+    fprintf( fp, "iops_bytes_total{op=\"write\"} %ld\n", wrbytes );
+
+    fprintf( fp, "# HELP iops_thread_ops_total Measured operations per thread.\n" );
+    fprintf( fp, "# TYPE iops_thread_ops_total counter\n" );
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        fprintf( fp, "iops_thread_ops_total{thread=\"%d\",target=\"%d\",op=\"read\"} %ld\n",
+                 i, threadcontexts[i].target, threadcontexts[i].nreads );
+        fprintf( fp, "iops_thread_ops_total{thread=\"%d\",target=\"%d\",op=\"write\"} %ld\n",
+                 i, threadcontexts[i].target, threadcontexts[i].nwrites );
+    }
+
+    if (  ! mctxt.iolat || ((phase != RATE_READ) && (phase != RATE_WRITE))  )
+        return;
+    memset( (void *)&hist, 0, sizeof(hist) );
+    for ( i = 0; i < numcontexts; i++ )
+        histMerge( &hist, (phase == RATE_READ) ? &threadcontexts[i].rdhist
+                                               : &threadcontexts[i].wrhist );
+    if (  hist.count == 0  )
+        return;
+    fprintf( fp, "# HELP iops_latency_us I/O latency for the current phase.\n" );
+    fprintf( fp, "# TYPE iops_latency_us summary\n" );
+    for ( j = 0; j < 4; j++ )
+        fprintf( fp, "iops_latency_us{op=\"%s\",quantile=\"%s\"} %ld\n",
+                 phaseName( phase ), qname[j], histPercentile( &hist, q[j] ) );
+    fprintf( fp, "iops_latency_us_sum{op=\"%s\"} %ld\n", phaseName( phase ), hist.totalus );
+    fprintf( fp, "iops_latency_us_count{op=\"%s\"} %ld\n", phaseName( phase ), hist.count );
+} // writeStats
+
+/*
+ * The stats thread serves one snapshot per connection on the '-stats'
+ * UNIX socket. An HTTP request (e.g. from a Prometheus scraper or 'curl
+ * --unix-socket') gets an HTTP response; anything else gets plain text.
+ */
+
+void *
+statsThread(
+            void * arg
+           )
+{
+    struct pollfd pfd;
+    char req[512];
+    ssize_t n;
+    int conn;
+    FILE * fp;
+
+    (void)arg;
+    while (  ! statsStop  )
+    {
+        pfd.fd = statsfd;
+        pfd.events = POLLIN;
+        if (  (poll( &pfd, 1, STATS_POLL_MS ) <= 0) || statsStop  )
+            continue;
+        if (  (conn = accept( statsfd, NULL, NULL )) < 0  )
+            continue;
+        pfd.fd = conn;
+        pfd.events = POLLIN;
+        n = 0;
+        if (  poll( &pfd, 1, STATS_POLL_MS ) > 0  )
+            n = read( conn, req, sizeof(req) - 1 );
+        if (  (fp = fdopen( conn, "w" )) == NULL  )
+        {
+            close( conn );
+            continue;
         }
+        if (  (n >= 4) && (strncmp( req, "GET ", 4 ) == 0)  )
+            fprintf( fp, "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n\r\n" );
+        // a write error (EPIPE, ECONNRESET) just drops this client
+        writeStats( fp, tctxt, mctxt.threads );
+        fclose( fp );
     }
 
-    if (  ! readops && ctxt->nodsync && ! ctxt->nofsync  )
+    return NULL;
+} // statsThread
+
+/*
+ * Create the '-stats' socket and start the stats thread.
+ */
+
+int
+startStats(
+           void
+          )
+{
+    struct sockaddr_un addr;
+    struct stat sbuf;
+
+    if (  strlen( statsfname ) >= sizeof(addr.sun_path)  )
     {
-        startus = getTimeAsUs();
-        errno = 0;
-#if defined(LINUX) || defined(SOLARIS)
-        if (  fdatasync( ctxt->fd )  )
-        {
-            sprintf( ctxt->msgbuff, "fdatasync() failed: %d (%s)",
-                     errno, strerror( errno )  );
-            return 1;
-        }
-#else /* MACOS */
-        if (  fcntl( ctxt->fd, F_FULLFSYNC, 0 ) == -1  )
+        fprintf( stderr, "*** Stats socket path '%s' is too long\n", statsfname );
+        return 1;
+    }
+    memset( (void *)&addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, statsfname );
+
+    // only ever replace a stale socket, never some other file
+    if (  lstat( statsfname, &sbuf ) == 0  )
+    {
+        if (  ! S_ISSOCK( sbuf.st_mode )  )
         {
-            sprintf( ctxt->msgbuff, "fcntl( ..., F_FULLFSYNC, ...) failed: %d (%s)",
-                     errno, strerror( errno )  );
+            fprintf( stderr, "*** Stats socket path '%s' exists and is not a socket\n",
+                     statsfname );
             return 1;
         }
-#endif /* MACOS */
-        stopus = getTimeAsUs();
-        ctxt->fsyncus = stopus - startus;
+        unlink( statsfname );
     }
-    else
-        ctxt->fsyncus = 0;
- 
-    if (  doclose  )
+    if (  ((statsfd = socket( AF_UNIX, SOCK_STREAM, 0 )) < 0) ||
+          bind( statsfd, (struct sockaddr *)&addr, sizeof(addr) ) ||
+          listen( statsfd, STATS_BACKLOG )  )
     {
-            startus = getTimeAsUs();
-            close( ctxt->fd );
-            stopus = getTimeAsUs();
-            ctxt->closeus = stopus - startus;
-            ctxt->fd = -1;
+        fprintf( stderr, "*** Unable to create stats socket '%s' - %d (%s)\n",
+                 statsfname, errno, strerror( errno ) );
+        if (  statsfd >= 0  )
+            close( statsfd );
+        statsfd = -1;
+        return 1;
+    }
+    if (  pthread_create( &statsTid, NULL, statsThread, NULL )  )
+    {
+        fprintf( stderr, "*** Unable to start stats thread\n" );
+        close( statsfd );
+        statsfd = -1;
+        unlink( statsfname );
+        return 1;
     }
-    else
-        ctxt->closeus = 0;
-
-    if (  readops  )
-	ctxt->rdduration = ctxt->usrdstop - ctxt->usrdstart;
-    else
-        ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus;
-        // ctxt->wrduration = (ctxt->uswrstop - ctxt->uswrstart) + ctxt->fsyncus + ctxt->closeus;
 
     return 0;
-} // testIOPSSequential
+} // startStats
 
 /*
- * The test execution thread.
+ * Stop the stats thread and remove its socket.
  */
 
-void *
-testThread(
-           void * arg
-          )
+void
+stopStats(
+          void
+         )
 {
-    int ret = 0;
-    context_t * ctxt = (context_t *)arg;
-
-    if (  arg == NULL  )
-        return NULL;
+    if (  statsfd < 0  )
+        return;
+    statsStop = 1;
+    pthread_join( statsTid, NULL );
+    close( statsfd );
+    statsfd = -1;
+    unlink( statsfname );
+} // stopStats
 
+/*
+ * Publish the phase the coordinator is starting.
+ */
 
-    // Generate test file
+void
+setLivePhase(
+             int phase
+            )
+{
+    livePhaseUs = getTimeAsUs();
+    livePhase = phase;
+} // setLivePhase
 
-    // indicate ready
-    ctxt->crready = 1;
-    ctxt->retcode = -1;
+/*
+ * Record the results of a read or write phase for the round just run.
+ */
 
-    if (  ! ctxt->usrfile  )
+void
+recordRound(
+            context_t * mainctxt,
+            int         phase
+           )
+{
+    histogram_t * hist = (phase == RATE_READ) ? &mainctxt->rdhist : &mainctxt->wrhist;
+    long ops, bytes, usdur;
+    int r = rounds.n[phase];
+
+    if (  r >= MAX_REPEAT  )
+        return;
+    phaseCounts( mainctxt, phase, &ops, &bytes, &usdur );
+    if (  usdur <= 0  )
+        return;
+    rounds.iops[phase][r] = ((double)ops * 1000000.0) / (double)usdur;
+    rounds.mbs[phase][r] = ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur);
+    if (  hist->count > 0  )
     {
-        // wait for start
-        while (  ! ctxt->crstart  )
-        {
-            if (  ctxt->tstate == STOP  )
-            {
-                ctxt->rdfinished = ctxt->wrfinished = ctxt->crfinished = -1;
-                ctxt->retcode = RET_INTR;
-                return NULL;
-            }
-            usSleep( WAIT_US );
-        }
-        // generate file
-        if (  ! ctxt->onefile || (ctxt->threadno == 0)  )
-            ret = generateFile( ctxt, 0 );
-        if (  ret == RET_INTR  )
-        {
-            ctxt->retcode = RET_INTR;
-            ctxt->crfinished = 1;
-            ctxt->rdfinished = ctxt->wrfinished = 1;
-            return NULL;
-        }
-        else
-        if (  ret  )
-        {
-            ctxt->rdfinished = ctxt->wrfinished = ctxt->crfinished = -1;
-            return NULL;
-        }
+        rounds.p99[phase][r] = (double)histPercentile( hist, 99.0 );
+        rounds.nlat[phase]++;
     }
-    ctxt->crfinished = 1;
+    rounds.n[phase]++;
+} // recordRound
 
-    // Test read IOPS
-    // indicate ready
-    ctxt->rdready = 1;
-    if (  ! ctxt->noread && (ctxt->rdstart == 0)  )
+/*
+ * Compute the mean and the half width of the 95% confidence interval of
+ * a metric over the rounds run so far.
+ */
+
+void
+roundStats(
+           double * vals,
+           int      n,
+           double * mean,
+           double * sd,
+           double * ci
+          )
+{
+    sampleStats( vals, n, 1.0, mean, sd );
+    *ci = (n > 1) ? (tCrit95( (double)(n - 1) ) * *sd) / sqrt( (double)n ) : 0.0;
+} // roundStats
+
+/*
+ * Check whether the IOPS of every phase is within the confidence interval
+ * target.
+ */
+
+int
+ciMet(
+      int nrounds
+     )
+{
+    double mean, sd, ci;
+    int phase;
+
+    if (  nrounds < MIN_CIROUNDS  )
+        return 0;
+    for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
     {
-        // wait for start
-        while (  ! ctxt->rdstart  )
-        {
-            if (  ctxt->tstate == STOP  )
-            {
-                ctxt->retcode = RET_INTR;
-                ctxt->rdfinished = ctxt->wrfinished = -1;
-                return NULL;
-            }
-            usSleep( WAIT_US );
-        }
-        // test IOPS
-        if (  ctxt->testmode == MODE_SEQUENTIAL  )
-            ret = testIOPSSequential( ctxt, 1, 0 );
-        else
-            ret = testIOPSRandom( ctxt, 1, 0 );
-        if (  ret == RET_INTR  )
-        {
-            ctxt->retcode = RET_INTR;
-            ctxt->rdfinished = 1;
-            ctxt->wrfinished = -1;
-            return NULL;
-        }
-        else
-        if (  ret  )
-        {
-            ctxt->rdfinished = ctxt->wrfinished = -1;
-            return NULL;
-        }
+        if (  rounds.n[phase] == 0  )
+            continue;
+        roundStats( rounds.iops[phase], rounds.n[phase], &mean, &sd, &ci );
+        if (  (mean <= 0.0) || (((100.0 * ci) / mean) > citarget)  )
+            return 0;
     }
-    ctxt->rdfinished = 1;
 
-    // Test write IOPS
-    // indicate ready
-    ctxt->wrready = 1;
-    if (  ! ctxt->nowrite && (ctxt->wrstart == 0)  )
+    return 1;
+} // ciMet
+
+/*
+ * Decide whether another round is needed.
+ */
+
+int
+moreRounds(
+           context_t * mainctxt,
+           int         nrounds
+          )
+{
+    if (  nrounds >= mainctxt->repeat  )
+        return 0;
+    if (  citarget <= 0.0  )
+        return 1;
+
+    return ! ciMet( nrounds );
+} // moreRounds
+
+/*
+ * Clear the results of the previous round ready for the next one.
+ */
+
+void
+resetRound(
+           context_t * mainctxt,
+           context_t   threadcontexts[],
+           int         numcontexts
+          )
+{
+    context_t * ctxt;
+    int i;
+
+    for ( i = 0; i <= numcontexts; i++ )
     {
-        // wait for start
-        while (  ! ctxt->wrstart  )
-        {
-            if (  ctxt->tstate == STOP  )
-            {
-                ctxt->wrfinished = -1;
-                return NULL;
-            }
-            usSleep( WAIT_US );
-        }
-        // test IOPS
-        if (  ctxt->testmode == MODE_SEQUENTIAL  )
-            ret = testIOPSSequential( ctxt, 0, 1 );
-        else
-            ret = testIOPSRandom( ctxt, 0, 1 );
-        if (  ret == RET_INTR  )
+        ctxt = (i < numcontexts) ? &threadcontexts[i] : mainctxt;
+        ctxt->nreads = ctxt->nwrites = ctxt->nrampops = 0L;
+        ctxt->ndiscards = ctxt->nverified = ctxt->verifyus = ctxt->contentus = 0L;
+        ctxt->rdbytes = ctxt->wrbytes = ctxt->dcbytes = 0L;
+        ctxt->fsyncus = ctxt->closeus = ctxt->flushus = ctxt->nflushes = 0L;
+        ctxt->sinceflush = 0L;
+        ctxt->usrdstart = ctxt->usrdstop = ctxt->uswrstart = ctxt->uswrstop = 0L;
+        ctxt->rdduration = ctxt->wrduration = 0L;
+        ctxt->rdcpuus = ctxt->wrcpuus = 0L;
+        memset( (void *)&ctxt->rdhist, 0, sizeof(ctxt->rdhist) );
+        memset( (void *)&ctxt->wrhist, 0, sizeof(ctxt->wrhist) );
+        memset( (void *)&ctxt->flushhist, 0, sizeof(ctxt->flushhist) );
+        memset( (void *)&ctxt->discardhist, 0, sizeof(ctxt->discardhist) );
+        ctxt->rdready = ctxt->wrready = 0;
+        ctxt->rdstart = ctxt->wrstart = 0;
+        ctxt->rdfinished = ctxt->wrfinished = 0;
+    }
+} // resetRound
+
+/*
+ * Report the summary of repeated rounds, and write it as a JSON record
+ * if requested.
+ */
+
+void
+reportRounds(
+             int nrounds
+            )
+{
+    double mean, sd, ci;
+    char locale[64];
+    int phase, m, n;
+    char * metric;
+    double * vals;
+
+    printf("Summary of %d rounds (mean, standard deviation, 95%% confidence interval):\n",
+           nrounds);
+    for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
+        for ( m = 0; m < 3; m++ )
         {
-            ctxt->retcode = RET_INTR;
-            ctxt->wrfinished = 1;
-            return NULL;
+            n = (m == 2) ? rounds.nlat[phase] : rounds.n[phase];
+            if (  n != rounds.n[phase] || (n == 0)  )
+                continue;
+            vals = (m == 0) ? rounds.iops[phase] : (m == 1) ? rounds.mbs[phase] : rounds.p99[phase];
+            metric = (m == 0) ? "IOPS" : (m == 1) ? "MB/s" : "p99 latency (µs)";
+            roundStats( vals, n, &mean, &sd, &ci );
+            printf("%s %s: mean = %.2f, sd = %.2f, 95%% CI = +/- %.2f (%.2f%%)\n",
+                   (phase == RATE_READ) ? "Read" : "Write", metric, mean, sd, ci,
+                   (mean > 0.0) ? (100.0 * ci) / mean : 0.0 );
         }
-        else
-        if (  ret  )
+    if (  citarget > 0.0  )
+        printf("Confidence interval target of %.1f%% %s after %d rounds\n", citarget,
+               ciMet( nrounds ) ? "met" : "not met", nrounds );
+    printf("\n");
+
+    if (  outfmt != OUT_JSON  )
+        return;
+    strncpy( locale, setlocale( LC_NUMERIC, NULL ), sizeof(locale) - 1 );
+    locale[sizeof(locale) - 1] = '\0';
+    setlocale( LC_NUMERIC, "C" );
+    fprintf( outfp, "{\"schema\":%d,\"version\":", OUTPUT_SCHEMA );
+    outputString( VERSION );
+    fprintf( outfp, ",\"time\":%ld,\"phase\":\"summary\",\"rounds\":%d,\"ci_target_pct\":%.2f",
+             (long)time( NULL ), nrounds, citarget );
+    if (  jobname != NULL  )
+    {
+        fprintf( outfp, ",\"job\":" );
+        outputString( jobname );
+    }
+    if (  citarget > 0.0  )
+        fprintf( outfp, ",\"ci_target_met\":%s", ciMet( nrounds ) ? "true" : "false" );
+    for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
+    {
+        if (  rounds.n[phase] == 0  )
+            continue;
+        fprintf( outfp, ",\"%s\":{", phaseName( phase ) );
+        for ( m = 0; m < 3; m++ )
         {
-            ctxt->wrfinished = -1;
-            return NULL;
+            n = (m == 2) ? rounds.nlat[phase] : rounds.n[phase];
+            if (  n != rounds.n[phase]  )
+                continue;
+            vals = (m == 0) ? rounds.iops[phase] : (m == 1) ? rounds.mbs[phase] : rounds.p99[phase];
+            roundStats( vals, n, &mean, &sd, &ci );
+            fprintf( outfp, "%s\"%s\":{\"mean\":%.2f,\"sd\":%.2f,\"ci95\":%.2f}",
+                     m ? "," : "", (m == 0) ? "iops" : (m == 1) ? "mbs" : "p99_latency_us",
+                     mean, sd, ci );
         }
+        fprintf( outfp, "}" );
     }
-    ctxt->wrfinished = 1;
-    ctxt->retcode = 0;
+    fprintf( outfp, "}\n" );
+    fflush( outfp );
+    setlocale( LC_NUMERIC, locale );
+} // reportRounds
 
-    return NULL;
-} // testThread
+/*
+ * Tell all test threads to abandon the test, wherever they are waiting.
+ */
+
+void
+abortThreads(
+             context_t threadcontexts[],
+             int       numcontexts
+            )
+{
+    int i;
+
+    for ( i = 0; i < numcontexts; i++ )
+    {
+        threadcontexts[i].rdstart = threadcontexts[i].wrstart = -1;
+        threadcontexts[i].rnstart = -1;
+        threadcontexts[i].tstate = STOP;
+    }
+    postStart();
+} // abortThreads
 
 /*
  * Test thread coordinator.
@@ -2523,10 +9245,12 @@ runTests(
          int         numcontexts
         )
 {
-    int i, allready, haderror;
+    int i, allready, haderror, ngen, nfiles, nreused;
+    unsigned long seq;
     long usdur, minstart, minstop, maxstart, maxstop;
-    long rlimit, dlimit, now;
-    int ramping;
+    time_t gentime;
+    long rlimit, dlimit, now, flushus;
+    int ramping, nrounds = 0, ret = 0;
     tstate_t tstate, pstate;
     double duration;
     char * fmt = NULL;
@@ -2538,48 +9262,117 @@ runTests(
                               (void *)&threadcontexts[i] )  )
         {
             fprintf( stderr, "*** Unable to start thread %d\n", i+1  );
-            return 2;
+            // only the threads already started can be joined
+            numcontexts = i;
+            abortThreads( threadcontexts, numcontexts );
+            ret = 2;
+            goto fini;
         }
         threadcontexts[i].tstate = RUNNING;
     }
 
     // wait for them to be ready
     do {
+        seq = getEventSeq();
         allready = 1;
         for ( i = 0; i < numcontexts; i++ )
             if (  ! threadcontexts[i].crready  )
                 allready = 0;
         if (  ! allready  )
-            usSleep( WAIT_US );
+            waitEvent( seq, 0L );
     } while ( ! allready );
 
+    // count the files that need to be generated
+    ngen = nreused = 0;
     if (  ! mainctxt->usrfile  )
+        for ( i = 0; i < numcontexts; i++ )
+        {
+            if (  mainctxt->onefile && (threadcontexts[i].tgtno > 0)  )
+                continue;
+            if (  threadcontexts[i].reused  )
+            {
+                gentime = (time_t)threadcontexts[i].gentime;
+                nreused++;
+            }
+            else
+                ngen++;
+        }
+    nfiles = ngen;
+    // in single file mode all of a target's threads generate its file
+    if (  mainctxt->onefile && ngen  )
+        for ( ngen = i = 0; i < numcontexts; i++ )
+            if (  ! threadcontexts[i].reused  )
+                ngen++;
+
+    if (  nreused  )
+    {
+        if (  nreused == 1  )
+            printf("Reusing existing test file generated %s", ctime( &gentime ) );
+        else
+            printf("Reusing %d existing test files\n", nreused );
+        if (  ! ngen  )
+            printf("\n");
+    }
+
+    if (  ngen  )
     {
-        if (  mainctxt->onefile || (numcontexts == 1)  )
+        if (  ntargets > 1  )
+            printf("Generating %d test file%s each of size %'ld bytes for %d targets...\n",
+                   nfiles, (nfiles > 1)?"s":"", mctxt.fsz, ntargets);
+        else
+        if (  numcontexts == 1  )
             printf("Generating test file of size %'ld bytes...\n", mctxt.fsz);
+        else
+        if (  mainctxt->onefile  )
+            printf("Generating test file of size %'ld bytes using %d threads...\n",
+                   mctxt.fsz, numcontexts);
+        else
+        if (  ngen == 1  )
+            printf("Generating 1 test file of size %'ld bytes...\n", mctxt.fsz);
         else
             printf("Generating %d test files each of size %'ld bytes...\n", 
-                   numcontexts, mctxt.fsz);
+                   ngen, mctxt.fsz);
 
         gettimeofday( &pstart, NULL );
         getrusage( RUSAGE_SELF, &rstart );
+        setLivePhase( RATE_GEN );
 
-        // Tell them all to start file creation
-        for ( i = 0; i < numcontexts; i++ )
-            threadcontexts[i].crstart = 1;
+        // Tell them all to start file creation, when cloning the
+        // template file must be complete before the others start
+        if (  mainctxt->clone  )
+        {
+            threadcontexts[0].crstart = 1;
+            postStart();
+            do {
+                seq = getEventSeq();
+                if (  ! threadcontexts[0].crfinished  )
+                    waitEvent( seq, 0L );
+            } while ( ! threadcontexts[0].crfinished );
+        }
+        // there is nothing to clone if the template could not be generated
+        if (  mainctxt->clone && (threadcontexts[0].crfinished < 0)  )
+            abortThreads( threadcontexts, numcontexts );
+        else
+        {
+            for ( i = 0; i < numcontexts; i++ )
+                threadcontexts[i].crstart = 1;
+            postStart();
+        }
 
         // wait for them all to finish file creation
         do {
+            seq = getEventSeq();
             allready = 1;
             for ( i = 0; i < numcontexts; i++ )
                 if (  ! threadcontexts[i].crfinished  )
                     allready = 0;
             if (  ! allready  )
-                usSleep( WAIT_US );
+                waitEvent( seq, 0L );
         } while ( ! allready );
 
         getrusage( RUSAGE_SELF, &rend );
         gettimeofday( &pend, NULL );
+        freeGenShared( mainctxt );
 
         // check for errors
         haderror = 0;
@@ -2587,19 +9380,32 @@ runTests(
             if (  threadcontexts[i].crfinished < 1  )
             {
                 haderror = 1;
+                // threads stopped after a failed template have no message
+                if (  threadcontexts[i].msgbuff[0] == '\0'  )
+                    continue;
                 if (  numcontexts > 1  )
                     fprintf( stderr, "*** Thread %d: %s\n",
                              i, threadcontexts[i].msgbuff  );
                 else
                     fprintf( stderr, "*** %s\n", threadcontexts[i].msgbuff  );
             }
+        // keep newly generated reusable files only if they are complete
+        if (  mainctxt->reuse  )
+            for ( i = 0; i < numcontexts; i++ )
+            {
+                if (  threadcontexts[i].reused ||
+                      (mainctxt->onefile && (threadcontexts[i].tgtno > 0))  )
+                    continue;
+                if (  haderror || stopReceived() || writeReuseInfo( &threadcontexts[i] )  )
+                    unlink( threadcontexts[i].tfname );
+            }
+
         if (  haderror  )
         {
-            // abort all threads
-            for ( i = 0; i < numcontexts; i++ )
-                threadcontexts[i].rdstart = threadcontexts[i].wrstart = -1;
+            abortThreads( threadcontexts, numcontexts );
             mainctxt->crfinished = -1;
-            return 3;
+            ret = 3;
+            goto fini;
         }
     
         // summarise and report results
@@ -2607,6 +9413,8 @@ runTests(
         minstart = minstop = 999999999999999999L;
         for ( i = 0; i < numcontexts; i++ )
         {
+            if (  threadcontexts[i].reused  )
+                continue;
             if (  threadcontexts[i].uscrstart > maxstart  )
                 maxstart = threadcontexts[i].uscrstart;
             if (  threadcontexts[i].uscrstop > maxstop  )
@@ -2617,42 +9425,54 @@ runTests(
                 minstop = threadcontexts[i].uscrstop;
             usdur = threadcontexts[i].crduration;
             mainctxt->crduration += usdur;
-            mainctxt->fsz += threadcontexts[i].fsz;
+            mainctxt->fsz += threadcontexts[i].genbytes;
             mainctxt->preallocus += threadcontexts[i].preallocus;
             mainctxt->fsyncus += threadcontexts[i].fsyncus;
             mainctxt->closeus += threadcontexts[i].closeus;
-            if (  mainctxt->verbose && (mainctxt->threads > 1)  )
+            if (  mainctxt->verbose && (mainctxt->threads > 1) &&
+                  (mainctxt->threads <= VERBOSE_THREADS)  )
             {
-                if (  ! mainctxt->onefile || (i == 0)  )
+                if (  (threadcontexts[i].genbytes >= MB_MULT) && (usdur > 100000L)  )
                 {
-                    if (  (mainctxt->fsz >= MB_MULT) && (usdur > 100000L)  )
-                    {
-                        printf("Thread %d: write time = %'ld µs, rate = %.2f MB/s\n", i, usdur,
-             (((double)threadcontexts[i].fsz/(double)MB_MULT)*1000000.0)/(double)usdur );
-                        if (  threadcontexts[i].fsyncus )
-                            printf("Thread %d: sync time = %'ld µs\n", i, threadcontexts[i].fsyncus );
-                        if (  threadcontexts[i].closeus )
-                            printf("Thread %d: close time = %'ld µs\n", i, threadcontexts[i].closeus );
-                    }
-                    else
-                        printf("Thread %d: insufficient accuracy to report write rate\n", i );
+                    printf("Thread %d: write time = %'ld µs, rate = %.2f MB/s\n", i, usdur,
+         (((double)threadcontexts[i].genbytes/(double)MB_MULT)*1000000.0)/(double)usdur );
+                    if (  threadcontexts[i].fsyncus )
+                        printf("Thread %d: sync time = %'ld µs\n", i, threadcontexts[i].fsyncus );
+                    if (  threadcontexts[i].closeus )
+                        printf("Thread %d: close time = %'ld µs\n", i, threadcontexts[i].closeus );
                 }
+                else
+                    printf("Thread %d: insufficient accuracy to report write rate\n", i );
             }
         }
-        mainctxt->crduration /= numcontexts;
+        if (  mainctxt->verbose && (mainctxt->threads > VERBOSE_THREADS)  )
+            reportSpread( threadcontexts, numcontexts, RATE_GEN, 0 );
+        // for a shared file the threads cooperate so use the elapsed time
+        if (  mainctxt->onefile && (numcontexts > 1)  )
+            mainctxt->crduration = maxstop - minstart;
+        else
+            mainctxt->crduration /= ngen;
     
         if (  mainctxt->preallocus  )
         {
             if (  mainctxt->onefile || (mainctxt->threads == 1)  )
                 printf("Preallocation time = %'ld µs\n", mainctxt->preallocus );
             else
-                printf("Average preallocation time = %'ld µs\n", mainctxt->preallocus / mainctxt->threads );
+                printf("Average preallocation time = %'ld µs\n", mainctxt->preallocus / ngen );
         }
+#if defined(ALLOW_CLONE)
+        if (  mainctxt->clone && (ngen > 1)  )
+            reportClone( threadcontexts, numcontexts );
+        else
+#endif /* ALLOW_CLONE */
         if (  (mainctxt->crduration >= 100000) &&
               (mainctxt->fsz >= MB_MULT)  )
         {
-            if (  mainctxt->onefile || (mainctxt->threads == 1)  )
+            if (  mainctxt->threads == 1  )
                 fmt = "Write time = %'ld µs, rate = %.2f MB/s\n";
+            else
+            if (  mainctxt->onefile  )
+                fmt = "Write time = %'ld µs, aggregate write rate = %.2f MB/s\n";
             else
                 fmt = "Average write time = %'ld µs, aggregate write rate = %.2f MB/s\n";
             printf(fmt, mainctxt->crduration,
@@ -2662,17 +9482,17 @@ runTests(
                        (maxstart - minstart), (maxstop - minstop) );
             if (  mainctxt->fsyncus  )
             {
-                if (  mainctxt->onefile || (mainctxt->threads == 1)  )
+                if (  mainctxt->threads == 1  )
                     printf("Sync time = %'ld µs\n", mainctxt->fsyncus );
                 else
-                    printf("Average sync time = %'ld µs\n", mainctxt->fsyncus / mainctxt->threads );
+                    printf("Average sync time = %'ld µs\n", mainctxt->fsyncus / ngen );
             }
             if (  mainctxt->closeus  )
             {
                 if (  mainctxt->onefile || (mainctxt->threads == 1)  )
                     printf("Close time = %'ld µs\n", mainctxt->closeus );
                 else
-                    printf("Average close time = %'ld µs\n", mainctxt->closeus / mainctxt->threads );
+                    printf("Average close time = %'ld µs\n", mainctxt->closeus / ngen );
             }
         }
         else
@@ -2683,26 +9503,45 @@ runTests(
             reportTimes();
             printf( "\n" );
         }
+        outputPhase( mainctxt, threadcontexts, numcontexts, RATE_GEN );
 
         if (  stopReceived()  )
         {
             for ( i = 0; i < numcontexts; i++ )
                 threadcontexts[i].tstate = STOP;
+            postStart();
             goto fini;
         }
     
     } // usrfile
+
+nextround:
+    if (  mainctxt->repeat > 1  )
+    {
+        nrounds++;
+        if (  citarget > 0.0  )
+            printf("Round %d (at most %d)\n\n", nrounds, mainctxt->repeat);
+        else
+            printf("Round %d of %d\n\n", nrounds, mainctxt->repeat);
+    }
     
     // Tell them all to start read test
     if (  ! mainctxt->noread  )
     {
         printf("Testing reads...\n");
+        setLivePhase( RATE_READ );
 
-        ramping = (mainctxt->ramp > 0);
+        ramping = (mainctxt->ramp > 0) || mainctxt->steady;
         now = getTimeAsUs();
         if (  ramping  )
         {
-            rlimit = now + (mainctxt->ramp * 1000000);
+            if (  mainctxt->steady  )
+            {
+                rlimit = now + (mainctxt->steady * 1000000L);
+                startSteady( threadcontexts, numcontexts, now );
+            }
+            else
+                rlimit = now + (mainctxt->ramp * 1000000);
             dlimit = 0;
             tstate = pstate = RAMP;
         }
@@ -2713,16 +9552,19 @@ runTests(
             tstate = pstate = MEASURE;
             gettimeofday( &pstart, NULL );
             getrusage( RUSAGE_SELF, &rstart );
+            startSamples( threadcontexts, numcontexts, 1, now );
         }
 
         for ( i = 0; i < numcontexts; i++ )
             threadcontexts[i].tstate = tstate;
         for ( i = 0; i < numcontexts; i++ )
             threadcontexts[i].rdstart = 1;
+        postStart();
 
         // wait for them all to finish read test
         do {
 
+            seq = getEventSeq();
             now = getTimeAsUs();
             if (  stopReceived()  )
             {
@@ -2736,7 +9578,8 @@ runTests(
             else
             if (  ramping  )
             {
-                if (  now > rlimit  )
+                if (  (now > rlimit) ||
+                      ((dlimit == 0) && steadyState( threadcontexts, numcontexts, now ))  )
                 {
                     if (  dlimit == 0  )
                     {
@@ -2745,6 +9588,7 @@ runTests(
                         tstate = MEASURE;
                         gettimeofday( &pstart, NULL );
                         getrusage( RUSAGE_SELF, &rstart );
+                        startSamples( threadcontexts, numcontexts, 1, now );
                     }
                     else
                         tstate = END;
@@ -2769,10 +9613,17 @@ runTests(
                 }
             }
 
+            // the interval ending with the measurement is sampled too
+            if (  (tstate == MEASURE) || (pstate == MEASURE)  )
+                takeSample( threadcontexts, numcontexts, 1, now );
+            if (  (pstate == MEASURE) && (tstate != MEASURE)  )
+                stopSamples( now );
+
             if (  tstate != pstate  )
             {
                 for ( i = 0; i < numcontexts; i++ )
                     threadcontexts[i].tstate = tstate;
+                postStart();
                 pstate = tstate;
             }
 
@@ -2780,8 +9631,12 @@ runTests(
             for ( i = 0; i < numcontexts; i++ )
                 if (  ! threadcontexts[i].rdfinished  )
                     allready = 0;
+            // sleep until a thread finishes or the next phase deadline
             if (  ! allready  )
-                usSleep( WAIT_US );
+                waitEvent( seq, ((tstate == END) || (tstate == STOP)) ? 0L :
+                                 (ramping ? ((steady.active && (steady.nextus < rlimit)) ?
+                                             steady.nextus : rlimit) :
+                                  ((sampler.nextus < dlimit) ? sampler.nextus : dlimit)) );
         } while ( ! allready );
 
         // check for errors
@@ -2798,11 +9653,9 @@ runTests(
             }
         if (  haderror  )
         {
-            // abort all threads
-            for ( i = 0; i < numcontexts; i++ )
-                threadcontexts[i].wrstart = -1;
-            // mainctxt->rdfinished = -1;
-            return 4;
+            abortThreads( threadcontexts, numcontexts );
+            ret = 4;
+            goto fini;
         }
 
         // summarise and report results
@@ -2820,14 +9673,24 @@ runTests(
             if (  threadcontexts[i].usrdstop < minstop  )
                 minstop = threadcontexts[i].usrdstop;
             mainctxt->nreads += threadcontexts[i].nreads;
+            // targets on different filesystems may use different I/O sizes
+            threadcontexts[i].rdbytes = threadcontexts[i].nreads * threadcontexts[i].iosz;
+            mainctxt->rdbytes += threadcontexts[i].rdbytes;
+            histMerge( &mainctxt->rdhist, &threadcontexts[i].rdhist );
+            mainctxt->nverified += threadcontexts[i].nverified;
+            mainctxt->verifyus += threadcontexts[i].verifyus;
             usdur = threadcontexts[i].rdduration;
             mainctxt->rdduration += usdur;
-            if (  mainctxt->verbose && (mainctxt->threads > 1) && (usdur > 0)  )
+            if (  mainctxt->verbose && (mainctxt->threads > 1) &&
+                  (mainctxt->threads <= VERBOSE_THREADS) && (usdur > 0)  )
                 printf("Thread %d: %'ld reads in %'ld µs = %.2f read IOPS, %.2f MB/s\n",
                    i, threadcontexts[i].nreads, usdur,
           ((double)threadcontexts[i].nreads*(double)1000000.0)/(double)usdur,
-          ((double)threadcontexts[i].nreads*(double)threadcontexts[i].iosz*(double)1000000.0)/(double)(MB_MULT*usdur));
+          ((double)threadcontexts[i].rdbytes*(double)1000000.0)/(double)(MB_MULT*usdur));
         }
+        if (  mainctxt->threads > 1  )
+            reportSpread( threadcontexts, numcontexts, RATE_READ,
+                          mainctxt->verbose && (mainctxt->threads <= VERBOSE_THREADS) );
 
         mainctxt->rdduration /= numcontexts;
         if (  mainctxt->rdduration > 0  )
@@ -2835,16 +9698,40 @@ runTests(
             printf("\n%'ld total reads in %.3f seconds = %.2f read IOPS, %.2f MB/s\n", 
                    mainctxt->nreads, (double)mainctxt->rdduration / 1000000.0,
           ((double)mainctxt->nreads*(double)1000000.0)/(double)mainctxt->rdduration,
-          ((double)mainctxt->nreads*(double)mainctxt->iosz*(double)1000000.0)/(double)(MB_MULT * mainctxt->rdduration));
+          ((double)mainctxt->rdbytes*(double)1000000.0)/(double)(MB_MULT * mainctxt->rdduration));
+            if (  mainctxt->verify  )
+                printf("%'ld blocks verified, verification time = %.3f seconds (%.2f%% of measured time)\n",
+                       mainctxt->nverified,
+                       (double)(mainctxt->verifyus / numcontexts) / 1000000.0,
+                       (100.0 * (double)(mainctxt->verifyus / numcontexts)) / (double)mainctxt->rdduration );
         if (  mainctxt->threads > 1  )
             printf("Measurement variation: start = %'ld µs, stop = %'ld µs\n",
                    (maxstart - minstart), (maxstop - minstop) );
+            if (  mainctxt->steady  )
+                reportSteady( mainctxt );
+            if (  ntargets > 1  )
+                reportTargets( threadcontexts, numcontexts, 1 );
+#if defined(ALLOW_PERF)
+            if (  mainctxt->perf  )
+                reportPerf( threadcontexts, numcontexts, RATE_READ );
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_DEVSTATS)
+            if (  mainctxt->devstats  )
+                reportDevices( threadcontexts, numcontexts, RATE_READ );
+#endif /* ALLOW_DEVSTATS */
             printf("\n");
             if (  mainctxt->reportcpu  )
             {
                 reportTimes();
+                reportThreadCpu( threadcontexts, numcontexts, RATE_READ );
+#if defined(ALLOW_SYSCPU)
+                reportSystemCpu( mainctxt->verbose );
+#endif /* ALLOW_SYSCPU */
                 printf( "\n" );
             }
+            outputPhase( mainctxt, threadcontexts, numcontexts, RATE_READ );
+            comparePhase( mainctxt, RATE_READ );
+            recordRound( mainctxt, RATE_READ );
         }
     }
 
@@ -2852,19 +9739,33 @@ runTests(
     {
         for ( i = 0; i < numcontexts; i++ )
             threadcontexts[i].tstate = STOP;
+        postStart();
         goto fini;
     }
     
     // Tell them all to start write test
     if (  ! mainctxt->nowrite  )
     {
-        printf("Testing writes...\n");
+        if (  mainctxt->discard == DISC_NONE  )
+            printf("Testing writes...\n");
+        else
+        if (  mainctxt->discardpct >= MAX_DISCPCT  )
+            printf("Testing discards...\n");
+        else
+            printf("Testing writes and discards...\n");
+        setLivePhase( RATE_WRITE );
 
-        ramping = (mainctxt->ramp > 0);
+        ramping = (mainctxt->ramp > 0) || mainctxt->steady;
         now = getTimeAsUs();
         if (  ramping  )
         {
-            rlimit = now + (mainctxt->ramp * 1000000);
+            if (  mainctxt->steady  )
+            {
+                rlimit = now + (mainctxt->steady * 1000000L);
+                startSteady( threadcontexts, numcontexts, now );
+            }
+            else
+                rlimit = now + (mainctxt->ramp * 1000000);
             dlimit = 0;
             tstate = pstate = RAMP;
         }
@@ -2875,15 +9776,18 @@ runTests(
             tstate = pstate = MEASURE;
             gettimeofday( &pstart, NULL );
             getrusage( RUSAGE_SELF, &rstart );
+            startSamples( threadcontexts, numcontexts, 0, now );
         }
         for ( i = 0; i < numcontexts; i++ )
             threadcontexts[i].tstate = tstate;
 
         for ( i = 0; i < numcontexts; i++ )
             threadcontexts[i].wrstart = 1;
+        postStart();
 
         // wait for them all to finish write test
         do {
+            seq = getEventSeq();
             now = getTimeAsUs();
             if (  stopReceived()  )
             {
@@ -2897,7 +9801,8 @@ runTests(
             else
             if (  ramping  )
             {
-                if (  now > rlimit  )
+                if (  (now > rlimit) ||
+                      ((dlimit == 0) && steadyState( threadcontexts, numcontexts, now ))  )
                 {
                     if (  dlimit == 0  )
                     {
@@ -2906,6 +9811,7 @@ runTests(
                         tstate = MEASURE;
                         gettimeofday( &pstart, NULL );
                         getrusage( RUSAGE_SELF, &rstart );
+                        startSamples( threadcontexts, numcontexts, 0, now );
                     }
                     else
                         tstate = END;
@@ -2930,10 +9836,17 @@ runTests(
                 }
             }
 
+            // the interval ending with the measurement is sampled too
+            if (  (tstate == MEASURE) || (pstate == MEASURE)  )
+                takeSample( threadcontexts, numcontexts, 0, now );
+            if (  (pstate == MEASURE) && (tstate != MEASURE)  )
+                stopSamples( now );
+
             if (  tstate != pstate  )
             {
                 for ( i = 0; i < numcontexts; i++ )
                     threadcontexts[i].tstate = tstate;
+                postStart();
                 pstate = tstate;
             }
 
@@ -2941,8 +9854,12 @@ runTests(
             for ( i = 0; i < numcontexts; i++ )
                 if (  ! threadcontexts[i].wrfinished  )
                     allready = 0;
+            // sleep until a thread finishes or the next phase deadline
             if (  ! allready  )
-                usSleep( WAIT_US );
+                waitEvent( seq, ((tstate == END) || (tstate == STOP)) ? 0L :
+                                 (ramping ? ((steady.active && (steady.nextus < rlimit)) ?
+                                             steady.nextus : rlimit) :
+                                  ((sampler.nextus < dlimit) ? sampler.nextus : dlimit)) );
         } while ( ! allready );
 
         // check for errors
@@ -2959,14 +9876,17 @@ runTests(
             }
         if (  haderror  )
         {
+            abortThreads( threadcontexts, numcontexts );
             mainctxt->wrfinished = -1;
-            return 5;
+            ret = 5;
+            goto fini;
         }
     
         // summarise and report results
         maxstart = maxstop = 0L;
         minstart = minstop = 999999999999999999L;
         mainctxt->fsyncus = 0;
+        mainctxt->verifyus = 0;
         for ( i = 0; i < numcontexts; i++ )
         {
             if (  threadcontexts[i].uswrstart > maxstart  )
@@ -2978,32 +9898,66 @@ runTests(
             if (  threadcontexts[i].uswrstop < minstop  )
                 minstop = threadcontexts[i].uswrstop;
             mainctxt->nwrites += threadcontexts[i].nwrites;
+            threadcontexts[i].wrbytes = threadcontexts[i].nwrites * threadcontexts[i].iosz;
+            mainctxt->wrbytes += threadcontexts[i].wrbytes;
+            histMerge( &mainctxt->wrhist, &threadcontexts[i].wrhist );
             usdur = threadcontexts[i].wrduration;
             mainctxt->wrduration += usdur;
             mainctxt->fsyncus += threadcontexts[i].fsyncus;
             mainctxt->closeus += threadcontexts[i].closeus;
+            mainctxt->verifyus += threadcontexts[i].verifyus;
+            mainctxt->contentus += threadcontexts[i].contentus;
+            mainctxt->nflushes += threadcontexts[i].nflushes;
+            mainctxt->flushus += threadcontexts[i].flushus;
+            histMerge( &mainctxt->flushhist, &threadcontexts[i].flushhist );
+            mainctxt->ndiscards += threadcontexts[i].ndiscards;
+            threadcontexts[i].dcbytes = threadcontexts[i].ndiscards * threadcontexts[i].iosz;
+            mainctxt->dcbytes += threadcontexts[i].dcbytes;
+            histMerge( &mainctxt->discardhist, &threadcontexts[i].discardhist );
             if (  mainctxt->verbose && (mainctxt->threads > 1) &&
+                  (mainctxt->threads <= VERBOSE_THREADS) &&
                   (threadcontexts[i].wrduration > 0)  )
             {
                 printf("Thread %d: %'ld writes in %'ld µs = %.2f write IOPS, %.2f MB/s\n",
                    i, threadcontexts[i].nwrites, usdur,
           ((double)threadcontexts[i].nwrites*(double)1000000.0)/(double)usdur,
-          ((double)threadcontexts[i].nwrites*(double)threadcontexts[i].iosz*(double)1000000.0)/(double)(MB_MULT*usdur));
+          ((double)threadcontexts[i].wrbytes*(double)1000000.0)/(double)(MB_MULT*usdur));
+                if (  threadcontexts[i].nflushes  )
+                    printf("Thread %d: %'ld flushes, flush time = %'ld µs\n",
+                           i, threadcontexts[i].nflushes, threadcontexts[i].flushus );
+                if (  threadcontexts[i].ndiscards  )
+                    printf("Thread %d: %'ld discards = %.2f discard IOPS\n",
+                           i, threadcontexts[i].ndiscards,
+          ((double)threadcontexts[i].ndiscards*(double)1000000.0)/(double)usdur );
                 if (  threadcontexts[i].fsyncus  )
                     printf("Thread %d: sync time = %'ld µs\n", i, threadcontexts[i].fsyncus );
                 if (  threadcontexts[i].closeus  )
                     printf("Thread %d: close time = %'ld µs\n", i, threadcontexts[i].closeus );
             }
         }
+        if (  mainctxt->threads > 1  )
+            reportSpread( threadcontexts, numcontexts, RATE_WRITE,
+                          mainctxt->verbose && (mainctxt->threads <= VERBOSE_THREADS) );
 
         mainctxt->wrduration /= numcontexts;
         if (  mainctxt->wrduration > 0  )
         {
             {
-              printf("\n%'ld total writes in %.3f seconds = %.2f write IOPS, %.2f MB/s\n", 
-                       mainctxt->nwrites, (double)mainctxt->wrduration / 1000000.0, 
-              ((double)mainctxt->nwrites*(double)1000000.0)/(double)mainctxt->wrduration,
-              ((double)mainctxt->nwrites*(double)mainctxt->iosz*(double)1000000.0)/(double)(MB_MULT*mainctxt->wrduration));
+              printf("\n");
+              if (  mainctxt->nwrites || ! mainctxt->ndiscards  )
+                  printf("%'ld total writes in %.3f seconds = %.2f write IOPS, %.2f MB/s\n", 
+                           mainctxt->nwrites, (double)mainctxt->wrduration / 1000000.0, 
+                  ((double)mainctxt->nwrites*(double)1000000.0)/(double)mainctxt->wrduration,
+                  ((double)mainctxt->wrbytes*(double)1000000.0)/(double)(MB_MULT*mainctxt->wrduration));
+              if (  mainctxt->ndiscards  )
+              {
+                  printf("%'ld total %s discards in %.3f seconds = %.2f discard IOPS, %.2f MB/s\n",
+                           mainctxt->ndiscards, discardName( mainctxt->discard ),
+                           (double)mainctxt->wrduration / 1000000.0,
+                  ((double)mainctxt->ndiscards*(double)1000000.0)/(double)mainctxt->wrduration,
+                  ((double)mainctxt->dcbytes*(double)1000000.0)/(double)(MB_MULT*mainctxt->wrduration));
+                  reportHistogram( "Discard", &mainctxt->discardhist );
+              }
               if ( mainctxt->fsyncus )
               {
                   if ( mainctxt->threads == 1  )
@@ -3018,89 +9972,931 @@ runTests(
                   else
                       printf("Average close time = %'ld µs\n", mainctxt->closeus / mainctxt->threads );
               }
+              if (  mainctxt->content != CONT_ZERO  )
+                  printf("Content generation time = %.3f seconds (%.2f%% of measured time)\n",
+                         (double)(mainctxt->contentus / numcontexts) / 1000000.0,
+                         (100.0 * (double)(mainctxt->contentus / numcontexts)) / (double)mainctxt->wrduration );
+              if (  mainctxt->verify  )
+                  printf("Verification stamping time = %.3f seconds (%.2f%% of measured time)\n",
+                         (double)(mainctxt->verifyus / numcontexts) / 1000000.0,
+                         (100.0 * (double)(mainctxt->verifyus / numcontexts)) / (double)mainctxt->wrduration );
+              if (  mainctxt->nflushes  )
+              {
+                  // flush contribution includes any final sync
+                  flushus = (mainctxt->flushus + mainctxt->fsyncus) / numcontexts;
+                  printf("%'ld total %s flushes, one per %'d write%s\n",
+                         mainctxt->nflushes, flushCallName( mainctxt->durability ),
+                         mainctxt->syncint, (mainctxt->syncint>1)?"s":"" );
+                  reportHistogram( "Flush", &mainctxt->flushhist );
+                  printf("Write contribution = %.3f seconds (%.1f%%), flush contribution = %.3f seconds (%.1f%%)\n",
+                         (double)(mainctxt->wrduration - flushus) / 1000000.0,
+                         (100.0 * (double)(mainctxt->wrduration - flushus)) / (double)mainctxt->wrduration,
+                         (double)flushus / 1000000.0,
+                         (100.0 * (double)flushus) / (double)mainctxt->wrduration );
+              }
             }
             if (  mainctxt->threads > 1  )
                 printf("Measurement variation: start = %'ld µs, stop = %'ld µs\n",
                        (maxstart - minstart), (maxstop - minstop) );
+            if (  mainctxt->steady  )
+                reportSteady( mainctxt );
+            if (  ntargets > 1  )
+                reportTargets( threadcontexts, numcontexts, 0 );
+#if defined(ALLOW_PERF)
+            if (  mainctxt->perf  )
+                reportPerf( threadcontexts, numcontexts, RATE_WRITE );
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_DEVSTATS)
+            if (  mainctxt->devstats  )
+                reportDevices( threadcontexts, numcontexts, RATE_WRITE );
+#endif /* ALLOW_DEVSTATS */
             printf("\n");
             if (  mainctxt->reportcpu  )
             {
-                reportTimes();
-                printf( "\n" );
+                reportTimes();
+                reportThreadCpu( threadcontexts, numcontexts, RATE_WRITE );
+#if defined(ALLOW_SYSCPU)
+                reportSystemCpu( mainctxt->verbose );
+#endif /* ALLOW_SYSCPU */
+                printf( "\n" );
+            }
+            outputPhase( mainctxt, threadcontexts, numcontexts, RATE_WRITE );
+            comparePhase( mainctxt, RATE_WRITE );
+            recordRound( mainctxt, RATE_WRITE );
+        }
+    }
+
+    if (  (mainctxt->repeat > 1) && ! stopReceived()  )
+    {
+        // wait for all threads to finish the round
+        do {
+            seq = getEventSeq();
+            allready = 1;
+            for ( i = 0; i < numcontexts; i++ )
+                if (  ! threadcontexts[i].wrfinished  )
+                    allready = 0;
+            if (  ! allready  )
+                waitEvent( seq, 0L );
+        } while ( ! allready );
+
+        if (  moreRounds( mainctxt, nrounds )  )
+        {
+            resetRound( mainctxt, threadcontexts, numcontexts );
+            for ( i = 0; i < numcontexts; i++ )
+                threadcontexts[i].rnstart = 1;
+            postStart();
+            goto nextround;
+        }
+        reportRounds( nrounds );
+        for ( i = 0; i < numcontexts; i++ )
+            threadcontexts[i].rnstart = -1;
+        postStart();
+    }
+
+    if (  stopReceived()  )
+    {
+        for ( i = 0; i < numcontexts; i++ )
+            threadcontexts[i].tstate = STOP;
+        postStart();
+    }
+
+fini:
+    // cleanup all threads
+    for ( i = 0; i < numcontexts; i++ )
+        pthread_join( threadcontexts[i].tid, NULL );
+    setLivePhase( -1 );
+    
+    return ret;
+} // runTests
+
+/*
+ * Create a test file (CREATE mode).
+ */
+
+int
+createFile(
+           context_t * ctxt
+          )
+{
+    int ret = 0;
+    time_t gentime;
+
+    if (  ctxt->reuse  )
+    {
+        ret = readReuseInfo( ctxt );
+        if (  ret >= 0  )
+        {
+            if (  ret == 0  )
+            {
+                gentime = (time_t)ctxt->gentime;
+                printf("Reusing existing test file generated %s\n", ctime( &gentime ) );
+            }
+            return ret;
+        }
+        ret = 0;
+    }
+
+    if (  ((ret = initTests( ctxt )) == 0) && ((ret = fitMemBudget( ctxt, 1 )) == 0)  )
+    {
+        if (  ctxt->nopreallocate  )
+            printf("Preallocation is disabled\n\n");
+        printf("Filesystem block size is %'ld bytes\n", ctxt->blksz);
+#if defined(MACOS) || defined(SOLARIS)
+        printf("Filesystem optimal I/O size is %'ld bytes\n", ctxt->optiosz);
+#endif /* MACOS || SOLARIS */
+        printf("\nFile generation block size is %'ld bytes\n\n", ctxt->geniosz);
+
+        gettimeofday( &pstart, NULL );
+        getrusage( RUSAGE_SELF, &rstart );
+        ret = generateFile( ctxt, 1 );
+        getrusage( RUSAGE_SELF, &rend );
+        gettimeofday( &pend, NULL );
+        if (  (ret == 0) && ctxt->reuse  )
+            ret = writeReuseInfo( ctxt );
+
+        if (  ret == 0  )
+        {
+            // report results
+            if (  ctxt->preallocus  )
+                printf("Preallocation time = %'ld µs\n", ctxt->preallocus );
+            if (  (ctxt->crduration >= 100000) && (ctxt->fsz >= MB_MULT)  )
+            {
+                printf("Write time = %'ld µs, rate = %.2f MB/s\n", ctxt->crduration,
+             (((double)ctxt->fsz/(double)MB_MULT)*1000000.0)/(double)ctxt->crduration );
+                if (  ctxt->fsyncus  )
+                    printf("Sync time = %'ld µs\n", ctxt->fsyncus );
+                if (  ctxt->closeus  )
+                    printf("Close time = %'ld µs\n", ctxt->closeus );
+            }
+            else
+                printf("Insufficient accuracy to report write rate\n");
+            printf("\n");
+            if (  ctxt->reportcpu  )
+            {
+                reportTimes();
+                printf( "\n" );
+            }
+            outputPhase( ctxt, ctxt, 1, RATE_GEN );
+            reportPeakRSS();
+        }
+        else
+            unlink( ctxt->tfname );
+    }
+
+    return ret;
+} // createFile
+
+/*
+ * Run the test described by 'mctxt', once its options have been parsed.
+ */
+
+int
+performTest(
+            void
+           )
+{
+    int i, ret = 0, hwcrc = 0;
+
+    if (  mctxt.verify  )
+    {
+        hwcrc = crc32cInit();
+        mctxt.vseed = getTimeAsUs() ^ ((long)getpid() << 32);
+    }
+
+    printf("\n----------------------------------------------------------------------\n\n");
+
+    printf("%s version %s\n\n", PROGNAME, VERSION );
+
+    if (  jobname != NULL  )
+        printf("Job '%s'\n\n", jobname );
+
+    if (  mctxt.verify  )
+        printf("Data verification is enabled (%s CRC32C)\n%s",
+               hwcrc?"hardware":"software",
+               (mctxt.testmode == MODE_CREATE)?"\n":"" );
+
+    if (  mctxt.content != CONT_ZERO  )
+    {
+        printf("Buffer content is random, compression ratio %.2f:1, dedupe ratio %.2f:1\n%s",
+               mctxt.compress, mctxt.dedupe,
+               (mctxt.testmode == MODE_CREATE)?"\n":"" );
+        if (  mctxt.dedupe > MIN_RATIO  )
+        {
+            seedRandom( &mctxt, (uint64_t)getTimeAsUs() );
+            if (  (dedupePool == NULL) && initDedupePool( &mctxt )  )
+                return 1;
+        }
+    }
+
+    if (  (outfname != NULL) && (outfp == NULL) && openOutput()  )
+        return 1;
+
+    if (  mctxt.testmode == MODE_CREATE  )
+        ret = createFile( &mctxt );
+    else
+    {
+        if (  mctxt.testmode == MODE_SEQUENTIAL  )
+            printf("Sequential mode\n");
+        else
+            printf("Random mode\n");
+        if (  cmpfname != NULL  )
+            printf("Comparing with baseline '%s'\n", cmpfname);
+        if (  mctxt.onefile  )
+        {
+            if (  mctxt.usrfile  )
+                printf("User file mode\n");
+            else
+                printf("Single file mode\n");
+        }
+        if (  ntargets > 1  )
+        {
+            for ( i = 0; i < ntargets; i++ )
+                printf("Target %d: path '%s', %d thread%s\n", i, targets[i].fname,
+                       targets[i].threads, (targets[i].threads>1)?"s":"" );
+            printf("%d threads in total\n", mctxt.threads );
+        }
+        else
+        {
+            printf("Path '%s'\n", mctxt.fname );
+            printf("%d thread%s\n", mctxt.threads, (mctxt.threads>1)?"s":"" );
+        }
+        if (  mctxt.nopreallocate  )
+            printf("Preallocation is disabled\n");
+        if (  mctxt.reuse  )
+            printf("Test files are reused\n");
+        if (  mctxt.clone  )
+            printf("Test files are cloned from a template\n");
+        if (  mctxt.hugepages != BUF_NORMAL  )
+            printf("I/O buffers use %s huge pages\n",
+                   (mctxt.hugepages == BUF_THP)?"transparent":"explicit" );
+        if (  mctxt.lockbufs  )
+            printf("I/O buffers are locked in memory\n");
+        if (  mctxt.perf  )
+            printf("Performance counters are reported per I/O\n");
+        if (  mctxt.steady  )
+            printf("Ramp up lasts until steady state, at most %'d seconds\n", mctxt.steady);
+        if (  citarget > 0.0  )
+            printf("Tests are repeated until the IOPS 95%% confidence interval is within %.1f%%, at most %d times\n",
+                   citarget, mctxt.repeat);
+        else
+        if (  mctxt.repeat > 1  )
+            printf("Tests are repeated %d times\n", mctxt.repeat);
+        if (  mctxt.membudget > 0  )
+            printf("Buffer memory budget is %'ld bytes\n", mctxt.membudget);
+        if (  statsfname != NULL  )
+            printf("Live statistics are served on '%s'\n", statsfname);
+        if (  mctxt.rdahead  )
+            printf("Read ahead is not disabled\n");
+        if (  mctxt.cache  )
+            printf("Filesystem cache is not disabled\n");
+        if (  mctxt.nodsync  )
+            printf("O_DSYNC is not used\n");
+        if (  mctxt.nofsync  )
+            printf("%s is not used\n", flushCallName( DUR_FDATASYNC ));
+        if (  (mctxt.durability == DUR_FDATASYNC) ||
+              (mctxt.durability == DUR_FSYNC) ||
+              (mctxt.durability == DUR_SYNCRANGE)  )
+            printf("Durability mode is %s, %s every %'d write%s\n",
+                   durabilityName( mctxt.durability ),
+                   flushCallName( mctxt.durability ), mctxt.syncint,
+                   (mctxt.syncint>1)?"s":"" );
+        else
+        if (  mctxt.durability != DUR_DSYNC  )
+            printf("Durability mode is %s\n", durabilityName( mctxt.durability ) );
+        if (  mctxt.discard != DISC_NONE  )
+            printf("Discard operation is %s, %d%% of write phase operations\n",
+                   discardName( mctxt.discard ), mctxt.discardpct );
+    
+        // each thread has a file and, with '-perf', its counters
+        raiseFileLimit( mctxt.perf ? mctxt.threads * (1 + PERF_NEVENTS) : mctxt.threads );
+        if (  (tctxt = allocContexts( &mctxt, mctxt.threads )) == NULL  )
+            return 1;
+        if (  (ret = initContexts( &mctxt, tctxt, mctxt.threads )) == 0  )
+        {
+#if defined( ALLOW_RAW )
+            printf("\n%s block size is %'ld bytes\n", mctxt.raw?"Device":"Filesystem", mctxt.blksz);
+            printf("%s optimal I/O size is %'ld bytes\n", mctxt.raw?"Device":"Filesystem", mctxt.optiosz);
+#else /* ! ALLOW_RAW */
+            printf("\nFilesystem block size is %'ld bytes\n", mctxt.blksz);
+            printf("Filesystem optimal I/O size is %'ld bytes\n", mctxt.optiosz);
+#endif /* ! ALLOW_RAW */
+            if (  ! mctxt.usrfile  )
+                printf("\nFile generation block size is %'ld bytes\n", mctxt.geniosz);
+            printf("\nTest block size is %'ld bytes\n\n", mctxt.iosz);
+#if defined(ALLOW_AFFINITY)
+            if (  mctxt.affinity != AFF_NONE  )
+            {
+                reportAffinity( &mctxt, tctxt, mctxt.threads );
+                printf("\n");
+            }
+#endif /* ALLOW_AFFINITY */
+#if defined(ALLOW_DEVSTATS)
+            if (  mctxt.devstats  )
+            {
+                if (  findDevices( tctxt, mctxt.threads ) == 0  )
+                    printf("No block device found for device statistics\n\n");
+                else
+                {
+                    printf("Device statistics are collected for");
+                    for ( i = 0; i < ndevices; i++ )
+                        printf("%s %s", i ? "," : "", devices[i].name);
+                    printf("\n\n");
+                }
+            }
+#endif /* ALLOW_DEVSTATS */
+    
+            if (  (statsfname != NULL) && startStats()  )
+                ret = 1;
+            else
+                ret = runTests( &mctxt, tctxt, mctxt.threads );
+            stopStats();
+            if (  ret == 0  )
+                reportPeakRSS();
+        }
+    
+        cleanupContexts( tctxt, mctxt.threads );
+        free( (void *)tctxt );
+        tctxt = NULL;
+    }
+
+    return ret;
+
+} // performTest
+
+/*
+ * Read the job file. Returns 0 on success; errors are reported here.
+ */
+
+int
+loadJobs(
+         char * jfname
+        )
+{
+    char line[JOB_LINESZ];
+    char * p, * q, * val, * why = NULL;
+    FILE * fp;
+    job_t * job = &jobs[0];
+    int lineno = 0, mode, j;
+
+    if (  (fp = fopen( jfname, "r" )) == NULL  )
+    {
+        fprintf( stderr, "\n*** Unable to open '%s' - %d (%s)\n",
+                 jfname, errno, strerror( errno ) );
+        return 1;
+    }
+    strcpy( jobs[0].name, "global" );
+    jobs[0].testmode = MODE_UNKNOWN;
+
+    while (  (why == NULL) && (fgets( line, sizeof(line), fp ) != NULL)  )
+    {
+        lineno++;
+        if (  (strchr( line, '\n' ) == NULL) && ! feof( fp )  )
+        {
+            why = "line is too long";
+            break;
+        }
+        for ( p = line; isspace( (unsigned char)*p ); p++ ) ;
+        for ( q = p + strlen( p ); (q > p) && isspace( (unsigned char)q[-1] ); q-- ) ;
+        *q = '\0';
+        if (  (*p == '\0') || (*p == '#') || (*p == ';')  )
+            continue;
+
+        // [<name>] starts a new job
+        if (  *p == '['  )
+        {
+            if (  q[-1] != ']'  )
+            {
+                why = "invalid section";
+                break;
+            }
+            *--q = '\0';
+            p++;
+            if (  (*p == '\0') || (strlen( p ) >= JOB_NAMESZ)  )
+                why = "invalid job name";
+            else
+            if (  strcmp( p, "global" ) == 0  )
+            {
+                if (  (njobs > 0) || (jobs[0].line > 0)  )
+                    why = "'[global]' must be the first section";
+                else
+                    jobs[0].line = lineno;
+            }
+            else
+            if (  njobs >= MAX_JOBS  )
+                why = "too many jobs";
+            else
+            {
+                for ( j = 1; j <= njobs; j++ )
+                    if (  strcmp( jobs[j].name, p ) == 0  )
+                        why = "duplicate job name";
+                job = &jobs[++njobs];
+                strcpy( job->name, p );
+                job->line = lineno;
+                job->testmode = MODE_UNKNOWN;
+            }
+            continue;
+        }
+        if (  (njobs == 0) && (jobs[0].line == 0)  )
+        {
+            why = "option outside of a section";
+            break;
+        }
+
+        // <option> [= <value>]
+        val = strchr( p, '=' );
+        if (  val != NULL  )
+        {
+            for ( q = val; (q > p) && isspace( (unsigned char)q[-1] ); q-- ) ;
+            *q = '\0';
+            for ( val++; isspace( (unsigned char)*val ); val++ ) ;
+        }
+        if (  *p == '-'  )
+            p++;
+        if (  (*p == '\0') || (strpbrk( p, " \t" ) != NULL)  )
+        {
+            why = "invalid option";
+            break;
+        }
+        if (  strcmp( p, "mode" ) == 0  )
+        {
+            mode = MODE_UNKNOWN;
+            if (  val != NULL  )
+            {
+                if (  (strcmp( val, "s" ) == 0) || (strcmp( val, "sequential" ) == 0)  )
+                    mode = MODE_SEQUENTIAL;
+                else
+                if (  (strcmp( val, "r" ) == 0) || (strcmp( val, "random" ) == 0)  )
+                    mode = MODE_RANDOM;
+                else
+                if (  (strcmp( val, "c" ) == 0) || (strcmp( val, "create" ) == 0)  )
+                    mode = MODE_CREATE;
+            }
+            if (  mode == MODE_UNKNOWN  )
+                why = "invalid mode";
+            else
+            if (  job->testmode != MODE_UNKNOWN  )
+                why = "multiple modes";
+            job->testmode = mode;
+            continue;
+        }
+        if (  (job != &jobs[0]) && (strcmp( p, "output" ) == 0)  )
+        {
+            why = "'output' is only allowed in '[global]'";
+            break;
+        }
+        if (  job->nargs >= MAX_JOBARGS  )
+        {
+            why = "too many options";
+            break;
+        }
+        // the option and then each of its values
+        if (  (q = (char *)malloc( strlen( p ) + 2 )) == NULL  )
+        {
+            why = "out of memory";
+            break;
+        }
+        sprintf( q, "-%s", p );
+        job->isopt[job->nargs] = 1;
+        job->args[job->nargs++] = q;
+        p = (val != NULL) ? strtok( val, " \t" ) : NULL;
+        for ( ; p != NULL; p = strtok( NULL, " \t" ) )
+        {
+            if (  (job->nargs >= MAX_JOBARGS) || ((q = strdup( p )) == NULL)  )
+            {
+                why = "too many options";
+                break;
             }
+            job->isopt[job->nargs] = 0;
+            job->args[job->nargs++] = q;
         }
     }
+    fclose( fp );
 
-    if (  stopReceived()  )
+    if (  (why == NULL) && (njobs == 0)  )
+        why = "no jobs";
+    for ( j = 1; (why == NULL) && (j <= njobs); j++ )
+        if (  jobs[j].testmode == MODE_UNKNOWN  )
+        {
+            jobs[j].testmode = jobs[0].testmode;
+            if (  jobs[j].testmode == MODE_UNKNOWN  )
+            {
+                lineno = jobs[j].line;
+                why = "job has no mode";
+            }
+        }
+    if (  why != NULL  )
     {
-        for ( i = 0; i < numcontexts; i++ )
-            threadcontexts[i].tstate = STOP;
+        fprintf( stderr, "\n*** '%s' line %d: %s\n", jfname, lineno, why );
+        return 1;
     }
 
-fini:
-    // cleanup all threads
-    for ( i = 0; i < numcontexts; i++ )
-        pthread_join( threadcontexts[i].tid, NULL );
-    
     return 0;
-} // runTests
+} // loadJobs
 
 /*
- * Create a test file (CREATE mode).
+ * Build the argument list for a job: the [global] options that the job
+ * does not give itself followed by its own. The arguments are copies as
+ * parsing may modify them; the parsed settings refer to them so they are
+ * freed, using freeJobArgs(), only once the job has finished.
  */
 
+void
+freeJobArgs(
+            char * argv[],
+            int    argc
+           )
+{
+    int i;
+
+    for ( i = 2; i < argc; i++ )
+        if (  argv[i] != NULL  )
+            free( (void *)argv[i] );
+} // freeJobArgs
+
 int
-createFile(
-           context_t * ctxt
-          )
+jobArgs(
+        job_t * job,
+        char  * argv[]
+       )
 {
-    int ret = 0;
+    int argc = 2, i, j, skip = 0;
 
-    if (  (ret = initTests( ctxt )) == 0  )
+    argv[0] = PROGNAME;
+    argv[1] = "job";
+    for ( i = 0; i < jobs[0].nargs; i++ )
     {
-        if (  ctxt->nopreallocate  )
-            printf("Preallocation is disabled\n\n");
-        printf("Filesystem block size is %'ld bytes\n", ctxt->blksz);
-#if defined(MACOS) || defined(SOLARIS)
-        printf("Filesystem optimal I/O size is %'ld bytes\n", ctxt->optiosz);
-#endif /* MACOS || SOLARIS */
-        printf("\nFile generation block size is %'ld bytes\n\n", ctxt->geniosz);
+        if (  jobs[0].isopt[i]  )
+        {
+            skip = 0;
+            for ( j = 0; j < job->nargs; j++ )
+                if (  job->isopt[j] && (strcmp( job->args[j], jobs[0].args[i] ) == 0)  )
+                    skip = 1;
+        }
+        if (  ! skip  )
+            argv[argc++] = strdup( jobs[0].args[i] );
+    }
+    for ( i = 0; i < job->nargs; i++ )
+        argv[argc++] = strdup( job->args[i] );
+    argv[argc] = NULL;
+    for ( i = 2; i < argc; i++ )
+        if (  argv[i] == NULL  )
+        {
+            fprintf( stderr, "\n*** Unable to allocate job arguments\n" );
+            freeJobArgs( argv, argc );
+            return -1;
+        }
 
-        gettimeofday( &pstart, NULL );
-        getrusage( RUSAGE_SELF, &rstart );
-        ret = generateFile( ctxt, 1 );
-        getrusage( RUSAGE_SELF, &rend );
-        gettimeofday( &pend, NULL );
+    return argc;
+} // jobArgs
 
-        if (  ret == 0  )
+/*
+ * Restore the default settings before parsing the options of a job. Every
+ * global that parsing or running a test sets is reset, apart from the open
+ * '-output' file, which is shared by all jobs, and the dedupe pool, which
+ * runJobs() keeps while it can be shared.
+ */
+
+void
+resetJob(
+         context_t * dfltctxt,
+         job_t     * job
+        )
+{
+    memcpy( (void *)&mctxt, (void *)dfltctxt, sizeof(context_t) );
+    mctxt.testmode = job->testmode;
+    tctxt = NULL;
+    memset( (void *)targets, 0, sizeof(targets) );
+    ntargets = 0;
+    memset( (void *)&pstart, 0, sizeof(pstart) );
+    memset( (void *)&pend, 0, sizeof(pend) );
+    memset( (void *)&rstart, 0, sizeof(rstart) );
+    memset( (void *)&rend, 0, sizeof(rend) );
+    outfmt = OUT_NONE;
+    outfname = NULL;
+    memset( (void *)&sampler, 0, sizeof(sampler) );
+    memset( (void *)&steady, 0, sizeof(steady) );
+    memset( (void *)&rounds, 0, sizeof(rounds) );
+    citarget = 0.0;
+    cmpfname = NULL;
+    threshold = DFLT_THRESHOLD;
+    memset( (void *)baseline, 0, sizeof(baseline) );
+    regressions = 0;
+    statsfname = NULL;
+    statsfd = -1;
+    statsStop = 0;
+    livePhase = -1;
+    livePhaseUs = 0L;
+#if defined(ALLOW_PERF)
+    perfUserOnly = 0;
+    memset( (void *)perfErrno, 0, sizeof(perfErrno) );
+#endif /* ALLOW_PERF */
+#if defined(ALLOW_DEVSTATS)
+    memset( (void *)devices, 0, sizeof(devices) );
+    ndevices = 0;
+#endif /* ALLOW_DEVSTATS */
+#if defined(ALLOW_SYSCPU)
+    memset( (void *)cpustats, 0, sizeof(cpustats) );
+#endif /* ALLOW_SYSCPU */
+    jobname = job->name;
+} // resetJob
+
+/*
+ * Describe the test files a job needs, so that consecutive jobs that
+ * need the same files can share them.
+ */
+
+void
+jobFiles(
+         char * sig,
+         size_t sz
+        )
+{
+    size_t l;
+    int i;
+
+    l = snprintf( sig, sz, "%ld %d %.2f %.2f %d %d %d", mctxt.fsz, mctxt.content,
+                  mctxt.compress, mctxt.dedupe, mctxt.verify, mctxt.onefile,
+                  mctxt.clone );
+    for ( i = 0; (i < ntargets) && (l < sz); i++ )
+        l += snprintf( sig + l, sz - l, " %s:%d", targets[i].fname,
+                       mctxt.onefile ? 1 : targets[i].threads );
+    if (  (ntargets == 0) && (l < sz)  )
+        snprintf( sig + l, sz - l, " %s:%d", mctxt.fname, mctxt.onefile ? 1 : mctxt.threads );
+} // jobFiles
+
+/*
+ * Remove the test files kept for sharing between jobs.
+ */
+
+void
+cleanupJobFiles(
+                char * paths[],
+                int  * npaths
+               )
+{
+    char * fname = mctxt.fname;
+    int i;
+
+    for ( i = 0; i < *npaths; i++ )
+    {
+        mctxt.fname = paths[i];
+        cleanupFiles( &mctxt );
+        free( (void *)paths[i] );
+    }
+    mctxt.fname = fname;
+    *npaths = 0;
+} // cleanupJobFiles
+
+/*
+ * Report the results of all jobs, and write them as a JSON record if
+ * requested.
+ */
+
+void
+reportJobs(
+           char * jfname
+          )
+{
+    char locale[64];
+    char * mode;
+    job_t * job;
+    int j, phase, first = 1;
+
+    printf("\n----------------------------------------------------------------------\n\n");
+    printf("Summary of jobs in '%s'\n\n", jfname);
+    printf("%-20s %-10s  %12s %10s  %12s %10s\n", "Job", "Mode",
+           "Read IOPS", "Read MB/s", "Write IOPS", "Write MB/s");
+    for ( j = 1; j <= njobs; j++ )
+    {
+        job = &jobs[j];
+        mode = (job->testmode == MODE_CREATE) ? "create" :
+               (job->testmode == MODE_SEQUENTIAL) ? "sequential" : "random";
+        printf("%-20.20s %-10s", job->name, mode);
+        if (  ! job->ran || job->ret  )
         {
-            // report results
-            if (  ctxt->preallocus  )
-                printf("Preallocation time = %'ld µs\n", ctxt->preallocus );
-            if (  (ctxt->crduration >= 100000) && (ctxt->fsz >= MB_MULT)  )
-            {
-                printf("Write time = %'ld µs, rate = %.2f MB/s\n", ctxt->crduration,
-             (((double)ctxt->fsz/(double)MB_MULT)*1000000.0)/(double)ctxt->crduration );
-                if (  ctxt->fsyncus  )
-                    printf("Sync time = %'ld µs\n", ctxt->fsyncus );
-                if (  ctxt->closeus  )
-                    printf("Close time = %'ld µs\n", ctxt->closeus );
-            }
+            printf("  %s\n", job->ran ? "failed" : "not run");
+            continue;
+        }
+        for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
+        {
+            // file generation is reported as writes
+            if (  (job->testmode == MODE_CREATE) && (phase == RATE_WRITE)  )
+                printf("  %12s %10.2f", "-", job->mbs[RATE_GEN]);
             else
-                printf("Insufficient accuracy to report write rate\n");
+            if (  job->iops[phase] > 0.0  )
+                printf("  %12.2f %10.2f", job->iops[phase], job->mbs[phase]);
+            else
+                printf("  %12s %10s", "-", "-");
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    if (  (outfp == NULL) || (outfmt != OUT_JSON)  )
+        return;
+    strncpy( locale, setlocale( LC_NUMERIC, NULL ), sizeof(locale) - 1 );
+    locale[sizeof(locale) - 1] = '\0';
+    setlocale( LC_NUMERIC, "C" );
+    fprintf( outfp, "{\"schema\":%d,\"version\":", OUTPUT_SCHEMA );
+    outputString( VERSION );
+    fprintf( outfp, ",\"time\":%ld,\"phase\":\"jobs\",\"jobfile\":", (long)time( NULL ) );
+    outputString( jfname );
+    fprintf( outfp, ",\"jobs\":[" );
+    for ( j = 1; j <= njobs; j++ )
+    {
+        job = &jobs[j];
+        fprintf( outfp, "%s{\"job\":", first ? "" : "," );
+        first = 0;
+        outputString( job->name );
+        fprintf( outfp, ",\"mode\":\"%s\",\"status\":\"%s\"",
+                 (job->testmode == MODE_CREATE) ? "create" :
+                 (job->testmode == MODE_SEQUENTIAL) ? "sequential" : "random",
+                 ! job->ran ? "not run" : job->ret ? "failed" : "ok" );
+        for ( phase = RATE_GEN; phase <= RATE_WRITE; phase++ )
+            if (  job->ran && ! job->ret && (job->mbs[phase] > 0.0)  )
+                fprintf( outfp, ",\"%s\":{\"iops\":%.2f,\"mbs\":%.2f}", phaseName( phase ),
+                         job->iops[phase], job->mbs[phase] );
+        fprintf( outfp, "}" );
+    }
+    fprintf( outfp, "]}\n" );
+    fflush( outfp );
+    setlocale( LC_NUMERIC, locale );
+} // reportJobs
+
+/*
+ * Run all of the jobs in a job file (JOB mode).
+ */
+
+int
+runJobs(
+        char * jfname
+       )
+{
+    char * argv[2 + (2 * MAX_JOBARGS) + 1];
+    char * paths[MAX_TARGETS];
+    char sig[JOB_SIGSZ], shared[JOB_SIGSZ];
+    char * outname = NULL;
+    context_t * dfltctxt = NULL;
+    double compress = 0.0, sd, ci;
+    long ops, bytes, usdur;
+    int argc = 0, i, j, phase, implicit, npaths = 0, ret = 0;
+    job_t * job;
+
+    if (  loadJobs( jfname )  )
+        return 1;
+    if (  posix_memalign( (void **)&dfltctxt, CACHE_LINE_SZ, sizeof(context_t) )  )
+    {
+        fprintf( stderr, "\n*** Unable to allocate %'ld bytes\n", (long)sizeof(context_t) );
+        return 1;
+    }
+    memcpy( (void *)dfltctxt, (void *)&mctxt, sizeof(context_t) );
+
+    // check all of the jobs before running any of them
+    for ( j = 1; j <= njobs; j++ )
+    {
+        freeJobArgs( argv, argc );
+        resetJob( dfltctxt, &jobs[j] );
+        if (  (argc = jobArgs( &jobs[j], argv )) < 0  )
+        {
+            argc = 0;
+            ret = 1;
+            goto fini;
+        }
+        if (  parseArgs( argc, 2, argv, &mctxt )  )
+        {
+            fprintf( stderr, "*** Invalid options for job '%s' ('%s' line %d)\n\n",
+                     jobs[j].name, jfname, jobs[j].line );
+            ret = 1;
+            goto fini;
+        }
+    }
+
+    // '-output' comes from [global] so is the same for every job; keep
+    // a copy of its path as each job's arguments are freed after it runs
+    if (  outfname != NULL  )
+    {
+        if (  (outname = strdup( outfname )) == NULL  )
+        {
+            fprintf( stderr, "\n*** Unable to allocate job arguments\n" );
+            ret = 1;
+            goto fini;
+        }
+        outfname = outname;
+        if (  openOutput()  )
+        {
+            ret = 1;
+            goto fini;
+        }
+    }
+    freeJobArgs( argv, argc );
+    argc = 0;
+
+    shared[0] = '\0';
+    for ( j = 1; (j <= njobs) && ! stopReceived(); j++ )
+    {
+        job = &jobs[j];
+        resetJob( dfltctxt, job );
+        if (  (argc = jobArgs( job, argv )) < 0  )
+        {
+            argc = 0;
+            ret = 1;
+            break;
+        }
+        if (  parseArgs( argc, 2, argv, &mctxt )  )
+        {
+            ret = 1;
+            break;
+        }
+        if (  outname != NULL  )
+            outfname = outname;
+
+        // keep the test files between jobs unless they belong to the user
+        implicit = (mctxt.testmode != MODE_CREATE) && ! mctxt.usrfile && ! mctxt.reuse;
+        if (  implicit  )
+            mctxt.reuse = 1;
+        jobFiles( sig, sizeof(sig) );
+        if (  (npaths > 0) && (strcmp( sig, shared ) != 0)  )
+        {
             printf("\n");
-            if (  ctxt->reportcpu  )
+            cleanupJobFiles( paths, &npaths );
+        }
+        else
+        if (  ! implicit && mctxt.reuse  )
+        {
+            // the user has asked to keep the shared files
+            for ( i = 0; i < npaths; i++ )
+                free( (void *)paths[i] );
+            npaths = 0;
+        }
+
+        // the dedupe pool can be shared if its content is the same
+        if (  (dedupePool != NULL) && (mctxt.compress != compress)  )
+        {
+            free( dedupePool );
+            dedupePool = NULL;
+        }
+        compress = mctxt.compress;
+
+        // runTests() joins its threads even when it fails, so a failed
+        // job leaves nothing behind and the following jobs can still run
+        job->ran = 1;
+        job->ret = performTest();
+        if (  (job->ret != 0) && (ret == 0)  )
+            ret = job->ret;
+
+        if (  implicit && (npaths == 0)  )
+        {
+            strcpy( shared, sig );
+            for ( i = 0; i < ntargets; i++ )
+                if (  (paths[npaths] = strdup( targets[i].fname )) != NULL  )
+                    npaths++;
+            if (  (ntargets == 0) && ((paths[npaths] = strdup( mctxt.fname )) != NULL)  )
+                npaths++;
+        }
+
+        if (  job->ret == 0  )
+        {
+            if (  job->testmode == MODE_CREATE  )
             {
-                reportTimes();
-                printf( "\n" );
+                phaseCounts( &mctxt, RATE_GEN, &ops, &bytes, &usdur );
+                if (  usdur > 0  )
+                {
+                    job->iops[RATE_GEN] = ((double)ops * 1000000.0) / (double)usdur;
+                    job->mbs[RATE_GEN] = ((double)bytes * 1000000.0) / (double)(MB_MULT * usdur);
+                }
             }
+            else
+            for ( phase = RATE_READ; phase <= RATE_WRITE; phase++ )
+                if (  rounds.n[phase] > 0  )
+                {
+                    roundStats( rounds.iops[phase], rounds.n[phase], &job->iops[phase], &sd, &ci );
+                    roundStats( rounds.mbs[phase], rounds.n[phase], &job->mbs[phase], &sd, &ci );
+                }
         }
-        else
-            unlink( ctxt->tfname );
+        freeJobArgs( argv, argc );
+        argc = 0;
+    }
+
+    if (  npaths > 0  )
+    {
+        printf("\n");
+        cleanupJobFiles( paths, &npaths );
     }
+    reportJobs( jfname );
+
+fini:
+    jobname = NULL;
+    freeJobArgs( argv, argc );
+    outfname = outname;
+    if (  closeOutput() && (ret == 0)  )
+        ret = 1;
+    if (  outname != NULL  )
+        free( (void *)outname );
+    outfname = NULL;
+    free( (void *)dfltctxt );
 
     return ret;
-} // createFile
+} // runJobs
 
 /*
  * Main
@@ -3112,7 +10908,9 @@ main(
      char * argv[]
     )
 {
-    int ret = 0;
+    int i, ret = 0, cargc = 1;
+    char * cargv[MAX_CMPARGS + 1];
+    char * eptr = NULL;
 #if defined(ALLOW_RAW) && defined(ALLOW_RAWWRITE)
     char * eval = NULL;
 
@@ -3126,6 +10924,56 @@ main(
     if (  argc == 1  )
         usage( 0 );
 
+    // compare re-runs the baseline's configuration as a normal test
+    if (  strcmp( argv[1], "compare" ) == 0  )
+    {
+        if (  argc < 3  )
+            usage( 0 );
+        cmpfname = argv[2];
+        cargv[0] = argv[0];
+        if (  loadBaseline( cmpfname, cargv, &cargc )  )
+            return 1;
+        for ( i = 3; i < argc; i++ )
+        {
+            if (  strcmp( argv[i], "-threshold" ) == 0  )
+            {
+                if (  ++i >= argc  )
+                {
+                    fprintf( stderr, "\n*** Missing value for '-threshold'\n" );
+                    usage( 0 );
+                }
+                threshold = strtod( argv[i], &eptr );
+                if (  (*eptr != '\0') || (threshold < 0.0) || (threshold >= 100.0)  )
+                {
+                    fprintf( stderr, "\n*** Invalid value for '-threshold'\n" );
+                    usage( 0 );
+                }
+            }
+            else
+            if (  addCompareArg( cargv, &cargc, argv[i] )  )
+            {
+                fprintf( stderr, "\n*** Too many arguments\n" );
+                return 1;
+            }
+        }
+        cargv[cargc] = NULL;
+        // like for like, latency is only measured if the baseline has it
+        if (  (baseline[RATE_READ].present && (baseline[RATE_READ].p99us >= 0)) ||
+              (baseline[RATE_WRITE].present && (baseline[RATE_WRITE].p99us >= 0))  )
+            mctxt.iolat = 1;
+        argc = cargc;
+        argv = cargv;
+    }
+
+    if (  strcmp( argv[1], "job" ) == 0  )
+    {
+        if (  argc != 3  )
+            usage( 0 );
+        setbuf( stdout, NULL );
+        handleSignals();
+        return runJobs( argv[2] );
+    }
+
     if (  (strcmp(argv[1], "s") == 0) ||
           (strcmp(argv[1], "sequential") == 0)  )
         mctxt.testmode = MODE_SEQUENTIAL;
@@ -3138,12 +10986,27 @@ main(
           (strcmp(argv[1], "create") == 0)  )
         mctxt.testmode = MODE_CREATE;
     else
+    if (  strcmp(argv[1], "cleanup") == 0  )
+        mctxt.testmode = MODE_CLEANUP;
+    else
     if (  (strcmp( argv[1], "h" ) == 0) || 
           (strcmp( argv[1], "help" ) == 0)  )
         usage( 1 );
     else
         usage( 0 );
 
+    if (  mctxt.testmode == MODE_CLEANUP  )
+    {
+        if (  (argc == 4) && (strcmp( argv[2], "-file" ) == 0)  )
+            mctxt.fname = argv[3];
+        else
+        if (  argc != 2  )
+            usage( 0 );
+        setbuf( stdout, NULL );
+        printf("\n");
+        return cleanupFiles( &mctxt );
+    }
+
     if (  parseArgs( argc, 2, argv, &mctxt )  )
         usage( 0 );
 
@@ -3151,55 +11014,21 @@ main(
 
     handleSignals();
 
-    printf("\n----------------------------------------------------------------------\n\n");
+    ret = performTest();
 
-    printf("%s version %s\n\n", PROGNAME, VERSION );
+    if (  closeOutput() && (ret == 0)  )
+        ret = 1;
 
-    if (  mctxt.testmode == MODE_CREATE  )
-        ret = createFile( &mctxt );
-    else
+    if (  (cmpfname != NULL) && (ret == 0)  )
     {
-        if (  mctxt.testmode == MODE_SEQUENTIAL  )
-            printf("Sequential mode\n");
-        else
-            printf("Random mode\n");
-        if (  mctxt.onefile  )
-        {
-            if (  mctxt.usrfile  )
-                printf("User file mode\n");
-            else
-                printf("Single file mode\n");
-        }
-        printf("Path '%s'\n", mctxt.fname );
-        printf("%d thread%s\n", mctxt.threads, (mctxt.threads>1)?"s":"" );
-        if (  mctxt.nopreallocate  )
-            printf("Preallocation is disabled\n");
-        if (  mctxt.rdahead  )
-            printf("Read ahead is not disabled\n");
-        if (  mctxt.cache  )
-            printf("Filesystem cache is not disabled\n");
-        if (  mctxt.nodsync  )
-            printf("O_DSYNC is not used\n");
-        if (  mctxt.nofsync  )
-            printf("fdatasync() is not used\n");
-    
-        if (  (ret = initContexts( &mctxt, tctxt, mctxt.threads )) == 0  )
+        if (  regressions  )
         {
-#if defined( ALLOW_RAW )
-            printf("\n%s block size is %'ld bytes\n", mctxt.raw?"Device":"Filesystem", mctxt.blksz);
-            printf("%s optimal I/O size is %'ld bytes\n", mctxt.raw?"Device":"Filesystem", mctxt.optiosz);
-#else /* ! ALLOW_RAW */
-            printf("\nFilesystem block size is %'ld bytes\n", mctxt.blksz);
-            printf("Filesystem optimal I/O size is %'ld bytes\n", mctxt.optiosz);
-#endif /* ! ALLOW_RAW */
-            if (  ! mctxt.usrfile  )
-                printf("\nFile generation block size is %'ld bytes\n", mctxt.geniosz);
-            printf("\nTest block size is %'ld bytes\n\n", mctxt.iosz);
-    
-            ret = runTests( &mctxt, tctxt, mctxt.threads );
+            printf("*** %d regression%s detected compared with '%s'\n\n",
+                   regressions, (regressions>1)?"s":"", cmpfname);
+            ret = RET_REGRESS;
         }
-    
-        cleanupContexts( tctxt, mctxt.threads );
+        else
+            printf("No regressions compared with '%s'\n\n", cmpfname);
     }
     
     return ret;